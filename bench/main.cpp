@@ -0,0 +1,343 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <optparse.hpp>
+#include "least_significant_bit.hpp"
+#include "discrete_cosine_transform.hpp"
+#include "thread_pool.hpp"
+
+// The sizes, channel counts and depths of the synthetic carrier images
+const std::vector<double> MEGAPIXELS = {0.3, 1, 4, 16, 100};
+const std::vector<int> CHANNELS = {1, 2, 3, 4};
+const std::vector<int> DEPTHS = {CV_8U, CV_16U};
+
+// The sizes of the payloads, those which don't fit in a carrier are skipped
+const std::vector<std::size_t> PAYLOAD_SIZES = {64, 4 << 10, 256 << 10, 16 << 20};
+
+// The filename stored alongside each payload
+const std::string PAYLOAD_FILENAME = "payload";
+
+/**
+ * The latency of each repetition of a single benchmark.
+ */
+struct Measurement
+{
+    std::string technique;
+    std::string operation;
+    int width;
+    int height;
+    int channels;
+    int depth;
+    std::size_t payload_size;
+    unsigned int threads;
+    std::vector<double> seconds;
+};
+
+/**
+ * Generate a carrier image filled with deterministic noise, which is roughly 4:3.
+ * The noise is kept away from black and white so that the DCT technique doesn't
+ * saturate the pixels.
+ */
+cv::Mat generate_carrier(const double &megapixels, const int &channels, const int &depth)
+{
+    const int width = std::max(16, (int)std::lround(std::sqrt(megapixels * 1e6 * 4 / 3)));
+    const int height = std::max(16, (int)std::lround(megapixels * 1e6 / width));
+
+    cv::Mat carrier(height, width, CV_MAKETYPE(depth, channels));
+
+    std::uint64_t state = 0x9e3779b97f4a7c15ULL;
+
+    for (int row = 0; row < carrier.rows; row++)
+    {
+        unsigned char *it = carrier.ptr<unsigned char>(row);
+        unsigned char *en = it + (carrier.cols * carrier.elemSize());
+
+        for (; it != en; ++it)
+        {
+            // xorshift64
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+
+            *it = 96 + (state & 63);
+        }
+    }
+
+    return carrier;
+}
+
+/**
+ * Generate a payload filled with deterministic noise.
+ */
+std::vector<unsigned char> generate_payload(const std::size_t &size)
+{
+    std::vector<unsigned char> payload(size);
+    std::uint32_t state = 2463534242U;
+
+    for (unsigned char &byte : payload)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        byte = (unsigned char)state;
+    }
+
+    return payload;
+}
+
+/**
+ * @return The number of payload bytes a carrier can hold using the technique,
+ * with the default layout the carrier is opened with, after the container
+ * header and the filename.
+ */
+std::size_t capacity(const std::string &technique, const cv::Mat &carrier)
+{
+    std::size_t bits;
+    std::size_t payload_start;
+
+    if (technique == "lsb")
+    {
+        bits = LeastSignificantBit::LayoutCapacity(carrier.rows, carrier.cols, carrier.channels(), 1);
+        payload_start = LeastSignificantBit::LayoutPayloadStart(1, PAYLOAD_FILENAME.size());
+    }
+    else
+    {
+        const int channels = DiscreteCosineTransform::LayoutChannels(carrier.channels(), 1);
+
+        bits = DiscreteCosineTransform::LayoutCapacity(carrier.rows, carrier.cols, channels, 1);
+        payload_start = DiscreteCosineTransform::LayoutPayloadStart(channels, 1, PAYLOAD_FILENAME.size());
+    }
+
+    return (bits > payload_start) ? (bits - payload_start) / 8 : 0;
+}
+
+/**
+ * Open a carrier image using the given technique.
+ */
+std::unique_ptr<Steganography> open(const std::string &technique, const cv::Mat &carrier)
+{
+    if (technique == "lsb")
+    {
+        return std::unique_ptr<Steganography>(new LeastSignificantBit(carrier));
+    }
+
+    return std::unique_ptr<Steganography>(new DiscreteCosineTransform(carrier, 10));
+}
+
+/**
+ * Time encoding and decoding a payload, encoding includes preparing the carrier
+ * image and decoding includes preparing the steganographic image; neither
+ * includes compressing or decompressing the image.
+ */
+void benchmark(const std::string &technique, const cv::Mat &carrier, const std::vector<unsigned char> &payload,
+        const int &repetitions, Measurement *encode, Measurement *decode)
+{
+    for (int repetition = 0; repetition < repetitions; repetition++)
+    {
+        // The pixels are shared with the technique and modified in place, so start from a fresh copy
+        cv::Mat image = carrier.clone();
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        {
+            std::unique_ptr<Steganography> steganography = open(technique, image);
+            steganography->Embed(PAYLOAD_FILENAME, payload.data(), payload.size());
+
+            image = steganography->Image();
+        }
+        encode->seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+        start = std::chrono::steady_clock::now();
+        {
+            std::unique_ptr<Steganography> steganography = open(technique, image);
+            steganography->DecodeBuffer();
+        }
+        decode->seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+/**
+ * @return The nearest rank percentile of the sorted latencies.
+ */
+double percentile(const std::vector<double> &sorted, const double &rank)
+{
+    std::size_t index = (std::size_t)std::ceil(rank * sorted.size());
+    return sorted[std::min(sorted.size() - 1, index > 0 ? index - 1 : 0)];
+}
+
+/**
+ * Format a measurement as a single line JSON object, so results from two
+ * builds can be compared using diff.
+ */
+std::string format_measurement(const Measurement &measurement)
+{
+    std::vector<double> sorted = measurement.seconds;
+    std::sort(sorted.begin(), sorted.end());
+
+    const double median = percentile(sorted, 0.5);
+
+    std::ostringstream json;
+    json << "{\"technique\": \"" << measurement.technique << "\", "
+         << "\"operation\": \"" << measurement.operation << "\", "
+         << "\"width\": " << measurement.width << ", "
+         << "\"height\": " << measurement.height << ", "
+         << "\"channels\": " << measurement.channels << ", "
+         << "\"depth\": " << (measurement.depth == CV_8U ? 8 : 16) << ", "
+         << "\"payload_bytes\": " << measurement.payload_size << ", "
+         << "\"threads\": " << measurement.threads << ", "
+         << "\"repetitions\": " << sorted.size() << ", "
+         << "\"mb_per_second\": " << ((median > 0) ? (measurement.payload_size / 1e6) / median : 0) << ", "
+         << "\"p50_ms\": " << (median * 1e3) << ", "
+         << "\"p90_ms\": " << (percentile(sorted, 0.9) * 1e3) << ", "
+         << "\"p99_ms\": " << (percentile(sorted, 0.99) * 1e3) << "}";
+
+    return json.str();
+}
+
+int main(int argc, char **argv)
+{
+    optparse::OptionParser parser = optparse::OptionParser()
+        .usage("%prog [options]\n\n"
+            "Measure the throughput of the LSB and DCT techniques using synthetic carrier images");
+
+    parser.add_option("-o", "--output")
+        .help("path to write the results to as JSON")
+        .type("string")
+        .set_default("bench.json");
+
+    parser.add_option("-m", "--max-megapixels")
+        .help("skip carrier images larger than this many megapixels")
+        .type("float")
+        .set_default(100);
+
+    parser.add_option("-r", "--repetitions")
+        .help("number of times each benchmark is repeated")
+        .type("int")
+        .set_default(5);
+
+    parser.add_option("-t", "--technique")
+        .help("only benchmark the 'lsb' or 'dct' technique")
+        .type("string")
+        .set_default("");
+
+    const optparse::Values options = parser.parse_args(argc, argv);
+
+    const double max_megapixels = options.get("max_megapixels");
+    const int repetitions = std::max(1, (int)options.get("repetitions"));
+    const std::string only_technique = options.get("technique");
+
+    // Double the number of threads up to the number of hardware threads
+    std::vector<unsigned int> thread_counts;
+    const unsigned int hardware_threads = std::max(std::thread::hardware_concurrency(), 1U);
+
+    for (unsigned int threads = 1; threads < hardware_threads; threads *= 2)
+    {
+        thread_counts.push_back(threads);
+    }
+
+    thread_counts.push_back(hardware_threads);
+
+    std::vector<std::string> results;
+
+    for (const double &megapixels : MEGAPIXELS)
+    {
+        if (megapixels > max_megapixels)
+        {
+            continue;
+        }
+
+        for (const int &depth : DEPTHS)
+        {
+            for (const int &channels : CHANNELS)
+            {
+                const cv::Mat carrier = generate_carrier(megapixels, channels, depth);
+
+                for (const std::string technique : {"lsb", "dct"})
+                {
+                    // The DCT technique always writes 8 bit images
+                    if ((!only_technique.empty() && technique != only_technique) || (technique == "dct" && depth != CV_8U))
+                    {
+                        continue;
+                    }
+
+                    for (const std::size_t &payload_size : PAYLOAD_SIZES)
+                    {
+                        if (payload_size > capacity(technique, carrier))
+                        {
+                            continue;
+                        }
+
+                        const std::vector<unsigned char> payload = generate_payload(payload_size);
+
+                        for (const unsigned int &threads : thread_counts)
+                        {
+                            ThreadPool::SetThreads(threads);
+
+                            Measurement encode = {technique, "encode", carrier.cols, carrier.rows, channels, depth, payload_size, threads, {}};
+                            Measurement decode = encode;
+                            decode.operation = "decode";
+
+                            try
+                            {
+                                benchmark(technique, carrier, payload, repetitions, &encode, &decode);
+                            }
+                            catch (std::exception &e)
+                            {
+                                std::cerr << technique << " " << carrier.cols << "x" << carrier.rows << "x" << channels
+                                          << ": " << e.what() << std::endl;
+                                continue;
+                            }
+
+                            results.push_back(format_measurement(encode));
+                            results.push_back(format_measurement(decode));
+
+                            std::cout << results[results.size() - 2] << std::endl
+                                      << results[results.size() - 1] << std::endl;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::ofstream output(std::string(options.get("output")));
+    output << "{\"hardware_threads\": " << hardware_threads << ", \"results\": [" << std::endl;
+
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+        output << "    " << results[i] << ((i + 1 < results.size()) ? "," : "") << std::endl;
+    }
+
+    output << "]}" << std::endl;
+
+    if (!output.good())
+    {
+        std::cerr << "Error: Failed to write \"" << std::string(options.get("output")) << "\"" << std::endl;
+        exit(1);
+    }
+}
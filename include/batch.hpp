@@ -0,0 +1,190 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "steganography.hpp"
+#include "payload.hpp"
+#include "exceptions.hpp"
+
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+/**
+ * A single payload which is to be encoded into a carrier image.
+ */
+struct BatchJob
+{
+    boost::filesystem::path carrier_path;
+    boost::filesystem::path payload_path;
+    std::string technique;
+    boost::filesystem::path output_path;
+};
+
+/**
+ * The outcome of running a batch of jobs.
+ */
+struct BatchReport
+{
+    std::size_t completed;
+    std::vector<std::string> errors;
+    double seconds;
+};
+
+/**
+ * Encodes many payloads into many carrier images within a single process.
+ *
+ * The jobs flow through a pipeline of three stages; reading (decoding the
+ * carrier image and mapping the payload), embedding and writing (encoding the
+ * steganographic image and writing it to disk). Each stage has its own worker
+ * threads and the stages are joined by bounded queues, so the image decoding and
+ * compression of some jobs overlaps with the embedding of others whilst the
+ * number of images held in memory stays bounded.
+ */
+class BatchEncoder
+{
+    public:
+        /**
+         * Default constructor for the BatchEncoder class.
+         * @param threads The number of worker threads in each stage of the pipeline.
+         * @param persistence The persistence value used by jobs using the DCT and JPEG techniques.
+         */
+        BatchEncoder(const unsigned int &threads, const int &persistence);
+
+        /**
+         * Read a manifest of jobs. Each line of the manifest is a tab separated
+         * carrier path, payload path and optionally the technique and output path.
+         * Blank lines and lines starting with "#" are ignored.
+         *
+         * @param manifest_path The path to the manifest.
+         * @param technique The technique used by jobs which don't specify one.
+         * @return The jobs listed in the manifest.
+         * @exception EncodeException Thrown when the manifest can't be read.
+         */
+        static std::vector<BatchJob> ReadManifest(const boost::filesystem::path &manifest_path, const std::string &technique);
+
+        /**
+         * Run each of the jobs through the pipeline, a job which fails is
+         * reported and does not stop the remaining jobs.
+         *
+         * @param jobs The jobs to run.
+         * @return The number of jobs completed, the errors from those which failed
+         * and the time taken.
+         */
+        BatchReport Run(const std::vector<BatchJob> &jobs);
+
+        /**
+         * Set the number of least significant bits of each sample used by jobs
+         * using the LSB technique.
+         *
+         * @param bits The number of bits per sample, between 1 and 4.
+         */
+        void SetBitsPerSample(const int &bits);
+
+        /**
+         * Set the number of channels and coefficient pairs of each block used by
+         * jobs using the DCT technique.
+         *
+         * @param channels The number of colour channels, 0 uses every colour channel.
+         * @param pairs The number of coefficient pairs, 1, 2, 4 or 8.
+         */
+        void SetLayout(const int &channels, const int &pairs);
+
+        /**
+         * Set the matrix embedding used by jobs using the DCT technique.
+         *
+         * @param bits The number of payload bits in each group of 2^bits - 1
+         * blocks, 0 disables matrix embedding.
+         */
+        void SetMatrixEmbedding(const int &bits);
+
+        /**
+         * Embed jobs using the DCT technique with its fixed point kernels.
+         *
+         * @param fixed_point Whether to use the fixed point path when encoding.
+         */
+        void SetFixedPoint(const bool &fixed_point);
+
+    private:
+        /**
+         * A job which is moving through the pipeline.
+         */
+        struct Task
+        {
+            const BatchJob *job;
+            std::unique_ptr<Steganography> steganography;
+            std::unique_ptr<PayloadReader> payload;
+        };
+
+        /**
+         * @property threads
+         * The number of worker threads in each stage of the pipeline.
+         */
+        unsigned int threads;
+
+        /**
+         * @property persistence
+         * The persistence value used by jobs using the DCT and JPEG techniques.
+         */
+        int persistence;
+
+        /**
+         * @property bits_per_sample
+         * The number of least significant bits of each sample used by the LSB technique.
+         */
+        int bits_per_sample;
+
+        /**
+         * @property channels
+         * The number of colour channels of each block used by the DCT technique.
+         */
+        int channels;
+
+        /**
+         * @property pairs
+         * The number of coefficient pairs of each channel used by the DCT technique.
+         */
+        int pairs;
+
+        /**
+         * @property matrix_bits
+         * The matrix embedding used by the DCT technique, 0 when disabled.
+         */
+        int matrix_bits;
+
+        /**
+         * @property fixed_point
+         * Whether the DCT technique embeds using its fixed point kernels.
+         */
+        bool fixed_point;
+
+        /**
+         * Open the carrier image of a job using the job's technique, configured
+         * with the layout of the batch.
+         *
+         * @param job The job to open the carrier of.
+         * @return The technique which will embed the payload.
+         * @exception ImageException Thrown when the carrier can't be opened.
+         * @exception EncodeException Thrown when the technique is unknown.
+         */
+        std::unique_ptr<Steganography> Open(const BatchJob &job);
+};
+
+#endif // BATCH_HPP
@@ -0,0 +1,121 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <cstddef>
+#include <string>
+
+#ifndef BIT_KERNELS_HPP
+#define BIT_KERNELS_HPP
+
+/**
+ * Embed a payload into the least significant bits of a contiguous carrier.
+ *
+ * Each payload byte is spread across eight consecutive carrier bytes, least
+ * significant bit first. The fastest kernel supported by the CPU (AVX2, SSE2 or
+ * scalar) is selected the first time this function is called.
+ *
+ * @param carrier The first carrier byte, must have room for length * 8 bytes.
+ * @param payload The payload bytes which will be embedded.
+ * @param length The number of payload bytes to embed.
+ */
+void EmbedBits(unsigned char *carrier, const unsigned char *payload, std::size_t length);
+
+/**
+ * Extract a payload from the least significant bits of a contiguous carrier.
+ *
+ * This is the inverse of EmbedBits, each payload byte is packed from the least
+ * significant bits of eight consecutive carrier bytes.
+ *
+ * @param carrier The first carrier byte, must contain length * 8 bytes.
+ * @param payload The buffer which the extracted bytes will be written to.
+ * @param length The number of payload bytes to extract.
+ */
+void ExtractBits(const unsigned char *carrier, unsigned char *payload, std::size_t length);
+
+/**
+ * A kernel behind EmbedBits, which embeds each payload byte into the least
+ * significant bits of eight consecutive carrier bytes.
+ *
+ * @param carrier The first carrier byte, must have room for length * 8 bytes.
+ * @param payload The payload bytes which will be embedded.
+ * @param length The number of payload bytes to embed.
+ */
+typedef void (*EmbedKernel)(unsigned char *carrier, const unsigned char *payload, std::size_t length);
+
+/**
+ * A kernel behind ExtractBits, the inverse of an EmbedKernel.
+ *
+ * @param carrier The first carrier byte, must contain length * 8 bytes.
+ * @param payload The buffer which the extracted bytes will be written to.
+ * @param length The number of payload bytes to extract.
+ */
+typedef void (*ExtractKernel)(const unsigned char *carrier, unsigned char *payload, std::size_t length);
+
+/**
+ * Look up the kernels which EmbedBits/ExtractBits select between, so that each
+ * one can be run on its own. Whether the CPU supports the instruction set must
+ * be checked by the caller.
+ *
+ * @param instruction_set The instruction set of the kernels, "avx2", "sse2" or "scalar".
+ * @param embed Set to the embedding kernel.
+ * @param extract Set to the extraction kernel.
+ * @return Whether the kernels were built for the instruction set.
+ */
+bool LookupBitKernels(const std::string &instruction_set, EmbedKernel *embed, ExtractKernel *extract);
+
+/**
+ * A kernel which embeds whole units of a payload into contiguous samples, a
+ * unit is k payload bytes spread across eight samples k bits at a time.
+ *
+ * @param carrier The first byte of the first sample, must have room for units * 8 samples.
+ * @param payload The payload bytes which will be embedded.
+ * @param units The number of units to embed.
+ */
+typedef void (*SampleEmbedKernel)(unsigned char *carrier, const unsigned char *payload, std::size_t units);
+
+/**
+ * A kernel which extracts whole units of a payload from contiguous samples, the
+ * inverse of a SampleEmbedKernel.
+ *
+ * @param carrier The first byte of the first sample, must contain units * 8 samples.
+ * @param payload The buffer which the extracted bytes will be written to.
+ * @param units The number of units to extract.
+ */
+typedef void (*SampleExtractKernel)(const unsigned char *carrier, unsigned char *payload, std::size_t units);
+
+/**
+ * Select the embedding kernel which is specialised for a sample size and number
+ * of bits per sample. Payload bits fill each sample least significant bit first,
+ * 8-bit samples with a single bit per sample use EmbedBits.
+ *
+ * @param sample_size The size of each sample in bytes, 1 or 2.
+ * @param bits The number of least significant bits used in each sample, 1 to 4.
+ * @return The kernel, or null when the combination isn't supported.
+ */
+SampleEmbedKernel SelectSampleEmbedKernel(const std::size_t &sample_size, const int &bits);
+
+/**
+ * Select the extraction kernel which is specialised for a sample size and number
+ * of bits per sample, the inverse of SelectSampleEmbedKernel.
+ *
+ * @param sample_size The size of each sample in bytes, 1 or 2.
+ * @param bits The number of least significant bits used in each sample, 1 to 4.
+ * @return The kernel, or null when the combination isn't supported.
+ */
+SampleExtractKernel SelectSampleExtractKernel(const std::size_t &sample_size, const int &bits);
+
+#endif // BIT_KERNELS_HPP
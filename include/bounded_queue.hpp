@@ -0,0 +1,148 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+/**
+ * A blocking first in first out queue with a fixed capacity, used to pass work
+ * between the stages of a pipeline.
+ *
+ * Producers block whilst the queue is full, so a fast stage can't run further
+ * ahead of a slow stage than the capacity of the queue between them.
+ *
+ * @tparam T The type of the items in the queue, must be movable.
+ */
+template <class T>
+class BoundedQueue
+{
+    public:
+        /**
+         * Default constructor for the BoundedQueue class.
+         * @param capacity The maximum number of items held in the queue.
+         */
+        explicit BoundedQueue(const std::size_t &capacity) : capacity(capacity), closed(false)
+        {
+        }
+
+        BoundedQueue(const BoundedQueue &) = delete;
+        BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+        /**
+         * Add an item to the back of the queue, waiting whilst the queue is full.
+         *
+         * @param item The item to add.
+         * @return Whether the item was added, false once the queue is closed.
+         */
+        bool Push(T item)
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->not_full.wait(lock, [this]() { return this->closed || this->items.size() < this->capacity; });
+
+            if (this->closed)
+            {
+                return false;
+            }
+
+            this->items.push_back(std::move(item));
+            this->not_empty.notify_one();
+
+            return true;
+        }
+
+        /**
+         * Remove an item from the front of the queue, waiting whilst the queue is
+         * empty.
+         *
+         * @param item Set to the removed item.
+         * @return Whether an item was removed, false once the queue is closed and
+         * empty.
+         */
+        bool Pop(T *item)
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->not_empty.wait(lock, [this]() { return this->closed || !this->items.empty(); });
+
+            if (this->items.empty())
+            {
+                return false;
+            }
+
+            *item = std::move(this->items.front());
+            this->items.pop_front();
+            this->not_full.notify_one();
+
+            return true;
+        }
+
+        /**
+         * Stop accepting items, the items which are already queued can still be
+         * removed.
+         */
+        void Close()
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->closed = true;
+
+            this->not_full.notify_all();
+            this->not_empty.notify_all();
+        }
+
+    private:
+        /**
+         * @property capacity
+         * The maximum number of items held in the queue.
+         */
+        std::size_t capacity;
+
+        /**
+         * @property closed
+         * Whether the queue has stopped accepting items.
+         */
+        bool closed;
+
+        /**
+         * @property items
+         * The queued items, oldest first.
+         */
+        std::deque<T> items;
+
+        /**
+         * @property mutex
+         * Guards the items and the closed flag.
+         */
+        std::mutex mutex;
+
+        /**
+         * @property not_full
+         * Signalled when an item is removed or the queue is closed.
+         */
+        std::condition_variable not_full;
+
+        /**
+         * @property not_empty
+         * Signalled when an item is added or the queue is closed.
+         */
+        std::condition_variable not_empty;
+};
+
+#endif // BOUNDED_QUEUE_HPP
@@ -0,0 +1,155 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "carrier_info.hpp"
+#include "exceptions.hpp"
+
+#ifndef CARRIER_INDEX_HPP
+#define CARRIER_INDEX_HPP
+
+/**
+ * A carrier image of a pool, as recorded in the pool's index.
+ */
+struct IndexEntry
+{
+    boost::filesystem::path path;
+    std::uintmax_t size;
+    std::time_t modified;
+    uint32_t hash;
+    CarrierInfo info;
+};
+
+/**
+ * An index of the carrier images in a directory, so that a carrier which fits a
+ * payload can be picked without opening any of the others.
+ *
+ * The index is stored in a hidden directory of the pool as a tab separated file,
+ * one carrier per line, giving its path relative to the pool, size, modification
+ * time, CRC-32C of its contents and the properties read from its header. The
+ * capacity of each technique and layout is calculated from these properties.
+ *
+ * The modification time of each directory of the pool is recorded alongside, a
+ * directory only changes when a file is added to, removed from or renamed within
+ * it. Updating the index only lists the directories which changed and only reads
+ * the carriers which were added or changed since it was last updated, so while
+ * the pool is unchanged an update stats its directories and nothing else.
+ */
+class CarrierIndex
+{
+    public:
+        /**
+         * Default constructor for the CarrierIndex class, loads the index of the
+         * pool if it has one. Malformed lines are dropped, and are indexed again
+         * by the next update.
+         * @param pool_path The path to the directory of carrier images.
+         * @exception EncodeException Thrown when the pool isn't a directory.
+         */
+        explicit CarrierIndex(const boost::filesystem::path &pool_path);
+
+        /**
+         * Bring the index up to date with the pool; adding the carriers which are
+         * new or have changed size or modification time and removing those which
+         * no longer exist. Files which aren't PNG, JPEG or TIFF images are left
+         * out. The index is saved when it changes.
+         *
+         * A carrier rewritten in place doesn't change its directory, so it's
+         * only noticed when it's picked.
+         *
+         * @return The number of carriers which were added or indexed again.
+         * @exception EncodeException Thrown when the pool can't be read or the
+         * index can't be saved.
+         */
+        std::size_t Update();
+
+        /**
+         * @return The carriers of the index, in the order of their paths.
+         */
+        const std::vector<IndexEntry> &Entries() const;
+
+        /**
+         * Pick the carrier with the smallest capacity which fits the payload.
+         * The carriers are sorted by their capacity with each layout the first
+         * time it's used, after which each pick is a binary search. The picked
+         * carrier is checked against the pool, and indexed again if it changed.
+         *
+         * @param layout The technique and layout the payload will be encoded with.
+         * @param payload_size The size of the payload in bytes.
+         * @param filename_length The length of the payload's filename in bytes.
+         * @return The path to the carrier.
+         * @exception EncodeException Thrown when no carrier is large enough.
+         */
+        boost::filesystem::path Select(const CarrierLayout &layout, const std::size_t &payload_size,
+                const std::size_t &filename_length);
+
+    private:
+        /**
+         * @property pool_path
+         * The path to the directory of carrier images.
+         */
+        boost::filesystem::path pool_path;
+
+        /**
+         * @property entries
+         * The carriers of the index, in the order of their paths.
+         */
+        std::vector<IndexEntry> entries;
+
+        /**
+         * @property directories
+         * The modification time in nanoseconds of each directory of the pool when
+         * it was last listed, keyed by its path relative to the pool.
+         */
+        std::map<std::string, int64_t> directories;
+
+        /**
+         * @property capacities
+         * The index of each carrier keyed by its capacity, for each layout and
+         * filename length which has been picked for.
+         */
+        std::map<std::string, std::multimap<std::size_t, std::size_t>> capacities;
+
+        /**
+         * Bring a directory of the pool, and the directories within it, up to date.
+         *
+         * @param directory The path of the directory relative to the pool.
+         * @param files The previous entries of each directory, by their paths.
+         * @param subdirectories The previous subdirectories of each directory.
+         * @param entries The entries of the updated index.
+         * @param directories The directories of the updated index.
+         * @return The number of carriers which were added or indexed again.
+         */
+        std::size_t Scan(const boost::filesystem::path &directory,
+                const std::map<std::string, std::vector<const IndexEntry *>> &files,
+                const std::map<std::string, std::vector<std::string>> &subdirectories,
+                std::vector<IndexEntry> *entries, std::map<std::string, int64_t> *directories) const;
+
+        /**
+         * Write the index to the pool, replacing the previous index as a whole.
+         *
+         * @exception EncodeException Thrown when the index can't be written.
+         */
+        void Save() const;
+};
+
+#endif // CARRIER_INDEX_HPP
@@ -0,0 +1,95 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "exceptions.hpp"
+
+#ifndef CARRIER_INFO_HPP
+#define CARRIER_INFO_HPP
+
+/**
+ * The properties of a carrier image which decide its capacity, read from the
+ * header of the image without decoding any pixels. The channels and depth are
+ * those cv::imread with cv::IMREAD_UNCHANGED would give.
+ */
+struct CarrierInfo
+{
+    std::string format;
+    int rows;
+    int cols;
+    int channels;
+    int depth;
+    std::size_t blocks;
+};
+
+/**
+ * A technique and those of its parameters which change its capacity.
+ */
+struct CarrierLayout
+{
+    std::string technique;
+    int bits_per_sample;
+    int channels;
+    int pairs;
+};
+
+/**
+ * Read the properties of a carrier image from the IHDR and tRNS chunks of a PNG,
+ * the SOF segment of a JPEG or the first IFD of a TIFF.
+ *
+ * @param image_path The path to the image.
+ * @return The format, dimensions, channels and bits per sample of the image,
+ * and for a JPEG the number of 8x8 blocks of its first component.
+ * @exception ImageException Thrown when the image can't be read or isn't a PNG,
+ * JPEG or TIFF.
+ */
+CarrierInfo ReadCarrierInfo(const boost::filesystem::path &image_path);
+
+/**
+ * List every layout which can be used with a carrier image; each number of bits
+ * per sample of the LSB technique, each number of channels and pairs of the DCT
+ * technique, and the JPEG technique for JPEG images.
+ *
+ * @param info The properties of the carrier image.
+ * @return The layouts.
+ */
+std::vector<CarrierLayout> CarrierLayouts(const CarrierInfo &info);
+
+/**
+ * Name a layout by its technique and parameters e.g. "lsb:2", "dct:3x4" for 3
+ * channels of 4 pairs, or "jpeg".
+ *
+ * @param layout The layout.
+ * @return The name of the layout.
+ */
+std::string LayoutName(const CarrierLayout &layout);
+
+/**
+ * Calculate the largest payload a carrier image can store using a layout.
+ *
+ * @param info The properties of the carrier image.
+ * @param layout The layout, the channels of the DCT technique are resolved as
+ * DiscreteCosineTransform::SetLayout.
+ * @param filename_length The length of the payload's filename in bytes.
+ * @return The size of the largest payload in bytes.
+ */
+std::size_t PayloadCapacity(const CarrierInfo &info, const CarrierLayout &layout, const std::size_t &filename_length);
+
+#endif // CARRIER_INFO_HPP
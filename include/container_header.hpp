@@ -0,0 +1,113 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cstddef>
+#include <cstdint>
+#include "exceptions.hpp"
+
+#ifndef CONTAINER_HEADER_HPP
+#define CONTAINER_HEADER_HPP
+
+// The size of the container header in bytes, and of the magic at its start
+const std::size_t HEADER_SIZE = 32;
+const std::size_t MAGIC_SIZE = 4;
+
+// The header is always embedded one bit per slot, so it occupies this many slots of every technique
+const std::size_t HEADER_BITS = HEADER_SIZE * 8;
+
+// The version of the bitstream written by this build
+const unsigned char CONTAINER_VERSION = 1;
+
+// The identifiers of each technique, as stored in the header
+const unsigned char TECHNIQUE_LSB = 1;
+const unsigned char TECHNIQUE_DCT = 2;
+const unsigned char TECHNIQUE_JPEG = 3;
+
+/**
+ * The fixed size header at the start of the bitstream of every technique.
+ *
+ * It records how the rest of the bitstream was embedded, so a decoder can
+ * reject a carrier which holds no payload after reading the magic and check the
+ * payload against its CRC-32C once it's decoded. Every field is stored least
+ * significant byte first:
+ *
+ *   0  magic             4 bytes, 0x89 'S' 'T' 'G'
+ *   4  version           1 byte
+ *   5  technique         1 byte
+ *   6  persistence       2 bytes, DCT/JPEG only
+ *   8  bits per sample   1 byte, LSB only
+ *   9  channels          1 byte, DCT only
+ *   10 pairs             1 byte, DCT only
+ *   11 matrix bits       1 byte, DCT only
+ *   12 filename length   4 bytes
+ *   16 payload length    8 bytes
+ *   24 payload CRC-32C   4 bytes
+ *   28 header CRC-32C    4 bytes, of the preceding 28 bytes
+ */
+struct ContainerHeader
+{
+    unsigned char technique;
+    int persistence;
+    int bits_per_sample;
+    int channels;
+    int pairs;
+    int matrix_bits;
+    std::size_t filename_length;
+    std::size_t payload_length;
+    uint32_t payload_crc;
+};
+
+/**
+ * Serialise a container header.
+ * @param header The header to serialise.
+ * @param bytes The buffer to write to, must have room for HEADER_SIZE bytes.
+ */
+void StoreHeader(const ContainerHeader &header, unsigned char *bytes);
+
+/**
+ * @param bytes The first MAGIC_SIZE bytes of a bitstream.
+ * @return Whether the bytes are the magic which starts every container header.
+ */
+bool HasMagic(const unsigned char *bytes);
+
+/**
+ * Parse and validate a container header.
+ * @param bytes The serialised header, HEADER_SIZE bytes.
+ * @param technique The technique which is decoding the header.
+ * @return The parsed header.
+ * @exception DecodeException Thrown when there is no header, it's corrupt, it's
+ * from a newer version or it was written by a different technique.
+ */
+ContainerHeader LoadHeader(const unsigned char *bytes, const unsigned char &technique);
+
+/**
+ * Check that the filename and payload described by a header fit in a carrier.
+ * @param header The parsed header.
+ * @param payload_start The bit index which the payload starts at.
+ * @param capacity The capacity of the carrier in bits.
+ * @exception DecodeException Thrown when they run past the end of the carrier.
+ */
+void CheckCapacity(const ContainerHeader &header, const std::size_t &payload_start, const std::size_t &capacity);
+
+/**
+ * Check a decoded payload against the checksum stored in its header.
+ * @param header The parsed header.
+ * @param payload_crc The CRC-32C of the decoded payload.
+ * @exception DecodeException Thrown when the checksums differ.
+ */
+void VerifyPayload(const ContainerHeader &header, const uint32_t &payload_crc);
+
+#endif // CONTAINER_HEADER_HPP
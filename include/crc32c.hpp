@@ -0,0 +1,38 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cstddef>
+#include <cstdint>
+
+#ifndef CRC32C_HPP
+#define CRC32C_HPP
+
+/**
+ * Extend the CRC-32C (Castagnoli) checksum of a buffer with more bytes.
+ *
+ * The SSE4.2 crc32 instruction is used when the CPU supports it, otherwise a
+ * table driven scalar kernel, either is selected the first time this function
+ * is called. A buffer split into several parts has the same checksum as the
+ * whole buffer when each part extends the checksum of the previous one.
+ *
+ * @param crc The checksum of the preceding bytes, 0 for the first part.
+ * @param data The bytes to add to the checksum.
+ * @param length The number of bytes to add.
+ * @return The checksum of the preceding bytes followed by data.
+ */
+uint32_t Crc32c(const uint32_t &crc, const unsigned char *data, std::size_t length);
+
+#endif // CRC32C_HPP
@@ -0,0 +1,55 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <cstddef>
+
+#ifndef DCT_KERNELS_HPP
+#define DCT_KERNELS_HPP
+
+/**
+ * Embed one bit into each of eight horizontally adjacent 8x8 blocks of 8-bit
+ * samples, using fixed point arithmetic straight on the samples.
+ *
+ * This is the fixed point equivalent of swapping the (0, 2) and (2, 0) DCT
+ * coefficients of each block; the two coefficients are calculated exactly from
+ * the integer row and column sums of the block, and the change to them is
+ * applied to the samples in 1/16ths. The result is decodable by comparing the
+ * floating point coefficients at the same persistence. The eight blocks are
+ * processed together using the fastest kernel supported by the CPU (AVX2,
+ * SSE4.1 or scalar), which is selected the first time this function is called.
+ *
+ * @param pixels The first sample of the first block.
+ * @param row_step The distance in bytes between two rows of samples.
+ * @param pixel_step The distance in bytes between two adjacent samples.
+ * @param bits Bit n is embedded into block n.
+ * @param persistence The persistence value, saturated to +/-65535.
+ */
+void EmbedBlocks(unsigned char *pixels, std::ptrdiff_t row_step, std::size_t pixel_step, unsigned char bits, int persistence);
+
+/**
+ * Embed one bit into a single 8x8 block of 8-bit samples, using the same fixed
+ * point arithmetic as EmbedBlocks.
+ *
+ * @param pixels The first sample of the block.
+ * @param row_step The distance in bytes between two rows of samples.
+ * @param pixel_step The distance in bytes between two adjacent samples.
+ * @param bit The bit to embed.
+ * @param persistence The persistence value, saturated to +/-65535.
+ */
+void EmbedBlock(unsigned char *pixels, std::ptrdiff_t row_step, std::size_t pixel_step, int bit, int persistence);
+
+#endif // DCT_KERNELS_HPP
@@ -17,7 +17,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include <iostream>
 #include <string>
-#include <thread>
 #include <tuple>
 #include <vector>
 #include <boost/filesystem.hpp>
@@ -25,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include "steganography.hpp"
+#include "container_header.hpp"
 #include "exceptions.hpp"
 
 #ifndef DISCRETE_COSINE_TRANSFORM_HPP
@@ -41,12 +41,29 @@ class DiscreteCosineTransform : public Steganography
          */
         explicit DiscreteCosineTransform(const boost::filesystem::path &image_path, int persistence) : Steganography(image_path)
         {
-            this->persistence = persistence;
-            this->image_capacity = ((this->image.rows - 8) / 8) * ((this->image.cols - 8) / 8);
+            this->Initialise(persistence);
+        }
 
-            // Convert the image to floating point and split the channels
-            this->image.convertTo(this->image, CV_32F);
-            cv::split(this->image, this->channels);
+        /**
+         * Constructor for the DiscreteCosineTransform class which uses a carrier
+         * image that is already in memory.
+         * @param image The carrier image.
+         * @param persistence The persistence value for this instance.
+         */
+        DiscreteCosineTransform(const cv::Mat &image, int persistence) : Steganography(image)
+        {
+            this->Initialise(persistence);
+        }
+
+        /**
+         * Constructor for the DiscreteCosineTransform class which decodes the
+         * carrier image from the contents of an image file held in memory.
+         * @param image_bytes The encoded carrier image.
+         * @param persistence The persistence value for this instance.
+         */
+        DiscreteCosineTransform(const std::vector<unsigned char> &image_bytes, int persistence) : Steganography(image_bytes)
+        {
+            this->Initialise(persistence);
         }
 
         /**
@@ -63,14 +80,180 @@ class DiscreteCosineTransform : public Steganography
          */
         void Decode();
 
-    private:
         /**
-         * @property
-         * The color channels from the carrier image, used in the embedding
-         * process.
+         * Embed a payload held in memory into the carrier image.
+         *
+         * @param payload_filename The filename which is stored alongside the payload.
+         * @param payload A pointer to the first byte of the payload.
+         * @param payload_size The size of the payload in bytes.
+         * @exception EncodeException Thrown when encoding fails.
+         */
+        void Embed(const std::string &payload_filename, const unsigned char *payload, const std::size_t &payload_size);
+
+        /**
+         * Encode the steganographic image into memory as a JPEG file.
+         *
+         * @return The encoded steganographic image.
+         */
+        std::vector<unsigned char> EncodeImage();
+
+        /**
+         * Decode the payload from the steganographic image into memory without
+         * touching the filesystem.
+         *
+         * @return The filename and contents of the payload.
+         * @exception DecodeException Thrown when decoding fails.
+         */
+        DecodedPayload DecodeBuffer();
+
+        /**
+         * Decode only the container header and the payload filename from the
+         * steganographic image, without decoding the payload.
+         *
+         * @param payload_filename Set to the filename of the payload.
+         * @return The container header.
+         * @exception DecodeException Thrown when the image doesn't contain a payload.
+         */
+        ContainerHeader Probe(std::string *payload_filename);
+
+        /**
+         * Embed using fixed point arithmetic straight on the 8-bit samples rather
+         * than converting each block to floating point. Eight adjacent blocks are
+         * embedded at once using SIMD where the CPU supports it. The output may
+         * differ slightly from the floating point path, but it's decoded the same
+         * way.
+         *
+         * @param fixed_point Whether to use the fixed point path when encoding.
+         */
+        void SetFixedPoint(const bool &fixed_point);
+
+        /**
+         * Choose how many bits each 8x8 block carries. A bit is stored in each of
+         * the first pairs mid-frequency coefficient pairs, in each of the first
+         * channels colour channels, so every conversion of a block carries
+         * several bits. The same layout must be used to encode and decode.
+         *
+         * @param channels The number of colour channels to embed into, zero or
+         * more than the image has uses every colour channel.
+         * @param pairs The number of coefficient pairs per channel, 1, 2, 4 or 8.
+         * @exception ImageException Thrown when the number of pairs is invalid.
+         */
+        void SetLayout(const int &channels, const int &pairs);
+
+        /**
+         * Use matrix embedding (a Hamming code) for the payload. Each group of
+         * 2^k - 1 slots carries k bits, so that at most one slot of each group
+         * has to be flipped. Slots which already hold their value by at least
+         * twice the persistence are not rewritten at all. The filename and
+         * lengths are always embedded directly, and the payload is never
+         * streamed. The same setting must be used to encode and decode.
+         *
+         * @param bits The number of bits k carried by each group, zero disables
+         * matrix embedding.
+         * @exception ImageException Thrown when bits is not between 0 and 8.
+         */
+        void SetMatrixEmbedding(const int &bits);
+
+        /**
+         * Encode a payload into the carrier image, splitting it into chunks which
+         * are encoded in parallel.
+         *
+         * @param start The bit index to start encoding at.
+         * @param it The position in the payload to start encoding.
+         * @param en The position in the payload to stop encoding.
+         * @exception EncodeException Thrown when the carrier is too small.
+         */
+        void EncodePayload(const std::size_t &start, const unsigned char *it, const unsigned char *en);
+
+        /**
+         * Decode a payload from the steganographic image, splitting it into chunks
+         * which are decoded in parallel.
+         *
+         * @param start The bit index to start decoding at.
+         * @param it The position in the buffer to start decoding into.
+         * @param en The position in the buffer to stop decoding into.
+         * @exception DecodeException Thrown when decoding fails.
+         */
+        void DecodePayload(const std::size_t &start, unsigned char *it, unsigned char *en);
+
+        /**
+         * Get the bit index at which the payload starts, it follows the container
+         * header and the filename.
+         *
+         * @param filename_length The length of the stored filename in bytes.
+         * @return The bit index of the first bit of the payload.
+         */
+        std::size_t PayloadStart(const std::size_t &filename_length) const;
+
+        /**
+         * Get the number of bits the carrier image can store, including the
+         * filename and the lengths.
+         *
+         * @return The capacity of the carrier image in bits.
+         */
+        std::size_t Capacity() const;
+
+        /**
+         * Resolve the number of colour channels embedded into, as SetLayout().
+         *
+         * @param image_channels The number of channels of the carrier image.
+         * @param channels The requested number of channels, zero uses every colour channel.
+         * @return The number of colour channels embedded into.
+         */
+        static int LayoutChannels(const int &image_channels, const int &channels);
+
+        /**
+         * Calculate the capacity of a carrier image from its dimensions alone.
+         *
+         * @param rows The height of the image in pixels.
+         * @param cols The width of the image in pixels.
+         * @param channels The resolved number of colour channels embedded into.
+         * @param pairs The number of coefficient pairs per channel.
+         * @return The capacity of the carrier image in bits.
+         */
+        static std::size_t LayoutCapacity(const int &rows, const int &cols, const int &channels, const int &pairs);
+
+        /**
+         * Calculate the bit index at which the payload starts for a layout, as
+         * PayloadStart().
+         *
+         * @param channels The resolved number of colour channels embedded into.
+         * @param pairs The number of coefficient pairs per channel.
+         * @param filename_length The length of the stored filename in bytes.
+         * @return The bit index of the first bit of the payload.
+         */
+        static std::size_t LayoutPayloadStart(const int &channels, const int &pairs, const std::size_t &filename_length);
+
+    protected:
+        /**
+         * Calculate a single DCT coefficient of an 8x8 block.
+         *
+         * The coefficient is computed as a dot product with its basis function,
+         * which avoids performing the full forward dct when only a couple of
+         * coefficients are required.
+         *
+         * @param block The 8x8 block in the spatial domain.
+         * @param u The row of the coefficient.
+         * @param v The column of the coefficient.
+         * @return The value of the (u, v) DCT coefficient.
+         */
+        float Coefficient(const cv::Mat &block, const int &u, const int &v);
+
+        /**
+         * Add a value to a single DCT coefficient of an 8x8 block.
+         *
+         * The change is applied directly in the spatial domain by adding the scaled
+         * basis function to the block, which avoids performing the full forward and
+         * inverse dct.
+         *
+         * @param block A pointer to the 8x8 block in the spatial domain.
+         * @param u The row of the coefficient.
+         * @param v The column of the coefficient.
+         * @param delta The value which will be added to the coefficient.
          */
-        std::vector<cv::Mat> channels;
+        void AdjustCoefficient(cv::Mat *block, const int &u, const int &v, const float &delta);
 
+    private:
         /**
          * @property persistence
          * Value which will be applied during the DCT coefficient swapping. Higher
@@ -79,52 +262,181 @@ class DiscreteCosineTransform : public Steganography
          */
         int persistence;
 
+        /**
+         * @property fixed_point
+         * Whether blocks are embedded using the fixed point kernels.
+         */
+        bool fixed_point;
+
+        /**
+         * @property channels
+         * The number of colour channels of each block which carry bits.
+         */
+        int channels;
+
+        /**
+         * @property pairs
+         * The number of coefficient pairs of each channel which carry bits.
+         */
+        int pairs;
+
+        /**
+         * @property matrix_bits
+         * The number of payload bits carried by each group of matrix embedded
+         * slots, zero when matrix embedding is disabled.
+         */
+        int matrix_bits;
+
         /**
          * @property
          * The total capacity of the carrier image in bits.
          */
-        int image_capacity;
+        std::size_t image_capacity;
 
         /**
-         * Encode a chunk of information into the carrier image.
+         * Calculate the capacity of the carrier image.
+         *
+         * @param persistence The persistence value for this instance.
+         */
+        void Initialise(const int &persistence);
+
+        /**
+         * Convert the first channel of an 8x8 block of the carrier image to
+         * floating point.
+         *
+         * @param pixels A pointer to the first pixel of the block.
+         * @param block The 64 floats the block is converted into, in row major order.
+         */
+        void ReadBlock(const unsigned char *pixels, float *block);
+
+        /**
+         * Write an 8x8 block back into the first channel of the carrier image,
+         * rounding and saturating it to unsigned char.
          *
-         * Before encoding a chunk of information you "should" first encode its length
-         * using the EncodeChunkLength function.
+         * @param block The 64 floats of the block, in row major order.
+         * @param pixels A pointer to the first pixel of the block.
+         */
+        void WriteBlock(const float *block, unsigned char *pixels);
+
+        /**
+         * Encode the filename into the carrier image, it follows the container
+         * header.
+         *
+         * @param payload_filename The filename which is stored alongside the payload.
+         * @return The bit index at which the payload starts.
+         */
+        std::size_t EncodeFilename(const std::string &payload_filename);
+
+        /**
+         * Encode the container header into the carrier image, the header is
+         * embedded one bit per block in the first channel, so it can be read before the layout is known.
+         *
+         * @param filename_length The length of the filename in bytes.
+         * @param payload_length The length of the payload in bytes.
+         * @param payload_crc The CRC-32C of the payload.
+         */
+        void EncodeHeader(const std::size_t &filename_length, const std::size_t &payload_length, const uint32_t &payload_crc);
+
+        /**
+         * Decode the container header from the steganographic image, rejecting
+         * carriers which don't start with its magic.
+         * Applies the layout and matrix embedding which it records.
+         *
+         * @return The parsed header.
+         * @exception DecodeException Thrown when the carrier holds no payload, or
+         * its header is corrupt.
+         */
+        ContainerHeader DecodeHeader();
+
+        /**
+         * Decode the filename from the steganographic image.
+         *
+         * @param header The container header decoded from the steganographic image.
+         * @param payload_filename Set to the decoded filename.
+         * @return The bit index at which the payload starts.
+         * @exception DecodeException Thrown when decoding fails.
+         */
+        std::size_t DecodeFilename(const ContainerHeader &header, std::string *payload_filename);
+
+        /**
+         * Encode a payload into the carrier image using matrix embedding, the
+         * groups of slots are encoded in parallel.
+         *
+         * @param start The slot index to start encoding at.
+         * @param it The position in the payload to start encoding.
+         * @param en The position in the payload to stop encoding.
+         * @exception EncodeException Thrown when the carrier is too small.
+         */
+        void EncodeMatrix(const std::size_t &start, const unsigned char *it, const unsigned char *en);
+
+        /**
+         * Decode a payload which was encoded using matrix embedding.
+         *
+         * @param start The slot index to start decoding at.
+         * @param it The position in the buffer to start decoding into.
+         * @param en The position in the buffer to stop decoding into.
+         * @exception DecodeException Thrown when decoding fails.
+         */
+        void DecodeMatrix(const std::size_t &start, unsigned char *it, unsigned char *en);
+
+        /**
+         * Read the bit stored in a single slot.
+         *
+         * @param slot The index of the slot.
+         * @param margin Set to the distance between the slot's coefficients.
+         * @return The bit stored in the slot.
+         * @exception DecodeException Thrown when the slot is outside the carrier.
+         */
+        int ReadSlot(const std::size_t &slot, float *margin);
+
+        /**
+         * Store a bit in a single slot, converting only its block channel.
+         *
+         * @param slot The index of the slot.
+         * @param value The bit to store.
+         * @exception EncodeException Thrown when the slot is outside the carrier.
+         */
+        void WriteSlot(const std::size_t &slot, const int &value);
+
+        /**
+         * Encode a chunk of information into the carrier image.
          *
          * @param start The bit index to start encoding at.
          * @param it The position in the chunk of information to start encoding.
          * @param en The position in the chunk of information to stop encoding.
          */
-        void EncodeChunk(const int &start, std::vector<unsigned char>::iterator it, std::vector<unsigned char>::iterator en);
+        void EncodeChunk(const std::size_t &start, const unsigned char *it, const unsigned char *en);
 
         /**
-         * Encode a 32bit integer stating the length of the following chunk into the
-         * carrier image.
+         * Encode a chunk of information using the fixed point kernels, which only
+         * use the first coefficient pair. A byte is encoded at a time when its
+         * blocks are adjacent in a single channel, otherwise a bit at a time.
          *
          * @param start The bit index to start encoding at.
-         * @param chunk_length The length of the next chunk in bytes.
+         * @param it The position in the chunk of information to start encoding.
+         * @param en The position in the chunk of information to stop encoding.
          */
-        void EncodeChunkLength(const int &start, const unsigned int &chunk_length);
+        void EncodeChunkFixed(const std::size_t &start, const unsigned char *it, const unsigned char *en);
 
         /**
          * Attempt to decode a chunk of information from the steganographic image.
          *
          * @param start The bit index to start decoding at.
-         * @param it An iterator to a start position in the payload_bytes vector.
-         * @param en An iterator to an end position in the payload_bytes vector.
+         * @param it The position in the buffer to start decoding into.
+         * @param en The position in the buffer to stop decoding into.
          * @exception DecodeException Thrown when decoding fails.
          */
-        void DecodeChunk(const int start, std::vector<unsigned char>::iterator it, std::vector<unsigned char>::iterator en);
+        void DecodeChunk(const std::size_t &start, unsigned char *it, unsigned char *en);
 
         /**
-         * Attempt to decode the 32bit integer stating the length of the following
-         * chunk.
+         * Create a cursor over the 8x8 blocks of the carrier image, each block is
+         * a slot which stores a bit per coefficient pair in each channel of the
+         * layout.
          *
-         * @param start The bit index to start decoding at.
-         * @return The length of the following chunk.
-         * @exception DecodeException Thrown when decoding fails.
+         * @param slot The slot number the cursor will start at.
+         * @return A cursor positioned at the given slot.
          */
-        unsigned int DecodeChunkLength(const int &start);
+        SlotCursor Seek(const std::size_t &slot);
 
         /**
          * Swap two DCT coefficients.
@@ -132,10 +444,12 @@ class DiscreteCosineTransform : public Steganography
          * Swap two DCT coefficients and apply a persistence value to ensure that the
          * data survives the compression process.
          *
-         * @param block A pointer to the block which is currently be operated on.
+         * @param block A pointer to the block (in the spatial domain) which is
+         * currently be operated on.
+         * @param pair The index of the coefficient pair which stores the value.
          * @param value The value which is being stored, will be 0 or 1.
          */
-        void SwapCoefficients(cv::Mat *block, const int &value);
+        void SwapCoefficients(cv::Mat *block, const int &pair, const int &value);
 };
 
 #endif // DISCRETE_COSINE_TRANSFORM_HPP
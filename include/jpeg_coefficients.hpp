@@ -0,0 +1,268 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "steganography.hpp"
+#include "container_header.hpp"
+#include "exceptions.hpp"
+
+#ifndef JPEG_COEFFICIENTS_HPP
+#define JPEG_COEFFICIENTS_HPP
+
+/**
+ * Hides the payload in the quantised DCT coefficients of a JPEG file.
+ *
+ * The coefficients are read and written by libjpeg without decoding the image
+ * to pixels. There is no inverse or forward DCT and nothing is requantised, so
+ * the output has the same quality as the input and close to the same size.
+ * Each bit is stored in one block of the first component. Like the DCT
+ * technique, it sets the order of the (0, 2) and (2, 0) coefficients.
+ */
+class JpegCoefficients : public Steganography
+{
+    public:
+        /**
+         * Default constructor for the JpegCoefficients class.
+         * @param image_path The path to the input carrier JPEG.
+         * @param persistence The persistence value for this instance.
+         * @exception ImageException Thrown when the image can't be read.
+         */
+        explicit JpegCoefficients(const boost::filesystem::path &image_path, int persistence);
+
+        /**
+         * Constructor for the JpegCoefficients class which reads the coefficients
+         * from the contents of a JPEG file held in memory.
+         * @param image_bytes The encoded carrier JPEG.
+         * @param persistence The persistence value for this instance.
+         * @exception ImageException Thrown when the image can't be read.
+         */
+        JpegCoefficients(const std::vector<unsigned char> &image_bytes, int persistence);
+
+        JpegCoefficients(JpegCoefficients &&other);
+
+        /**
+         * Destructor for the JpegCoefficients class, releases the coefficients.
+         */
+        ~JpegCoefficients();
+
+        /**
+         * Encode the payload file into the coefficients of the carrier JPEG.
+         *
+         * @param payload_path Path to the file we are encoding.
+         * @exception EncodeException Thrown when encoding fails.
+         */
+        void Encode(const boost::filesystem::path &payload_path);
+
+        /**
+         * Decode the payload from the coefficients of the steganographic JPEG.
+         */
+        void Decode();
+
+        /**
+         * Embed a payload held in memory into the coefficients of the carrier JPEG.
+         *
+         * @param payload_filename The filename which is stored alongside the payload.
+         * @param payload A pointer to the first byte of the payload.
+         * @param payload_size The size of the payload in bytes.
+         * @exception EncodeException Thrown when encoding fails.
+         */
+        void Embed(const std::string &payload_filename, const unsigned char *payload, const std::size_t &payload_size);
+
+        /**
+         * Write the coefficients back out as a JPEG file in memory. The Huffman
+         * tables are optimised, and every marker of the input is kept.
+         *
+         * @return The encoded steganographic image.
+         * @exception EncodeException Thrown when the JPEG can't be written.
+         */
+        std::vector<unsigned char> EncodeImage();
+
+        /**
+         * Decode the payload from the steganographic JPEG into memory without
+         * touching the filesystem.
+         *
+         * @return The filename and contents of the payload.
+         * @exception DecodeException Thrown when decoding fails.
+         */
+        DecodedPayload DecodeBuffer();
+
+        /**
+         * Decode only the container header and the payload filename from the
+         * steganographic JPEG, without decoding the payload.
+         *
+         * @param payload_filename Set to the filename of the payload.
+         * @return The container header.
+         * @exception DecodeException Thrown when the image doesn't contain a payload.
+         */
+        ContainerHeader Probe(std::string *payload_filename);
+
+        /**
+         * Encode a payload into the carrier image, splitting it into chunks which
+         * are encoded in parallel.
+         *
+         * @param start The bit index to start encoding at.
+         * @param it The position in the payload to start encoding.
+         * @param en The position in the payload to stop encoding.
+         * @exception EncodeException Thrown when the carrier is too small.
+         */
+        void EncodePayload(const std::size_t &start, const unsigned char *it, const unsigned char *en);
+
+        /**
+         * Decode a payload from the steganographic image, splitting it into chunks
+         * which are decoded in parallel.
+         *
+         * @param start The bit index to start decoding at.
+         * @param it The position in the buffer to start decoding into.
+         * @param en The position in the buffer to stop decoding into.
+         * @exception DecodeException Thrown when decoding fails.
+         */
+        void DecodePayload(const std::size_t &start, unsigned char *it, unsigned char *en);
+
+        /**
+         * Get the bit index at which the payload starts, it follows the container
+         * header and the filename.
+         *
+         * @param filename_length The length of the stored filename in bytes.
+         * @return The bit index of the first bit of the payload.
+         */
+        std::size_t PayloadStart(const std::size_t &filename_length) const;
+
+        /**
+         * Get the number of bits the carrier image can store, including the
+         * filename and the lengths.
+         *
+         * @return The capacity of the carrier image in bits.
+         */
+        std::size_t Capacity() const;
+
+    private:
+        /**
+         * The libjpeg state which owns the coefficients.
+         */
+        struct Coefficients;
+
+        /**
+         * @property coefficients
+         * The coefficients of the carrier JPEG.
+         */
+        std::unique_ptr<Coefficients> coefficients;
+
+        /**
+         * @property persistence
+         * The persistence value which is recorded in the container header.
+         */
+        int persistence;
+
+        /**
+         * @property margin
+         * The persistence value converted to quantisation steps, at least one so
+         * that the coefficients are never equal.
+         */
+        int margin;
+
+        /**
+         * @property
+         * The total capacity of the carrier image in bits.
+         */
+        std::size_t image_capacity;
+
+        /**
+         * Read the coefficients of the carrier JPEG and calculate its capacity.
+         *
+         * @param image_bytes The encoded carrier JPEG.
+         * @param persistence The persistence value for this instance.
+         * @exception ImageException Thrown when the image can't be read.
+         */
+        void Initialise(const std::vector<unsigned char> &image_bytes, const int &persistence);
+
+        /**
+         * @param slot The index of the block, in row major order.
+         * @return The 64 coefficients of the block, in row major order.
+         */
+        short *Block(const std::size_t &slot) const;
+
+        /**
+         * Encode the filename into the carrier image, it follows the container
+         * header.
+         *
+         * @param payload_filename The filename which is stored alongside the payload.
+         * @return The bit index at which the payload starts.
+         */
+        std::size_t EncodeFilename(const std::string &payload_filename);
+
+        /**
+         * Encode the container header into the carrier image, the header is
+         * embedded one bit per block, the same as the rest of the bitstream.
+         *
+         * @param filename_length The length of the filename in bytes.
+         * @param payload_length The length of the payload in bytes.
+         * @param payload_crc The CRC-32C of the payload.
+         */
+        void EncodeHeader(const std::size_t &filename_length, const std::size_t &payload_length, const uint32_t &payload_crc);
+
+        /**
+         * Decode the container header from the steganographic image, rejecting
+         * carriers which don't start with its magic.
+         *
+         * @return The parsed header.
+         * @exception DecodeException Thrown when the carrier holds no payload, or
+         * its header is corrupt.
+         */
+        ContainerHeader DecodeHeader();
+
+        /**
+         * Decode the filename from the steganographic image.
+         *
+         * @param header The container header decoded from the steganographic image.
+         * @param payload_filename Set to the decoded filename.
+         * @return The bit index at which the payload starts.
+         * @exception DecodeException Thrown when decoding fails.
+         */
+        std::size_t DecodeFilename(const ContainerHeader &header, std::string *payload_filename);
+
+        /**
+         * Encode a chunk of information into the carrier image.
+         *
+         * @param start The bit index to start encoding at.
+         * @param it The position in the chunk of information to start encoding.
+         * @param en The position in the chunk of information to stop encoding.
+         */
+        void EncodeChunk(const std::size_t &start, const unsigned char *it, const unsigned char *en);
+
+        /**
+         * Decode a chunk of information from the steganographic image.
+         *
+         * @param start The bit index to start decoding at.
+         * @param it The position in the buffer to start decoding into.
+         * @param en The position in the buffer to stop decoding into.
+         */
+        void DecodeChunk(const std::size_t &start, unsigned char *it, unsigned char *en);
+
+        /**
+         * Order the (0, 2) and (2, 0) coefficients of a block to store a bit, and
+         * move them apart by the margin so the bit persists.
+         *
+         * @param block The 64 coefficients of the block.
+         * @param value The bit to store.
+         */
+        void SwapCoefficients(short *block, const int &value);
+};
+
+#endif // JPEG_COEFFICIENTS_HPP
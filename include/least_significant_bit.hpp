@@ -17,12 +17,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include <iostream>
 #include <string>
-#include <thread>
 #include <vector>
 #include <boost/filesystem.hpp>
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include "steganography.hpp"
+#include "container_header.hpp"
+#include "bit_kernels.hpp"
 #include "exceptions.hpp"
 
 #ifndef LEAST_SIGNIFICANT_BIT_HPP
@@ -38,7 +39,27 @@ class LeastSignificantBit : public Steganography
          */
         LeastSignificantBit(const boost::filesystem::path &image_path) : Steganography(image_path)
         {
-            this->image_capacity = (this->image.rows * this->image.cols * this->image.channels()) - 64;
+            this->Initialise();
+        }
+
+        /**
+         * Constructor for the LeastSignificantBit class which uses a carrier image
+         * that is already in memory, its pixels are modified when encoding.
+         * @param image The carrier image.
+         */
+        explicit LeastSignificantBit(const cv::Mat &image) : Steganography(image)
+        {
+            this->Initialise();
+        }
+
+        /**
+         * Constructor for the LeastSignificantBit class which decodes the carrier
+         * image from the contents of an image file held in memory.
+         * @param image_bytes The encoded carrier image.
+         */
+        explicit LeastSignificantBit(const std::vector<unsigned char> &image_bytes) : Steganography(image_bytes)
+        {
+            this->Initialise();
         }
 
         /**
@@ -56,53 +77,263 @@ class LeastSignificantBit : public Steganography
          */
         void Decode();
 
+        /**
+         * Embed a payload held in memory into the carrier image.
+         *
+         * @param payload_filename The filename which is stored alongside the payload.
+         * @param payload A pointer to the first byte of the payload.
+         * @param payload_size The size of the payload in bytes.
+         * @exception EncodeException Thrown when encoding fails.
+         */
+        void Embed(const std::string &payload_filename, const unsigned char *payload, const std::size_t &payload_size);
+
+        /**
+         * Encode the steganographic image into memory as a PNG file.
+         *
+         * @return The encoded steganographic image.
+         */
+        std::vector<unsigned char> EncodeImage();
+
+        /**
+         * Decode the payload from the steganographic image into memory without
+         * touching the filesystem.
+         *
+         * @return The filename and contents of the payload.
+         * @exception DecodeException Thrown when decoding fails.
+         */
+        DecodedPayload DecodeBuffer();
+
+        /**
+         * Decode only the container header and the payload filename from the
+         * steganographic image, without decoding the payload.
+         *
+         * @param payload_filename Set to the filename of the payload.
+         * @return The container header.
+         * @exception DecodeException Thrown when the image doesn't contain a payload.
+         */
+        ContainerHeader Probe(std::string *payload_filename);
+
+        /**
+         * Set the number of least significant bits of each sample which are used
+         * to store the payload, this must match when decoding.
+         *
+         * @param bits The number of bits per sample, between 1 and 4.
+         * @exception ImageException Thrown when the number of bits is unsupported.
+         */
+        void SetBitsPerSample(const int &bits);
+
+        /**
+         * Walk the samples of a carrier whose pixels are stored in a different
+         * order to cv::imread, such as a memory mapped PPM or bottom-up BMP, in
+         * the order cv::imread would give them. The bitstream is then the same
+         * as that of the decoded image, so it can be decoded either way.
+         *
+         * @param bottom_up Whether the rows are stored last row first.
+         * @param reversed_channels Whether the channels of each pixel are stored
+         * in reverse e.g. RGB rather than BGR.
+         */
+        void SetFileOrder(const bool &bottom_up, const bool &reversed_channels);
+
+        /**
+         * Encode a payload into the carrier image, splitting it into chunks which
+         * are encoded in parallel.
+         *
+         * @param start The bit index to start encoding at.
+         * @param it The position in the payload to start encoding.
+         * @param en The position in the payload to stop encoding.
+         * @exception EncodeException Thrown when the carrier is too small.
+         */
+        void EncodePayload(const std::size_t &start, const unsigned char *it, const unsigned char *en);
+
+        /**
+         * Decode a payload from the steganographic image, splitting it into chunks
+         * which are decoded in parallel.
+         *
+         * @param start The bit index to start decoding at.
+         * @param it The position in the buffer to start decoding into.
+         * @param en The position in the buffer to stop decoding into.
+         * @exception DecodeException Thrown when decoding fails.
+         */
+        void DecodePayload(const std::size_t &start, unsigned char *it, unsigned char *en);
+
+        /**
+         * Get the bit index at which the payload starts, it follows the container
+         * header and the filename. The payload starts on a unit boundary, so that
+         * it is embedded a unit at a time.
+         *
+         * @param filename_length The length of the stored filename in bytes.
+         * @return The bit index of the first bit of the payload.
+         */
+        std::size_t PayloadStart(const std::size_t &filename_length) const;
+
+        /**
+         * Get the number of bits the carrier image can store, including the
+         * filename and the lengths.
+         *
+         * @return The capacity of the carrier image in bits.
+         */
+        std::size_t Capacity() const;
+
+        /**
+         * Calculate the capacity of a carrier image from its dimensions alone.
+         *
+         * @param rows The height of the image in pixels.
+         * @param cols The width of the image in pixels.
+         * @param channels The number of channels of each pixel.
+         * @param bits The number of bits per sample.
+         * @return The capacity of the carrier image in bits.
+         */
+        static std::size_t LayoutCapacity(const int &rows, const int &cols, const int &channels, const int &bits);
+
+        /**
+         * Calculate the bit index at which the payload starts for a number of
+         * bits per sample, as PayloadStart().
+         *
+         * @param bits The number of bits per sample.
+         * @param filename_length The length of the stored filename in bytes.
+         * @return The bit index of the first bit of the payload.
+         */
+        static std::size_t LayoutPayloadStart(const int &bits, const std::size_t &filename_length);
+
     private:
         /**
          * @property image_capacity
          * The total capacity of the carrier image in bits.
          */
-        int image_capacity;
+        std::size_t image_capacity;
 
         /**
-         * Encode a chunk of information into the carrier image.
+         * @property bits_per_sample
+         * The number of least significant bits of each sample which are used.
+         */
+        int bits_per_sample;
+
+        /**
+         * @property bottom_up
+         * Whether the rows of the carrier are stored last row first.
+         */
+        bool bottom_up;
+
+        /**
+         * @property reversed_channels
+         * Whether the channels of each pixel of the carrier are stored in reverse.
+         */
+        bool reversed_channels;
+
+        /**
+         * @property embed_kernel
+         * The kernel specialised for the sample size and bits per sample which
+         * embeds whole units of the payload.
+         */
+        SampleEmbedKernel embed_kernel;
+
+        /**
+         * @property extract_kernel
+         * The kernel specialised for the sample size and bits per sample which
+         * extracts whole units of the payload.
+         */
+        SampleExtractKernel extract_kernel;
+
+        /**
+         * Calculate the capacity of the carrier image.
          *
-         * Before encoding a chunk of information you "should" first encode its length
-         * using the EncodeChunkLength function.
+         * @exception ImageException Thrown when the samples are wider than 16 bits.
+         */
+        void Initialise();
+
+        /**
+         * Find the sample under a cursor, in the order of cv::imread.
          *
-         * @param start The bit index to start encoding at.
-         * @param it The position in the chunk of information to start encoding.
-         * @param en The position in the chunk of information to stop encoding.
+         * @param cursor The cursor positioned at the sample.
+         * @return A pointer to the sample.
          */
-        void EncodeChunk(const int &start, std::vector<unsigned char>::iterator it, std::vector<unsigned char>::iterator en);
+        unsigned char *SamplePointer(const SlotCursor &cursor) const;
 
         /**
-         * Encode a 32bit integer stating the length of the following chunk into the
-         * carrier image.
+         * Set one of the least significant bits of the sample under a cursor.
+         *
+         * @param cursor The cursor positioned at the sample.
+         * @param bit The bit of the sample to set.
+         * @param value The value of the bit.
+         */
+        void SetSampleBit(const SlotCursor &cursor, const int &bit, const int &value);
+
+        /**
+         * Get one of the least significant bits of the sample under a cursor.
+         *
+         * @param cursor The cursor positioned at the sample.
+         * @param bit The bit of the sample to get.
+         * @return The value of the bit.
+         */
+        int GetSampleBit(const SlotCursor &cursor, const int &bit);
+
+        /**
+         * Encode the filename into the carrier image, it follows the container
+         * header.
+         *
+         * @param payload_filename The filename which is stored alongside the payload.
+         * @return The bit index at which the payload starts.
+         */
+        std::size_t EncodeFilename(const std::string &payload_filename);
+
+        /**
+         * Encode the container header into the carrier image, the header is
+         * embedded one bit per sample, so it can be read before the bits per sample are known.
+         *
+         * @param filename_length The length of the filename in bytes.
+         * @param payload_length The length of the payload in bytes.
+         * @param payload_crc The CRC-32C of the payload.
+         */
+        void EncodeHeader(const std::size_t &filename_length, const std::size_t &payload_length, const uint32_t &payload_crc);
+
+        /**
+         * Decode the container header from the steganographic image, rejecting
+         * carriers which don't start with its magic.
+         * Applies the bits per sample which it records.
+         *
+         * @return The parsed header.
+         * @exception DecodeException Thrown when the carrier holds no payload, or
+         * its header is corrupt.
+         */
+        ContainerHeader DecodeHeader();
+
+        /**
+         * Decode the filename from the steganographic image.
+         *
+         * @param header The container header decoded from the steganographic image.
+         * @param payload_filename Set to the decoded filename.
+         * @return The bit index at which the payload starts.
+         * @exception DecodeException Thrown when decoding fails.
+         */
+        std::size_t DecodeFilename(const ContainerHeader &header, std::string *payload_filename);
+
+        /**
+         * Encode a chunk of information into the carrier image.
          *
          * @param start The bit index to start encoding at.
-         * @param chunk_length The length of the next chunk in bytes.
+         * @param it The position in the chunk of information to start encoding.
+         * @param en The position in the chunk of information to stop encoding.
          */
-        void EncodeChunkLength(const int &start, const unsigned int &chunk_length);
+        void EncodeChunk(const std::size_t &start, const unsigned char *it, const unsigned char *en);
 
         /**
          * Attempt to decode a chunk of information from the steganographic image.
          *
          * @param start The bit index to start decoding at.
-         * @param it An iterator to a start position in the payload_bytes vector.
-         * @param en An iterator to an end position in the payload_bytes vector.
+         * @param it The position in the buffer to start decoding into.
+         * @param en The position in the buffer to stop decoding into.
          * @exception DecodeException Thrown when decoding fails.
          */
-        void DecodeChunk(const int start, std::vector<unsigned char>::iterator it, std::vector<unsigned char>::iterator en);
+        void DecodeChunk(const std::size_t &start, unsigned char *it, unsigned char *en);
 
         /**
-         * Attempt to decode the 32bit integer stating the length of the following
-         * chunk.
+         * Create a cursor over the samples of the carrier image, each sample is a
+         * slot which stores bits_per_sample bits.
          *
-         * @param start The bit index to start decoding at.
-         * @return The length of the following chunk.
-         * @exception DecodeException Thrown when decoding fails.
+         * @param slot The slot number the cursor will start at.
+         * @return A cursor positioned at the given slot.
          */
-        unsigned int DecodeChunkLength(const int &start);
+        SlotCursor Seek(const std::size_t &slot);
 };
 
 #endif // LEAST_SIGNIFICANT_BIT_HPP
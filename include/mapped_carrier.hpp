@@ -0,0 +1,174 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cstddef>
+#include <boost/filesystem.hpp>
+#include <opencv2/core/core.hpp>
+#include "exceptions.hpp"
+
+#ifndef MAPPED_CARRIER_HPP
+#define MAPPED_CARRIER_HPP
+
+/**
+ * A memory mapped view of the pixels of an uncompressed carrier image, binary
+ * PGM/PPM or uncompressed 24-bit BMP, so that it can be encoded/decoded
+ * without being decoded into, or re-encoded from, a separate buffer.
+ *
+ * When encoding the carrier is first copied to the output, sharing its extents
+ * where the filesystem supports reflinks, and the copy is mapped; only the pages
+ * holding embedded bits are dirtied and written back. Outputs which are never
+ * committed are removed, so a failed encode leaves nothing behind.
+ *
+ * The pixels are exposed in the order they're stored in the file, so PPM samples
+ * are in RGB order and bottom-up BMP rows are last row first. BottomUp() and
+ * ReversedChannels() describe how this differs from cv::imread, so a technique
+ * can walk the samples in the same order as it would for the decoded image.
+ */
+class MappedCarrier
+{
+    public:
+        /**
+         * Constructor for the MappedCarrier class which maps the carrier image
+         * read only, for decoding.
+         * @param image_path The path to the carrier image.
+         * @exception ImageException Thrown when the image can't be read or isn't
+         * an uncompressed 8-bit image.
+         */
+        explicit MappedCarrier(const boost::filesystem::path &image_path);
+
+        /**
+         * Constructor for the MappedCarrier class which copies the carrier image
+         * to the output and maps the copy, for encoding.
+         * @param image_path The path to the carrier image.
+         * @param output_path The path to the steganographic image that will be created.
+         * @exception ImageException Thrown when the image can't be read or isn't
+         * an uncompressed 8-bit image, or when the output can't be created or is
+         * the carrier image itself.
+         */
+        MappedCarrier(const boost::filesystem::path &image_path, const boost::filesystem::path &output_path);
+
+        /**
+         * Destructor for the MappedCarrier class, unmaps the image and removes
+         * the output if it was not committed.
+         */
+        ~MappedCarrier();
+
+        MappedCarrier(const MappedCarrier &) = delete;
+        MappedCarrier &operator=(const MappedCarrier &) = delete;
+
+        /**
+         * @return A header over the mapped pixels, changes to its samples are
+         * written to the output.
+         */
+        cv::Mat Pixels() const;
+
+        /**
+         * Finish writing the steganographic image, unmaps it and leaves the dirty
+         * pages to be written back by the kernel.
+         */
+        void Commit();
+
+        /**
+         * @return Whether the rows of the pixels are stored last row first.
+         */
+        bool BottomUp() const;
+
+        /**
+         * @return Whether the channels of each pixel are stored in RGB rather
+         * than BGR order.
+         */
+        bool ReversedChannels() const;
+
+    private:
+        /**
+         * Unmap the image, and remove the output if it was not committed.
+         */
+        void Close();
+
+        /**
+         * Map the whole of the open file into memory and parse its header.
+         * @param descriptor The descriptor of the image file.
+         * @param flags Either MAP_PRIVATE or MAP_SHARED.
+         * @exception ImageException Thrown when the image can't be mapped or parsed.
+         */
+        void Map(const int &descriptor, const int &flags);
+
+        /**
+         * Parse the header of a binary PGM (P5) or PPM (P6) image.
+         * @exception ImageException Thrown when the header is malformed.
+         */
+        void ParseNetpbm();
+
+        /**
+         * Parse the headers of an uncompressed BMP image.
+         * @exception ImageException Thrown when the headers are malformed.
+         */
+        void ParseBitmap();
+
+        /**
+         * Copy the whole of one file into another, sharing the source's extents
+         * when possible.
+         * @param source The descriptor of the file to copy.
+         * @param destination The descriptor of the empty file to copy it into.
+         * @param size The size of the source in bytes.
+         * @return Whether the copy was successful.
+         */
+        static bool Copy(const int &source, const int &destination, const std::size_t &size);
+
+        /**
+         * @property output_path
+         * The path to the steganographic image, empty when decoding.
+         */
+        boost::filesystem::path output_path;
+
+        /**
+         * @property committed
+         * Whether the steganographic image has been committed.
+         */
+        bool committed;
+
+        /**
+         * @property mapping
+         * The memory mapping of the image file, null once unmapped.
+         */
+        unsigned char *mapping;
+
+        /**
+         * @property size
+         * The size of the image file in bytes.
+         */
+        std::size_t size;
+
+        /**
+         * @property pixels
+         * A header over the pixels within the mapping.
+         */
+        cv::Mat pixels;
+
+        /**
+         * @property bottom_up
+         * Whether the rows of the pixels are stored last row first.
+         */
+        bool bottom_up;
+
+        /**
+         * @property reversed_channels
+         * Whether the channels of each pixel are stored in RGB order.
+         */
+        bool reversed_channels;
+};
+
+#endif // MAPPED_CARRIER_HPP
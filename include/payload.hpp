@@ -0,0 +1,348 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <cstddef>
+#include <future>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "exceptions.hpp"
+
+#ifndef PAYLOAD_HPP
+#define PAYLOAD_HPP
+
+/**
+ * A read only view of the contents of a payload file.
+ *
+ * Regular files are memory mapped so the payload is never copied, anything
+ * else (e.g. a pipe) is read into memory using large buffered reads.
+ */
+class PayloadReader
+{
+    public:
+        /**
+         * Default constructor for the PayloadReader class.
+         * @param payload_path The path to the file to read as the payload.
+         * @exception EncodeException Thrown when the payload can't be read.
+         */
+        explicit PayloadReader(const boost::filesystem::path &payload_path);
+
+        /**
+         * Destructor for the PayloadReader class, unmaps the payload.
+         */
+        ~PayloadReader();
+
+        PayloadReader(const PayloadReader &) = delete;
+        PayloadReader &operator=(const PayloadReader &) = delete;
+
+        /**
+         * @return A pointer to the first byte of the payload.
+         */
+        const unsigned char *Data() const;
+
+        /**
+         * @return The size of the payload in bytes.
+         */
+        std::size_t Size() const;
+
+    private:
+        /**
+         * @property mapping
+         * The memory mapping of the payload file, null when it was buffered.
+         */
+        void *mapping;
+
+        /**
+         * @property buffer
+         * The payload when it could not be memory mapped.
+         */
+        std::vector<unsigned char> buffer;
+
+        /**
+         * @property data
+         * A pointer to the first byte of the payload.
+         */
+        const unsigned char *data;
+
+        /**
+         * @property size
+         * The size of the payload in bytes.
+         */
+        std::size_t size;
+};
+
+/**
+ * A pre-sized writable view of a payload file which is being decoded.
+ *
+ * Regular files are decoded into a temporary file alongside them, created at
+ * its final size and memory mapped so the payload is decoded straight into the
+ * page cache, which replaces the file on commit. Anything else (e.g. a pipe) is
+ * buffered in memory and written out on commit. Temporary files which are never
+ * committed are removed, so a failed decode leaves any existing file untouched.
+ */
+class PayloadWriter
+{
+    public:
+        /**
+         * Default constructor for the PayloadWriter class.
+         * @param payload_path The path to the file that will be created.
+         * @param size The size of the payload in bytes.
+         * @exception DecodeException Thrown when the payload can't be created.
+         */
+        PayloadWriter(const boost::filesystem::path &payload_path, const std::size_t &size);
+
+        /**
+         * Destructor for the PayloadWriter class, removes the temporary file if
+         * the payload was not committed.
+         */
+        ~PayloadWriter();
+
+        PayloadWriter(const PayloadWriter &) = delete;
+        PayloadWriter &operator=(const PayloadWriter &) = delete;
+
+        /**
+         * @return A pointer to the first byte of the payload.
+         */
+        unsigned char *Data();
+
+        /**
+         * @return The size of the payload in bytes.
+         */
+        std::size_t Size() const;
+
+        /**
+         * Finish writing the payload file.
+         * @exception DecodeException Thrown when the payload can't be written.
+         */
+        void Commit();
+
+    private:
+        /**
+         * @property payload_path
+         * The path to the file being written.
+         */
+        boost::filesystem::path payload_path;
+
+        /**
+         * @property descriptor
+         * The open file descriptor, -1 once committed.
+         */
+        int descriptor;
+
+        /**
+         * @property temporary_path
+         * The temporary file the payload is written to until it's committed,
+         * empty when the output isn't a regular file and is written directly.
+         */
+        std::string temporary_path;
+
+        /**
+         * @property mapping
+         * The memory mapping of the payload file, null when it's buffered.
+         */
+        void *mapping;
+
+        /**
+         * @property buffer
+         * The payload when it could not be memory mapped.
+         */
+        std::vector<unsigned char> buffer;
+
+        /**
+         * @property data
+         * A pointer to the first byte of the payload.
+         */
+        unsigned char *data;
+
+        /**
+         * @property size
+         * The size of the payload in bytes.
+         */
+        std::size_t size;
+};
+
+/**
+ * Reads a payload file in bounded windows, so that payloads larger than memory
+ * can be encoded.
+ *
+ * The reads are double buffered; whilst one window is being embedded the next
+ * one is read in the background.
+ */
+class PayloadStreamReader
+{
+    public:
+        /**
+         * Default constructor for the PayloadStreamReader class, starts reading
+         * the first window in the background.
+         * @param payload_path The path to the file to read as the payload.
+         * @param window The size of each window in bytes.
+         * @exception EncodeException Thrown when the payload can't be opened.
+         */
+        PayloadStreamReader(const boost::filesystem::path &payload_path, const std::size_t &window);
+
+        /**
+         * Destructor for the PayloadStreamReader class, waits for any background
+         * read to complete.
+         */
+        ~PayloadStreamReader();
+
+        PayloadStreamReader(const PayloadStreamReader &) = delete;
+        PayloadStreamReader &operator=(const PayloadStreamReader &) = delete;
+
+        /**
+         * Wait for the next window of the payload and start reading the one after
+         * it. The previously returned window is no longer valid.
+         *
+         * @param data Set to the first byte of the window.
+         * @return The size of the window, zero once the whole payload has been read.
+         * @exception EncodeException Thrown when the payload can't be read.
+         */
+        std::size_t Next(const unsigned char **data);
+
+    private:
+        /**
+         * @property descriptor
+         * The open payload file.
+         */
+        int descriptor;
+
+        /**
+         * @property buffers
+         * The window being processed and the window being read.
+         */
+        std::vector<unsigned char> buffers[2];
+
+        /**
+         * @property current
+         * The index of the buffer which is being read into.
+         */
+        int current;
+
+        /**
+         * @property pending
+         * The background read, gives the number of bytes read.
+         */
+        std::future<std::size_t> pending;
+
+        /**
+         * Fill a buffer from the payload file.
+         *
+         * @param buffer The buffer to fill.
+         * @return The number of bytes read, less than the window size at the end
+         * of the payload.
+         */
+        std::size_t Fill(std::vector<unsigned char> *buffer);
+};
+
+/**
+ * Writes a payload file in bounded windows as it's decoded, so the start of the
+ * payload is available before the end has been decoded.
+ *
+ * The writes are double buffered; whilst one window is being written in the
+ * background the next one is decoded. Regular files are written through a
+ * temporary file which replaces them on commit, so a failed decode leaves any
+ * existing file untouched.
+ */
+class PayloadStreamWriter
+{
+    public:
+        /**
+         * Default constructor for the PayloadStreamWriter class.
+         * @param payload_path The path to the file that will be created.
+         * @param window The size of each window in bytes.
+         * @exception DecodeException Thrown when the payload can't be created.
+         */
+        PayloadStreamWriter(const boost::filesystem::path &payload_path, const std::size_t &window);
+
+        /**
+         * Destructor for the PayloadStreamWriter class, removes the temporary
+         * file if the payload was not committed.
+         */
+        ~PayloadStreamWriter();
+
+        PayloadStreamWriter(const PayloadStreamWriter &) = delete;
+        PayloadStreamWriter &operator=(const PayloadStreamWriter &) = delete;
+
+        /**
+         * @return The buffer which the next window should be decoded into, it has
+         * room for a whole window.
+         */
+        unsigned char *Buffer();
+
+        /**
+         * Start writing the buffer in the background, waiting for the previous
+         * window to finish being written.
+         *
+         * @param size The number of bytes decoded into the buffer.
+         * @exception DecodeException Thrown when the payload can't be written.
+         */
+        void Write(const std::size_t &size);
+
+        /**
+         * Finish writing the payload file.
+         * @exception DecodeException Thrown when the payload can't be written.
+         */
+        void Commit();
+
+    private:
+        /**
+         * @property payload_path
+         * The path to the file being written.
+         */
+        boost::filesystem::path payload_path;
+
+        /**
+         * @property descriptor
+         * The open file descriptor, -1 once committed.
+         */
+        int descriptor;
+
+        /**
+         * @property temporary_path
+         * The temporary file the payload is written to until it's committed,
+         * empty when the output isn't a regular file and is written directly.
+         */
+        std::string temporary_path;
+
+        /**
+         * @property buffers
+         * The window being decoded and the window being written.
+         */
+        std::vector<unsigned char> buffers[2];
+
+        /**
+         * @property current
+         * The index of the buffer which is being decoded into.
+         */
+        int current;
+
+        /**
+         * @property pending
+         * The background write.
+         */
+        std::future<void> pending;
+
+        /**
+         * Write a buffer to the payload file.
+         *
+         * @param buffer The buffer to write.
+         * @param size The number of bytes to write.
+         */
+        void Drain(const std::vector<unsigned char> *buffer, const std::size_t &size);
+};
+
+#endif // PAYLOAD_HPP
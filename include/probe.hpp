@@ -0,0 +1,107 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "exceptions.hpp"
+
+#ifndef PROBE_HPP
+#define PROBE_HPP
+
+/**
+ * What was found in the container header of a single image.
+ */
+struct ProbeResult
+{
+    boost::filesystem::path image_path;
+    std::string technique;
+    std::string filename;
+    std::size_t payload_size;
+    std::string error;
+};
+
+/**
+ * Scans many images for embedded payloads, or for their capacity.
+ *
+ * Only the container header and the payload filename are decoded, a stripe at a
+ * time, so each image is read no further than the first few rows which hold
+ * them. The LSB technique is tried first as it reads the fewest rows, then the
+ * DCT technique, then for JPEG images the JPEG technique, which reads the
+ * coefficients of the whole image. Images which can't be read a stripe at a
+ * time, such as interlaced PNG, BMP and TIFF images, are decoded whole.
+ * Capacities are calculated from the header of the image alone.
+ */
+class CorpusProbe
+{
+    public:
+        /**
+         * List the images to probe. A directory is searched recursively for
+         * files, otherwise each line of the manifest is an image path and
+         * optionally further tab separated fields which are ignored, so a batch
+         * manifest may be probed. Blank lines and lines starting with "#" are
+         * ignored.
+         *
+         * @param path The path to the directory or manifest.
+         * @return The paths of the images.
+         * @exception DecodeException Thrown when the directory or manifest can't be read.
+         */
+        static std::vector<boost::filesystem::path> ReadImages(const boost::filesystem::path &path);
+
+        /**
+         * Probe a single image for a payload.
+         *
+         * @param image_path The path to the image.
+         * @return The technique, filename and size of the payload, the technique
+         * is empty when there is no payload and the error is set when the image
+         * can't be read.
+         */
+        static ProbeResult Probe(const boost::filesystem::path &image_path);
+
+        /**
+         * Format a result as a single line JSON object.
+         *
+         * @param result The result to format.
+         * @return The JSON object.
+         */
+        static std::string Json(const ProbeResult &result);
+
+        /**
+         * Calculate the largest payload an image can store using each layout,
+         * from the header of the image alone.
+         *
+         * @param image_path The path to the image.
+         * @return A single line JSON object giving the dimensions of the image and
+         * the number of bytes each layout can store, shared by the payload and
+         * its filename, or the error when the header can't be read.
+         */
+        static std::string Capacity(const boost::filesystem::path &image_path);
+
+        /**
+         * Probe each of the images in parallel, writing a JSON line for each in
+         * the order the images are given.
+         *
+         * @param images The paths of the images.
+         * @param output The stream to write the JSON lines to.
+         * @return The number of images which contain a payload.
+         */
+        static std::size_t Run(const std::vector<boost::filesystem::path> &images, std::ostream &output);
+};
+
+#endif // PROBE_HPP
@@ -0,0 +1,126 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifndef STATS_HPP
+#define STATS_HPP
+
+/**
+ * Records the wall time, and the number of bytes and bits processed, by each
+ * stage of encoding/decoding e.g. reading the carrier image, embedding the
+ * payload or writing the steganographic image.
+ *
+ * Recording is off unless it's enabled, whilst it's off a stage costs a single
+ * check of a flag. Repeated stages, such as the windows of a streamed payload,
+ * are accumulated under the same name.
+ */
+class Stats
+{
+    public:
+        /**
+         * Start recording the stages.
+         *
+         * @param counters Whether to also count cycles, instructions and cache
+         * misses using perf_event_open. The counters cover the whole process,
+         * but only include threads created after recording is started; they're
+         * left out if the kernel doesn't allow them to be opened.
+         */
+        static void Enable(const bool &counters);
+
+        /**
+         * Stop recording the stages and discard those recorded so far.
+         */
+        static void Disable();
+
+        /**
+         * @return The stages recorded so far as a JSON object.
+         */
+        static std::string Json();
+
+        /**
+         * Records a single stage from its construction to its destruction.
+         */
+        class Stage
+        {
+            public:
+                /**
+                 * Default constructor for the Stage class, starts timing the stage
+                 * if recording is enabled.
+                 * @param name The name of the stage, must outlive the stage.
+                 * @param bytes The number of bytes processed by the stage.
+                 * @param bits The number of bits embedded/extracted by the stage.
+                 */
+                inline explicit Stage(const char *name, const std::size_t &bytes = 0, const std::size_t &bits = 0)
+                    : name(nullptr), bytes(bytes), bits(bits)
+                {
+                    if (Stats::enabled.load(std::memory_order_relaxed))
+                    {
+                        this->Begin(name);
+                    }
+                }
+
+                /**
+                 * Destructor for the Stage class, stops timing the stage.
+                 */
+                inline ~Stage()
+                {
+                    if (this->name)
+                    {
+                        this->End();
+                    }
+                }
+
+                Stage(const Stage &) = delete;
+                Stage &operator=(const Stage &) = delete;
+
+                /**
+                 * Set the amount of data processed by the stage, for when it's not
+                 * known until part way through the stage.
+                 * @param bytes The number of bytes processed by the stage.
+                 * @param bits The number of bits embedded/extracted by the stage.
+                 */
+                inline void Count(const std::size_t &bytes, const std::size_t &bits = 0)
+                {
+                    this->bytes = bytes;
+                    this->bits = bits;
+                }
+
+            private:
+                const char *name;
+                std::size_t bytes;
+                std::size_t bits;
+                std::chrono::steady_clock::time_point start;
+                std::uint64_t counters[3];
+
+                void Begin(const char *name);
+                void End();
+        };
+
+    private:
+        /**
+         * @property enabled
+         * Whether the stages are being recorded.
+         */
+        static std::atomic<bool> enabled;
+};
+
+#endif // STATS_HPP
@@ -15,8 +15,10 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
+#include <cstddef>
 #include <fstream>
 #include <iostream>
+#include <string>
 #include <vector>
 #include <boost/filesystem.hpp>
 #include <opencv2/core/core.hpp>
@@ -26,6 +28,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #ifndef STEGANOGRAPHY_HPP
 #define STEGANOGRAPHY_HPP
 
+/**
+ * A payload which has been decoded into memory.
+ */
+struct DecodedPayload
+{
+    std::string filename;
+    std::vector<unsigned char> bytes;
+};
+
 /**
  * Abstract base class which each steganography technique will extend.
  */
@@ -37,16 +48,30 @@ class Steganography
          * different steganography techniques.
          * @param image_path The path to the input carrier image.
          */
-        explicit Steganography(const boost::filesystem::path &image_path)
-        {
-            this->image_path = image_path;
-            this->image = cv::imread(image_path.string(), cv::IMREAD_UNCHANGED);
+        explicit Steganography(const boost::filesystem::path &image_path);
 
-            if (!this->image.data)
-            {
-                throw ImageException("Error: Failed to open input image");
-            }
-        }
+        /**
+         * Constructor for the Steganography class which uses a carrier image that
+         * is already in memory. The pixels are shared with the given image rather
+         * than copied, so encoding may modify it.
+         * @param image The carrier image.
+         * @exception ImageException Thrown when the image is empty.
+         */
+        explicit Steganography(const cv::Mat &image);
+
+        /**
+         * Constructor for the Steganography class which decodes the carrier image
+         * from the contents of an image file held in memory.
+         * @param image_bytes The encoded carrier image e.g. the bytes of a PNG file.
+         * @exception ImageException Thrown when the image can't be decoded.
+         */
+        explicit Steganography(const std::vector<unsigned char> &image_bytes);
+
+        /**
+         * Destructor for the Steganography class, allows techniques to be owned
+         * through a pointer to this class.
+         */
+        virtual ~Steganography() = default;
 
         /**
          * @pure Encode
@@ -66,11 +91,117 @@ class Steganography
          */
         virtual void Decode() = 0;
 
+        /**
+         * @pure Embed
+         * Function that must be overridden by the subclass which embeds a payload
+         * held in memory into the carrier image using the steganographic technique
+         * defined in the subclass. The result is retrieved using EncodeImage.
+         * @param payload_filename The filename which is stored alongside the payload.
+         * @param payload A pointer to the first byte of the payload.
+         * @param payload_size The size of the payload in bytes.
+         * @exception EncodeException Thrown when encoding fails.
+         */
+        virtual void Embed(const std::string &payload_filename, const unsigned char *payload,
+                const std::size_t &payload_size) = 0;
+
+        /**
+         * @pure EncodeImage
+         * Function that must be overridden by the subclass which encodes the
+         * steganographic image into memory, using the image format required by the
+         * technique defined in the subclass.
+         * @return The encoded steganographic image.
+         */
+        virtual std::vector<unsigned char> EncodeImage() = 0;
+
+        /**
+         * @pure DecodeBuffer
+         * Function that must be overridden by the subclass which decodes the
+         * payload from the steganographic image into memory, without touching the
+         * filesystem.
+         * @return The filename and contents of the payload.
+         * @exception DecodeException Thrown when decoding fails.
+         */
+        virtual DecodedPayload DecodeBuffer() = 0;
+
+        /**
+         * @pure EncodePayload
+         * Function that must be overridden by the subclass which embeds a run of
+         * bytes into the bitstream of the carrier image, starting at a bit index.
+         * @param start The bit index to start encoding at.
+         * @param it The position in the payload to start encoding.
+         * @param en The position in the payload to stop encoding.
+         * @exception EncodeException Thrown when the carrier is too small.
+         */
+        virtual void EncodePayload(const std::size_t &start, const unsigned char *it, const unsigned char *en) = 0;
+
+        /**
+         * @pure DecodePayload
+         * Function that must be overridden by the subclass which extracts a run of
+         * bytes from the bitstream of the carrier image, starting at a bit index.
+         * @param start The bit index to start decoding at.
+         * @param it The position in the buffer to start decoding into.
+         * @param en The position in the buffer to stop decoding into.
+         * @exception DecodeException Thrown when decoding fails.
+         */
+        virtual void DecodePayload(const std::size_t &start, unsigned char *it, unsigned char *en) = 0;
+
+        /**
+         * @pure PayloadStart
+         * Function that must be overridden by the subclass which gives the bit
+         * index at which the payload starts, after the container header and the
+         * filename.
+         * @param filename_length The length of the stored filename in bytes.
+         * @return The bit index of the first bit of the payload.
+         */
+        virtual std::size_t PayloadStart(const std::size_t &filename_length) const = 0;
+
+        /**
+         * @pure Capacity
+         * Function that must be overridden by the subclass which gives the number
+         * of bits the carrier image can store, including the filename and lengths.
+         * @return The capacity of the carrier image in bits.
+         */
+        virtual std::size_t Capacity() const = 0;
+
+        /**
+         * Encode a payload held in memory into the carrier image without touching
+         * the filesystem.
+         *
+         * @param payload_filename The filename which is stored alongside the payload.
+         * @param payload A pointer to the first byte of the payload.
+         * @param payload_size The size of the payload in bytes.
+         * @return The encoded steganographic image.
+         * @exception EncodeException Thrown when encoding fails.
+         */
+        std::vector<unsigned char> EncodeBuffer(const std::string &payload_filename, const unsigned char *payload,
+                const std::size_t &payload_size);
+
+        /**
+         * Stream the payload through fixed size windows rather than holding it in
+         * memory. Whilst one window is being encoded/decoded the next is read or
+         * the previous is written in the background.
+         *
+         * @param window The size of each window in bytes, zero disables streaming.
+         */
+        void SetStreamWindow(const std::size_t &window);
+
+        /**
+         * @return The carrier image, once a payload has been embedded this is the
+         * steganographic image. Empty for techniques which don't decode the pixels.
+         */
+        const cv::Mat &Image() const;
+
     protected:
+        /**
+         * Constructor for techniques which work on the encoded carrier image rather
+         * than its pixels, the image is left empty.
+         */
+        Steganography();
+
         /**
          * @property image_path
          * The path to the carrier image stored on disk. This image will not be
-         * modified.
+         * modified. Empty when the carrier image was given in memory.
          */
         boost::filesystem::path image_path;
 
@@ -81,20 +212,127 @@ class Steganography
         cv::Mat image;
 
         /**
-         * Read all the bytes from a payload file into a vector.
-         *
-         * @param payload_path The path to the file to read as the payload.
-         * @return A vector containing all the bytes from the payload file.
+         * @property stream_window
+         * The size of the windows the payload is streamed through, zero when the
+         * payload is not streamed.
          */
-        std::vector<unsigned char> ReadPayload(const boost::filesystem::path & payload_path);
+        std::size_t stream_window;
 
         /**
-         * Write all the bytes decoded from the carrier image to a file.
+         * Addresses the embedding slots of a plane of samples.
          *
-         * @param payload_path The path to the file that will be created.
-         * @param payload The payload decoded from the carrier image.
+         * A slot is a square of samples which stores a single bit; a single sample
+         * for the LSB technique or an 8x8 block for the DCT technique. Slots are
+         * numbered in row major order, the cursor maps a slot number straight to
+         * the address of the slot's first sample and then advances from slot to
+         * slot without repeating the division and modulo arithmetic.
          */
-        void WritePayload(const boost::filesystem::path &payload_path, const std::vector<unsigned char> &payload);
+        class SlotCursor
+        {
+            public:
+                /**
+                 * Default constructor for the SlotCursor class.
+                 * @param origin A pointer to the first sample of the plane.
+                 * @param row_step The distance in bytes between two rows of samples.
+                 * @param sample_size The size of a single sample in bytes.
+                 * @param slot_size The width/height of a slot in samples.
+                 * @param grid_rows The number of rows of slots in the plane.
+                 * @param grid_cols The number of slots in each row of the plane.
+                 * @param slot The slot number the cursor will start at.
+                 */
+                SlotCursor(unsigned char *origin, const std::ptrdiff_t &row_step, const std::size_t &sample_size,
+                        const int &slot_size, const std::size_t &grid_rows, const std::size_t &grid_cols, const std::size_t &slot)
+                    : origin(origin), slot_row_step(row_step * slot_size), slot_col_step(sample_size * slot_size),
+                      grid_rows(grid_rows), grid_cols(grid_cols)
+                {
+                    this->Seek(slot);
+                }
+
+                /**
+                 * Move the cursor to the given slot.
+                 * @param slot The slot number to move to.
+                 */
+                inline void Seek(const std::size_t &slot)
+                {
+                    this->row = (this->grid_cols == 0) ? this->grid_rows : slot / this->grid_cols;
+                    this->col = (this->grid_cols == 0) ? 0 : slot % this->grid_cols;
+                    this->row_origin = this->origin + (this->row * this->slot_row_step);
+                    this->pointer = this->row_origin + (this->col * this->slot_col_step);
+                }
+
+                /**
+                 * @return A pointer to the first sample of the current slot.
+                 */
+                inline unsigned char *Pointer() const
+                {
+                    return this->pointer;
+                }
+
+                /**
+                 * @return The number of the current slot.
+                 */
+                inline std::size_t Slot() const
+                {
+                    return (this->row * this->grid_cols) + this->col;
+                }
+
+                /**
+                 * @return The number of slots, including the current slot, which
+                 * remain in the current row of slots.
+                 */
+                inline std::size_t Contiguous() const
+                {
+                    return this->End() ? 0 : this->grid_cols - this->col;
+                }
+
+                /**
+                 * @return Whether the cursor has moved past the final slot.
+                 */
+                inline bool End() const
+                {
+                    return this->row >= this->grid_rows;
+                }
+
+                /**
+                 * Advance the cursor to the next slot.
+                 */
+                inline SlotCursor &operator++()
+                {
+                    if (++this->col == this->grid_cols)
+                    {
+                        this->col = 0;
+                        this->row++;
+                        this->row_origin += this->slot_row_step;
+                        this->pointer = this->row_origin;
+                    }
+                    else
+                    {
+                        this->pointer += this->slot_col_step;
+                    }
+
+                    return *this;
+                }
+
+                /**
+                 * Advance the cursor by the given number of slots.
+                 */
+                inline SlotCursor &operator+=(const std::size_t &slots)
+                {
+                    this->Seek(this->Slot() + slots);
+                    return *this;
+                }
+
+            private:
+                unsigned char *origin;
+                unsigned char *row_origin;
+                unsigned char *pointer;
+                std::ptrdiff_t slot_row_step;
+                std::ptrdiff_t slot_col_step;
+                std::size_t grid_rows;
+                std::size_t grid_cols;
+                std::size_t row;
+                std::size_t col;
+        };
 
         /**
          * Set the n'th significant bit of a generic type.
@@ -109,7 +347,7 @@ class Steganography
         template <class T>
         inline void SetBit(T *target, const int &bit, const int &value)
         {
-            *target ^= (-(unsigned int)value ^ *target) & (1UL << bit);
+            *target ^= (-(T)value ^ *target) & ((T)1 << bit);
         }
 
         /**
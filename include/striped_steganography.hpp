@@ -0,0 +1,226 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <boost/filesystem.hpp>
+#include <opencv2/core/core.hpp>
+#include "steganography.hpp"
+#include "container_header.hpp"
+#include "stripes.hpp"
+#include "exceptions.hpp"
+
+#ifndef STRIPED_STEGANOGRAPHY_HPP
+#define STRIPED_STEGANOGRAPHY_HPP
+
+/**
+ * Encodes/decodes using the LSB or DCT technique a stripe of rows at a time, so
+ * that the carrier image is never held in memory as a whole.
+ *
+ * Each stripe is read, embedded into and written before the next is read. A
+ * stripe of the LSB technique is a multiple of 8 rows and a stripe of the DCT
+ * technique is a multiple of 64 rows, so every stripe carries a whole number of
+ * bytes of the bitstream. The DCT technique also holds the first 8 rows of the
+ * next stripe, as the final row of blocks of the image is never used.
+ *
+ * The steganographic images are the same as those of the techniques, so they
+ * may be decoded by either.
+ */
+class StripedSteganography
+{
+    public:
+        /**
+         * Default constructor for the StripedSteganography class.
+         * @param image_path The path to the input carrier PNG, JPEG or TIFF.
+         * @param technique The technique to use, either "lsb" or "dct".
+         * @param memory_budget The number of bytes of pixels held in memory at once,
+         * at least one stripe is held regardless.
+         * @exception ImageException Thrown when the technique can't be used in stripes.
+         */
+        StripedSteganography(const boost::filesystem::path &image_path, const std::string &technique,
+                const std::size_t &memory_budget);
+
+        /**
+         * Set the persistence of the DCT technique.
+         *
+         * @param persistence The persistence value.
+         */
+        void SetPersistence(const int &persistence);
+
+        /**
+         * Set the number of least significant bits of each sample used by the LSB
+         * technique.
+         *
+         * @param bits The number of bits per sample, between 1 and 4.
+         */
+        void SetBitsPerSample(const int &bits);
+
+        /**
+         * Set the number of channels and coefficient pairs of each block used by
+         * the DCT technique.
+         *
+         * @param channels The number of colour channels, 0 uses every colour channel.
+         * @param pairs The number of coefficient pairs, 1, 2, 4 or 8.
+         */
+        void SetLayout(const int &channels, const int &pairs);
+
+        /**
+         * Embed using the fixed point kernels of the DCT technique.
+         *
+         * @param fixed_point Whether to use the fixed point path when encoding.
+         */
+        void SetFixedPoint(const bool &fixed_point);
+
+        /**
+         * Encode the payload file into the carrier image, writing the
+         * steganographic image a stripe at a time.
+         *
+         * @param payload_path Path to the file we are encoding.
+         * @exception EncodeException Thrown when encoding fails.
+         * @exception ImageException Thrown when the images can't be read or written.
+         */
+        void Encode(const boost::filesystem::path &payload_path);
+
+        /**
+         * Decode the payload from the steganographic image, reading only as many
+         * stripes as hold the payload. The bits per sample and layout are read
+         * from the container header.
+         *
+         * @exception DecodeException Thrown when decoding fails.
+         * @exception ImageException Thrown when the image can't be read.
+         */
+        void Decode();
+
+        /**
+         * Decode only the container header and the payload filename from the
+         * steganographic image, reading only as many stripes as hold them.
+         *
+         * @param payload_filename Set to the filename of the payload.
+         * @return The container header.
+         * @exception DecodeException Thrown when the image doesn't contain a payload.
+         * @exception ImageException Thrown when the image can't be read.
+         */
+        ContainerHeader Probe(std::string *payload_filename);
+
+    private:
+        /**
+         * @property image_path
+         * The path to the carrier image stored on disk.
+         */
+        boost::filesystem::path image_path;
+
+        /**
+         * @property technique
+         * The technique used to encode/decode each stripe.
+         */
+        std::string technique;
+
+        /**
+         * @property memory_budget
+         * The number of bytes of pixels held in memory at once.
+         */
+        std::size_t memory_budget;
+
+        /**
+         * @property persistence
+         * The persistence of the DCT technique.
+         */
+        int persistence;
+
+        /**
+         * @property bits_per_sample
+         * The number of least significant bits of each sample used by the LSB technique.
+         */
+        int bits_per_sample;
+
+        /**
+         * @property channels
+         * The number of colour channels of each block used by the DCT technique.
+         */
+        int channels;
+
+        /**
+         * @property pairs
+         * The number of coefficient pairs of each channel used by the DCT technique.
+         */
+        int pairs;
+
+        /**
+         * @property fixed_point
+         * Whether the DCT technique embeds using the fixed point kernels.
+         */
+        bool fixed_point;
+
+        /**
+         * Create the technique over a stripe of the carrier image, the pixels are
+         * shared with the stripe.
+         *
+         * @param stripe The rows of the stripe.
+         * @param header Whether to use the layout of the container header, one
+         * bit per slot, rather than the configured layout.
+         * @return The technique.
+         */
+        std::unique_ptr<Steganography> Open(const cv::Mat &stripe, const bool &header) const;
+
+        /**
+         * Calculate the number of bits stored in each slot, a sample of the LSB
+         * technique or a block of the DCT technique, by the configured layout.
+         *
+         * @param reader The reader of the carrier image.
+         * @return The number of bits per slot.
+         */
+        std::size_t BitsPerSlot(const StripeReader &reader) const;
+
+        /**
+         * Calculate the capacity of the whole carrier image.
+         *
+         * @param reader The reader of the carrier image.
+         * @return The capacity of the carrier image in bits.
+         */
+        std::size_t Capacity(const StripeReader &reader) const;
+
+        /**
+         * Decode the bitstream of the steganographic image a stripe at a time.
+         *
+         * @param decode_payload Whether to decode and write the payload, rather
+         * than stopping once the filename has been decoded.
+         * @param payload_filename Set to the filename of the payload, may be null.
+         * @return The container header.
+         * @exception DecodeException Thrown when decoding fails.
+         * @exception ImageException Thrown when the image can't be read.
+         */
+        ContainerHeader DecodeStream(const bool &decode_payload, std::string *payload_filename = nullptr);
+
+        /**
+         * Read the carrier image a stripe at a time, and pass the technique over
+         * each stripe, in the layout of the container header, to a function along
+         * with the index of the stripe's first slot. Each stripe is written once
+         * the function returns.
+         *
+         * @param reader The reader of the carrier image.
+         * @param writer The writer of the steganographic image, or null when
+         * decoding.
+         * @param function Returns false once no more stripes are needed, which
+         * stops reading when there is no writer.
+         */
+        void Process(StripeReader *reader, StripeWriter *writer,
+                const std::function<bool(Steganography *, const std::size_t &)> &function);
+};
+
+#endif // STRIPED_STEGANOGRAPHY_HPP
@@ -0,0 +1,141 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <cstddef>
+#include <memory>
+#include <boost/filesystem.hpp>
+#include <opencv2/core/core.hpp>
+#include "exceptions.hpp"
+
+#ifndef STRIPES_HPP
+#define STRIPES_HPP
+
+/**
+ * Reads the pixels of a PNG, JPEG or TIFF image a few rows at a time, rather
+ * than decoding the whole image into memory. A tiled TIFF is read a row of
+ * tiles at a time, which is held until each of its rows has been read.
+ *
+ * The rows are laid out the same as cv::imread with cv::IMREAD_UNCHANGED; the
+ * colour channels are in BGR order and 16-bit samples are in native byte order.
+ */
+class StripeReader
+{
+    public:
+        /**
+         * Default constructor for the StripeReader class, reads the header of the
+         * image.
+         * @param image_path The path to the PNG, JPEG or TIFF image.
+         * @exception ImageException Thrown when the image can't be read, or when
+         * it's an interlaced/progressive image or a TIFF layout which can't be
+         * read by row.
+         */
+        explicit StripeReader(const boost::filesystem::path &image_path);
+
+        /**
+         * Destructor for the StripeReader class, closes the image.
+         */
+        ~StripeReader();
+
+        StripeReader(const StripeReader &) = delete;
+        StripeReader &operator=(const StripeReader &) = delete;
+
+        /**
+         * @return The height of the image in pixels.
+         */
+        int Rows() const;
+
+        /**
+         * @return The width of the image in pixels.
+         */
+        int Cols() const;
+
+        /**
+         * @return The OpenCV type of the rows e.g. CV_8UC3.
+         */
+        int Type() const;
+
+        /**
+         * Read the next rows of the image.
+         *
+         * @param rows The rows to read into, must have Cols() columns of Type().
+         * @return The number of rows read, less than rows->rows at the end of the image.
+         * @exception ImageException Thrown when the image is truncated or corrupt.
+         */
+        int Read(cv::Mat *rows);
+
+    private:
+        struct Decoder;
+
+        /**
+         * @property decoder
+         * The libpng, libjpeg or libtiff state of the image being read.
+         */
+        std::unique_ptr<Decoder> decoder;
+};
+
+/**
+ * Writes the pixels of a PNG or JPEG image a few rows at a time, the format is
+ * chosen from the extension of the path.
+ *
+ * PNG images are written with Huffman only compression like the LSB technique,
+ * and JPEG images are written at quality 100 like the DCT technique. The colour
+ * channels of a JPEG are the first three channels of the rows.
+ */
+class StripeWriter
+{
+    public:
+        /**
+         * Default constructor for the StripeWriter class, writes the header of the
+         * image.
+         * @param image_path The path to write the ".png" or ".jpg" image to.
+         * @param rows The height of the image in pixels.
+         * @param cols The width of the image in pixels.
+         * @param type The OpenCV type of the rows e.g. CV_8UC3.
+         * @exception ImageException Thrown when the image can't be written.
+         */
+        StripeWriter(const boost::filesystem::path &image_path, const int &rows, const int &cols, const int &type);
+
+        /**
+         * Destructor for the StripeWriter class, removes the image unless every
+         * row was written.
+         */
+        ~StripeWriter();
+
+        StripeWriter(const StripeWriter &) = delete;
+        StripeWriter &operator=(const StripeWriter &) = delete;
+
+        /**
+         * Write the next rows of the image, the image is finished once the final
+         * row has been written.
+         *
+         * @param rows The rows to write, must have the columns and type given to
+         * the constructor.
+         * @exception ImageException Thrown when the image can't be written.
+         */
+        void Write(const cv::Mat &rows);
+
+    private:
+        struct Encoder;
+
+        /**
+         * @property encoder
+         * The libpng or libjpeg state of the image being written.
+         */
+        std::unique_ptr<Encoder> encoder;
+};
+
+#endif // STRIPES_HPP
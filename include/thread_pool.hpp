@@ -0,0 +1,158 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+/**
+ * A persistent pool of worker threads which balance their load by stealing
+ * work from each other.
+ *
+ * Each worker owns a queue of tasks which it processes from the front, when its
+ * queue is empty it steals tasks from the back of the other queues. The thread
+ * which submits the work also helps to process it, so a pool of N threads only
+ * spawns N - 1 workers.
+ */
+class ThreadPool
+{
+    public:
+        /**
+         * Default constructor for the ThreadPool class.
+         * @param threads The total number of threads which will process work,
+         * including the thread which submits the work.
+         */
+        explicit ThreadPool(unsigned int threads);
+
+        /**
+         * Destructor for the ThreadPool class, waits for the workers to exit.
+         */
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        /**
+         * Get the process wide thread pool which is shared by every technique,
+         * it's created on first use with one thread per hardware thread.
+         *
+         * @return The process wide thread pool.
+         */
+        static ThreadPool &Instance();
+
+        /**
+         * Replace the process wide thread pool with one using the given number of
+         * threads. This must not be called whilst the pool is processing work.
+         *
+         * @param threads The total number of threads, zero uses one per hardware
+         * thread.
+         */
+        static void SetThreads(unsigned int threads);
+
+        /**
+         * @return The total number of threads which process work submitted to
+         * this pool.
+         */
+        unsigned int Threads() const;
+
+        /**
+         * Split the range [begin, end) into sub-ranges of at most grain elements and
+         * process them in parallel, returning once every sub-range is complete.
+         *
+         * @param begin The first index in the range.
+         * @param end One past the last index in the range.
+         * @param grain The maximum number of indexes processed by a single task.
+         * @param function Called with the [begin, end) of each sub-range.
+         * @exception std::exception The first exception thrown by function is
+         * rethrown once every sub-range is complete.
+         */
+        void ParallelFor(std::size_t begin, std::size_t end, std::size_t grain,
+                const std::function<void(std::size_t, std::size_t)> &function);
+
+    private:
+        /**
+         * A queue of tasks owned by a single worker.
+         */
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        /**
+         * @property queues
+         * One task queue per worker thread.
+         */
+        std::vector<std::unique_ptr<Queue>> queues;
+
+        /**
+         * @property workers
+         * The worker threads which process the queued tasks.
+         */
+        std::vector<std::thread> workers;
+
+        /**
+         * @property pending
+         * The number of tasks which are queued but have not been started.
+         */
+        std::atomic<std::size_t> pending;
+
+        /**
+         * @property stopping
+         * Set when the workers should exit.
+         */
+        bool stopping;
+
+        /**
+         * @property mutex
+         * Guards sleeping workers, used with the condition variable below.
+         */
+        std::mutex mutex;
+
+        /**
+         * @property condition
+         * Wakes the workers when new tasks are queued.
+         */
+        std::condition_variable condition;
+
+        /**
+         * The main loop of each worker thread.
+         *
+         * @param index The index of the queue owned by this worker.
+         */
+        void Work(std::size_t index);
+
+        /**
+         * Run a single task, preferring the front of the given queue before
+         * stealing from the back of the others.
+         *
+         * @param index The queue to check first.
+         * @return Whether a task was run.
+         */
+        bool RunTask(std::size_t index);
+};
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,148 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#ifndef TRACER_HPP
+#define TRACER_HPP
+
+/**
+ * Records a span for every chunk of a payload which is encoded/decoded, and
+ * writes them as a Chrome trace_event timeline which can be loaded into
+ * chrome://tracing or Perfetto.
+ *
+ * Each thread records into its own fixed size ring buffer, so after a thread's
+ * first span recording never takes a lock or allocates; once a ring is full its
+ * oldest spans are overwritten. Tracing is off unless it's enabled, whilst it's off a span costs
+ * a single check of a flag.
+ */
+class Tracer
+{
+    public:
+        /**
+         * Start recording spans, discarding those recorded so far. This must not
+         * be called whilst a payload is being encoded/decoded.
+         *
+         * @param capacity The number of spans kept for each thread.
+         */
+        static void Enable(const std::size_t &capacity = 65536);
+
+        /**
+         * Stop recording spans.
+         */
+        static void Disable();
+
+        /**
+         * Write the recorded spans as Chrome trace_event JSON. This must not be
+         * called whilst a payload is being encoded/decoded.
+         *
+         * @param output The stream to write the JSON to.
+         */
+        static void Write(std::ostream &output);
+
+        /**
+         * Records a single span from its construction to its destruction.
+         */
+        class Span
+        {
+            public:
+                /**
+                 * Default constructor for the Span class, starts the span if
+                 * tracing is enabled.
+                 * @param name The name of the span, must be a string literal.
+                 * @param start_bit The bit index of the first bit in the chunk.
+                 * @param bytes The number of payload bytes in the chunk.
+                 * @param blocks The number of 8x8 blocks touched by the chunk.
+                 */
+                inline Span(const char *name, const std::size_t &start_bit, const std::size_t &bytes, const std::size_t &blocks = 0)
+                    : name(nullptr)
+                {
+                    if (Tracer::enabled.load(std::memory_order_relaxed))
+                    {
+                        this->name = name;
+                        this->start_bit = start_bit;
+                        this->bytes = bytes;
+                        this->blocks = blocks;
+                        this->start = std::chrono::steady_clock::now();
+                    }
+                }
+
+                /**
+                 * Destructor for the Span class, records the span.
+                 */
+                inline ~Span()
+                {
+                    if (this->name)
+                    {
+                        this->End();
+                    }
+                }
+
+                Span(const Span &) = delete;
+                Span &operator=(const Span &) = delete;
+
+            private:
+                /**
+                 * @property name
+                 * The name of the span, null when tracing was disabled.
+                 */
+                const char *name;
+
+                /**
+                 * @property start_bit
+                 * The bit index of the first bit in the chunk.
+                 */
+                std::size_t start_bit;
+
+                /**
+                 * @property bytes
+                 * The number of payload bytes in the chunk.
+                 */
+                std::size_t bytes;
+
+                /**
+                 * @property blocks
+                 * The number of 8x8 blocks touched by the chunk.
+                 */
+                std::size_t blocks;
+
+                /**
+                 * @property start
+                 * The time at which the span started.
+                 */
+                std::chrono::steady_clock::time_point start;
+
+                /**
+                 * Measure the duration of the span and record it in the calling
+                 * thread's ring of spans.
+                 */
+                void End();
+        };
+
+    private:
+        /**
+         * @property enabled
+         * Whether spans are being recorded.
+         */
+        static std::atomic<bool> enabled;
+};
+
+#endif // TRACER_HPP
@@ -0,0 +1,278 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include "batch.hpp"
+#include "bounded_queue.hpp"
+#include "least_significant_bit.hpp"
+#include "discrete_cosine_transform.hpp"
+#include "jpeg_coefficients.hpp"
+
+BatchEncoder::BatchEncoder(const unsigned int &threads, const int &persistence)
+    : threads(std::max(threads, 1U)), persistence(persistence), bits_per_sample(1), channels(1), pairs(1), matrix_bits(0),
+      fixed_point(false)
+{
+}
+
+std::vector<BatchJob> BatchEncoder::ReadManifest(const boost::filesystem::path &manifest_path, const std::string &technique)
+{
+    boost::filesystem::ifstream manifest(manifest_path);
+
+    if (!manifest.good())
+    {
+        throw EncodeException("Error: Failed to open manifest");
+    }
+
+    std::vector<BatchJob> jobs;
+    std::string line;
+
+    for (int number = 1; std::getline(manifest, line); number++)
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        // Split the line into its tab separated fields
+        std::vector<std::string> fields;
+        std::istringstream stream(line);
+
+        for (std::string field; std::getline(stream, field, '\t');)
+        {
+            fields.push_back(field);
+        }
+
+        if (fields.size() < 2 || fields.size() > 4 || fields[0].empty() || fields[1].empty())
+        {
+            throw EncodeException("Error: Malformed job on line " + std::to_string(number) + " of the manifest");
+        }
+
+        BatchJob job;
+        job.carrier_path = fields[0];
+        job.payload_path = fields[1];
+        job.technique = (fields.size() > 2 && !fields[2].empty()) ? fields[2] : technique;
+
+        if (job.technique != "lsb" && job.technique != "dct" && job.technique != "jpeg")
+        {
+            throw EncodeException("Error: Unknown technique on line " + std::to_string(number) + " of the manifest");
+        }
+
+        // Default to the same output path as the encode command
+        if (fields.size() > 3 && !fields[3].empty())
+        {
+            job.output_path = fields[3];
+        }
+        else
+        {
+            job.output_path = "steg-" + job.carrier_path.filename().replace_extension(job.technique == "lsb" ? ".png" : ".jpg").string();
+        }
+
+        jobs.push_back(job);
+    }
+
+    return jobs;
+}
+
+BatchReport BatchEncoder::Run(const std::vector<BatchJob> &jobs)
+{
+    BatchReport report;
+    report.completed = 0;
+
+    std::mutex report_mutex;
+    const std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+    auto fail = [&](const BatchJob &job, const std::string &message)
+    {
+        std::lock_guard<std::mutex> lock(report_mutex);
+        report.errors.push_back(job.carrier_path.string() + ": " + message);
+    };
+
+    // Allow each stage to run a couple of jobs ahead of the next one
+    BoundedQueue<std::unique_ptr<Task>> loaded(this->threads * 2);
+    BoundedQueue<std::unique_ptr<Task>> embedded(this->threads * 2);
+
+    std::atomic<std::size_t> next(0);
+    std::atomic<unsigned int> readers(this->threads);
+    std::atomic<unsigned int> embedders(this->threads);
+
+    std::vector<std::thread> workers;
+
+    for (unsigned int i = 0; i < this->threads; i++)
+    {
+        // Decode the carrier image and map the payload
+        workers.push_back(std::thread([&]()
+        {
+            for (std::size_t index; (index = next++) < jobs.size();)
+            {
+                std::unique_ptr<Task> task(new Task());
+                task->job = &jobs[index];
+
+                try
+                {
+                    task->steganography = this->Open(jobs[index]);
+                    task->payload.reset(new PayloadReader(jobs[index].payload_path));
+                }
+                catch (std::exception &e)
+                {
+                    fail(jobs[index], e.what());
+                    continue;
+                }
+
+                loaded.Push(std::move(task));
+            }
+
+            if (--readers == 0)
+            {
+                loaded.Close();
+            }
+        }));
+
+        // Embed the payload into the carrier image
+        workers.push_back(std::thread([&]()
+        {
+            std::unique_ptr<Task> task;
+
+            while (loaded.Pop(&task))
+            {
+                try
+                {
+                    task->steganography->Embed(task->job->payload_path.filename().string(), task->payload->Data(), task->payload->Size());
+                    task->payload.reset();
+                }
+                catch (std::exception &e)
+                {
+                    fail(*task->job, e.what());
+                    continue;
+                }
+
+                embedded.Push(std::move(task));
+            }
+
+            if (--embedders == 0)
+            {
+                embedded.Close();
+            }
+        }));
+
+        // Encode the steganographic image and write it to disk
+        workers.push_back(std::thread([&]()
+        {
+            std::unique_ptr<Task> task;
+
+            while (embedded.Pop(&task))
+            {
+                bool written = false;
+
+                try
+                {
+                    std::vector<unsigned char> image_bytes = task->steganography->EncodeImage();
+                    task->steganography.reset();
+
+                    boost::filesystem::ofstream output(task->job->output_path, std::ios::binary);
+                    written = true;
+                    output.write(reinterpret_cast<const char *>(image_bytes.data()), image_bytes.size());
+                    output.close();
+
+                    if (image_bytes.empty() || output.fail())
+                    {
+                        throw EncodeException("Error: Failed to write steganographic image");
+                    }
+                }
+                catch (std::exception &e)
+                {
+                    // A partially written image is never left behind
+                    boost::system::error_code error;
+
+                    if (written && boost::filesystem::is_regular_file(task->job->output_path, error))
+                    {
+                        boost::filesystem::remove(task->job->output_path, error);
+                    }
+
+                    fail(*task->job, e.what());
+                    continue;
+                }
+
+                std::lock_guard<std::mutex> lock(report_mutex);
+                report.completed++;
+            }
+        }));
+    }
+
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    return report;
+}
+
+void BatchEncoder::SetBitsPerSample(const int &bits)
+{
+    this->bits_per_sample = bits;
+}
+
+void BatchEncoder::SetLayout(const int &channels, const int &pairs)
+{
+    this->channels = channels;
+    this->pairs = pairs;
+}
+
+void BatchEncoder::SetMatrixEmbedding(const int &bits)
+{
+    this->matrix_bits = bits;
+}
+
+void BatchEncoder::SetFixedPoint(const bool &fixed_point)
+{
+    this->fixed_point = fixed_point;
+}
+
+std::unique_ptr<Steganography> BatchEncoder::Open(const BatchJob &job)
+{
+    if (job.technique == "lsb")
+    {
+        std::unique_ptr<LeastSignificantBit> lsb(new LeastSignificantBit(job.carrier_path));
+        lsb->SetBitsPerSample(this->bits_per_sample);
+
+        return std::move(lsb);
+    }
+
+    else if (job.technique == "dct")
+    {
+        std::unique_ptr<DiscreteCosineTransform> dct(new DiscreteCosineTransform(job.carrier_path, this->persistence));
+        dct->SetLayout(this->channels, this->pairs);
+        dct->SetMatrixEmbedding(this->matrix_bits);
+        dct->SetFixedPoint(this->fixed_point);
+
+        return std::move(dct);
+    }
+
+    else if (job.technique == "jpeg")
+    {
+        return std::unique_ptr<Steganography>(new JpegCoefficients(job.carrier_path, this->persistence));
+    }
+
+    throw EncodeException("Error: Unknown technique \"" + job.technique + "\"");
+}
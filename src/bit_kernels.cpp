@@ -0,0 +1,298 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <cstdint>
+#include <cstring>
+#include "bit_kernels.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BIT_KERNELS_X86
+#endif
+
+static void EmbedScalar(unsigned char *carrier, const unsigned char *payload, std::size_t length)
+{
+    for (std::size_t i = 0; i < length; i++, carrier += 8)
+    {
+        for (int bit = 0; bit < 8; bit++)
+        {
+            carrier[bit] = (carrier[bit] & 0xFE) | ((payload[i] >> bit) & 1);
+        }
+    }
+}
+
+static void ExtractScalar(const unsigned char *carrier, unsigned char *payload, std::size_t length)
+{
+    for (std::size_t i = 0; i < length; i++, carrier += 8)
+    {
+        unsigned char byte = 0;
+
+        for (int bit = 0; bit < 8; bit++)
+        {
+            byte |= (carrier[bit] & 1) << bit;
+        }
+
+        payload[i] = byte;
+    }
+}
+
+#ifdef BIT_KERNELS_X86
+
+// Repeat a byte across all eight bytes of a 64bit integer
+static inline long long Broadcast(const unsigned char &byte)
+{
+    return (long long)(byte * 0x0101010101010101ULL);
+}
+
+__attribute__((target("sse2")))
+static void EmbedSSE2(unsigned char *carrier, const unsigned char *payload, std::size_t length)
+{
+    // Carrier byte n stores bit (n % 8) of its payload byte
+    const __m128i select = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+    const __m128i clear = _mm_set1_epi8((char)0xFE);
+    const __m128i one = _mm_set1_epi8(1);
+
+    std::size_t i = 0;
+
+    for (; i + 2 <= length; i += 2, carrier += 16)
+    {
+        const __m128i bytes = _mm_set_epi64x(Broadcast(payload[i + 1]), Broadcast(payload[i]));
+        const __m128i bits = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(bytes, select), select), one);
+        const __m128i pixels = _mm_loadu_si128((const __m128i *)carrier);
+
+        _mm_storeu_si128((__m128i *)carrier, _mm_or_si128(_mm_and_si128(pixels, clear), bits));
+    }
+
+    EmbedScalar(carrier, payload + i, length - i);
+}
+
+__attribute__((target("sse2")))
+static void ExtractSSE2(const unsigned char *carrier, unsigned char *payload, std::size_t length)
+{
+    std::size_t i = 0;
+
+    // Move the least significant bit of each byte into the sign bit and pack 16 of them at once
+    for (; i + 2 <= length; i += 2, carrier += 16)
+    {
+        const __m128i pixels = _mm_loadu_si128((const __m128i *)carrier);
+        const uint16_t bits = (uint16_t)_mm_movemask_epi8(_mm_slli_epi16(pixels, 7));
+
+        std::memcpy(payload + i, &bits, sizeof(bits));
+    }
+
+    // Pack 8 at once for the final byte
+    for (; i < length; i++, carrier += 8)
+    {
+        const __m128i pixels = _mm_loadl_epi64((const __m128i *)carrier);
+        payload[i] = (unsigned char)_mm_movemask_epi8(_mm_slli_epi16(pixels, 7));
+    }
+}
+
+__attribute__((target("avx2")))
+static void EmbedAVX2(unsigned char *carrier, const unsigned char *payload, std::size_t length)
+{
+    // Carrier byte n stores bit (n % 8) of its payload byte
+    const __m256i select = _mm256_set1_epi64x((long long)0x8040201008040201ULL);
+    const __m256i clear = _mm256_set1_epi8((char)0xFE);
+    const __m256i one = _mm256_set1_epi8(1);
+
+    std::size_t i = 0;
+
+    for (; i + 4 <= length; i += 4, carrier += 32)
+    {
+        const __m256i bytes = _mm256_set_epi64x(Broadcast(payload[i + 3]), Broadcast(payload[i + 2]),
+                Broadcast(payload[i + 1]), Broadcast(payload[i]));
+        const __m256i mask = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, select), select);
+        const __m256i pixels = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)carrier), clear);
+
+        _mm256_storeu_si256((__m256i *)carrier, _mm256_blendv_epi8(pixels, _mm256_or_si256(pixels, one), mask));
+    }
+
+    EmbedSSE2(carrier, payload + i, length - i);
+}
+
+__attribute__((target("avx2")))
+static void ExtractAVX2(const unsigned char *carrier, unsigned char *payload, std::size_t length)
+{
+    std::size_t i = 0;
+
+    // Move the least significant bit of each byte into the sign bit and pack 32 of them at once
+    for (; i + 4 <= length; i += 4, carrier += 32)
+    {
+        const __m256i pixels = _mm256_loadu_si256((const __m256i *)carrier);
+        const uint32_t bits = (uint32_t)_mm256_movemask_epi8(_mm256_slli_epi16(pixels, 7));
+
+        std::memcpy(payload + i, &bits, sizeof(bits));
+    }
+
+    ExtractSSE2(carrier, payload + i, length - i);
+}
+
+#endif // BIT_KERNELS_X86
+
+static EmbedKernel SelectEmbedKernel()
+{
+#ifdef BIT_KERNELS_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return EmbedAVX2;
+    }
+
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return EmbedSSE2;
+    }
+#endif
+
+    return EmbedScalar;
+}
+
+static ExtractKernel SelectExtractKernel()
+{
+#ifdef BIT_KERNELS_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return ExtractAVX2;
+    }
+
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return ExtractSSE2;
+    }
+#endif
+
+    return ExtractScalar;
+}
+
+bool LookupBitKernels(const std::string &instruction_set, EmbedKernel *embed, ExtractKernel *extract)
+{
+#ifdef BIT_KERNELS_X86
+    if (instruction_set == "avx2")
+    {
+        *embed = EmbedAVX2;
+        *extract = ExtractAVX2;
+        return true;
+    }
+
+    if (instruction_set == "sse2")
+    {
+        *embed = EmbedSSE2;
+        *extract = ExtractSSE2;
+        return true;
+    }
+#endif
+
+    if (instruction_set == "scalar")
+    {
+        *embed = EmbedScalar;
+        *extract = ExtractScalar;
+        return true;
+    }
+
+    return false;
+}
+
+void EmbedBits(unsigned char *carrier, const unsigned char *payload, std::size_t length)
+{
+    static const EmbedKernel kernel = SelectEmbedKernel();
+    kernel(carrier, payload, length);
+}
+
+void ExtractBits(const unsigned char *carrier, unsigned char *payload, std::size_t length)
+{
+    static const ExtractKernel kernel = SelectExtractKernel();
+    kernel(carrier, payload, length);
+}
+
+template <typename Sample, int Bits>
+static void EmbedSamples(unsigned char *carrier, const unsigned char *payload, std::size_t units)
+{
+    Sample *samples = reinterpret_cast<Sample *>(carrier);
+    const uint32_t mask = (1U << Bits) - 1;
+
+    for (std::size_t unit = 0; unit < units; unit++, samples += 8, payload += Bits)
+    {
+        // The unit's bytes, least significant first, are spread across its eight samples
+        uint32_t word = 0;
+
+        for (int byte = 0; byte < Bits; byte++)
+        {
+            word |= (uint32_t)payload[byte] << (byte * 8);
+        }
+
+        for (int sample = 0; sample < 8; sample++)
+        {
+            samples[sample] = (Sample)((samples[sample] & ~mask) | ((word >> (sample * Bits)) & mask));
+        }
+    }
+}
+
+template <typename Sample, int Bits>
+static void ExtractSamples(const unsigned char *carrier, unsigned char *payload, std::size_t units)
+{
+    const Sample *samples = reinterpret_cast<const Sample *>(carrier);
+    const uint32_t mask = (1U << Bits) - 1;
+
+    for (std::size_t unit = 0; unit < units; unit++, samples += 8, payload += Bits)
+    {
+        uint32_t word = 0;
+
+        for (int sample = 0; sample < 8; sample++)
+        {
+            word |= (samples[sample] & mask) << (sample * Bits);
+        }
+
+        for (int byte = 0; byte < Bits; byte++)
+        {
+            payload[byte] = (unsigned char)(word >> (byte * 8));
+        }
+    }
+}
+
+SampleEmbedKernel SelectSampleEmbedKernel(const std::size_t &sample_size, const int &bits)
+{
+    static const SampleEmbedKernel kernels[2][4] = {
+        {EmbedBits, EmbedSamples<uint8_t, 2>, EmbedSamples<uint8_t, 3>, EmbedSamples<uint8_t, 4>},
+        {EmbedSamples<uint16_t, 1>, EmbedSamples<uint16_t, 2>, EmbedSamples<uint16_t, 3>, EmbedSamples<uint16_t, 4>},
+    };
+
+    if (sample_size < 1 || sample_size > 2 || bits < 1 || bits > 4)
+    {
+        return nullptr;
+    }
+
+    return kernels[sample_size - 1][bits - 1];
+}
+
+SampleExtractKernel SelectSampleExtractKernel(const std::size_t &sample_size, const int &bits)
+{
+    static const SampleExtractKernel kernels[2][4] = {
+        {ExtractBits, ExtractSamples<uint8_t, 2>, ExtractSamples<uint8_t, 3>, ExtractSamples<uint8_t, 4>},
+        {ExtractSamples<uint16_t, 1>, ExtractSamples<uint16_t, 2>, ExtractSamples<uint16_t, 3>, ExtractSamples<uint16_t, 4>},
+    };
+
+    if (sample_size < 1 || sample_size > 2 || bits < 1 || bits > 4)
+    {
+        return nullptr;
+    }
+
+    return kernels[sample_size - 1][bits - 1];
+}
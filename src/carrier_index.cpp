@@ -0,0 +1,460 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <unordered_map>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/filesystem/fstream.hpp>
+#include "carrier_index.hpp"
+#include "crc32c.hpp"
+#include "payload.hpp"
+
+// The hidden directory of the pool holding the index, and the name and first line of the index
+static const std::string INDEX_DIRECTORY = ".steganography";
+static const std::string INDEX_FILENAME = "index";
+static const std::string INDEX_VERSION = "# steganography carrier index 2";
+
+// The path of the top of the pool within the index
+static const std::string POOL_ROOT = ".";
+
+/**
+ * Parse a carrier line of the index.
+ *
+ * @return Whether the line holds a carrier.
+ */
+static bool ParseEntry(const std::string &line, IndexEntry *entry)
+{
+    std::istringstream stream(line);
+    std::string path;
+    std::string hash;
+
+    if (!std::getline(stream, path, '\t') || path.empty())
+    {
+        return false;
+    }
+
+    stream >> entry->size >> entry->modified >> hash >> entry->info.format >> entry->info.rows >> entry->info.cols
+           >> entry->info.channels >> entry->info.depth >> entry->info.blocks;
+
+    if (!stream || hash.size() != 8 || hash.find_first_not_of("0123456789abcdef") != std::string::npos)
+    {
+        return false;
+    }
+
+    entry->path = path;
+    entry->hash = std::stoul(hash, nullptr, 16);
+
+    return true;
+}
+
+/**
+ * Parse a directory line of the index, whose path ends with a slash.
+ *
+ * @return Whether the line holds a directory.
+ */
+static bool ParseDirectory(const std::string &line, std::string *path, int64_t *modified)
+{
+    std::istringstream stream(line);
+
+    if (!std::getline(stream, *path, '\t') || path->size() < 2 || path->back() != '/')
+    {
+        return false;
+    }
+
+    path->pop_back();
+    stream >> *modified;
+
+    return (bool)stream;
+}
+
+/**
+ * Read the modification time of a directory in nanoseconds.
+ *
+ * @return Whether the directory exists.
+ */
+static bool DirectoryModified(const boost::filesystem::path &path, int64_t *modified)
+{
+    struct stat status;
+
+    if (stat(path.c_str(), &status) != 0 || !S_ISDIR(status.st_mode))
+    {
+        return false;
+    }
+
+    // A directory changed within the last second may change again without its time moving on, it's listed again next time
+    if (status.st_mtim.tv_sec >= time(nullptr) - 1)
+    {
+        *modified = -1;
+    }
+    else
+    {
+        *modified = ((int64_t)status.st_mtim.tv_sec * 1000000000) + status.st_mtim.tv_nsec;
+    }
+
+    return true;
+}
+
+/**
+ * Read the size, modification time, header and hash of a carrier.
+ *
+ * @return Whether the file is a carrier image.
+ */
+static bool IndexCarrier(const boost::filesystem::path &path, IndexEntry *entry)
+{
+    try {
+        entry->size = boost::filesystem::file_size(path);
+        entry->modified = boost::filesystem::last_write_time(path);
+        entry->info = ReadCarrierInfo(path);
+
+        PayloadReader contents(path);
+        entry->hash = Crc32c(0, contents.Data(), contents.Size());
+    }
+    catch (boost::filesystem::filesystem_error &e)
+    {
+        return false;
+    }
+    catch (ImageException &e)
+    {
+        return false;
+    }
+    catch (EncodeException &e)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @return The path of the directory holding a carrier, relative to the pool.
+ */
+static std::string ParentDirectory(const boost::filesystem::path &path)
+{
+    return path.has_parent_path() ? path.parent_path().string() : POOL_ROOT;
+}
+
+CarrierIndex::CarrierIndex(const boost::filesystem::path &pool_path) : pool_path(pool_path)
+{
+    if (!boost::filesystem::is_directory(pool_path))
+    {
+        throw EncodeException("Error: The carrier pool must be a directory");
+    }
+
+    boost::filesystem::ifstream index(pool_path / INDEX_DIRECTORY / INDEX_FILENAME);
+    std::string line;
+
+    // An index written by another version is rebuilt
+    if (!std::getline(index, line) || line != INDEX_VERSION)
+    {
+        return;
+    }
+
+    while (std::getline(index, line))
+    {
+        IndexEntry entry;
+        std::string directory;
+        int64_t modified;
+
+        if (ParseDirectory(line, &directory, &modified))
+        {
+            this->directories[directory] = modified;
+        }
+        else if (ParseEntry(line, &entry))
+        {
+            this->entries.push_back(entry);
+        }
+    }
+
+    std::sort(this->entries.begin(), this->entries.end(), [](const IndexEntry &a, const IndexEntry &b)
+    {
+        return a.path < b.path;
+    });
+}
+
+std::size_t CarrierIndex::Update()
+{
+    std::map<std::string, std::vector<const IndexEntry *>> files;
+    std::map<std::string, std::vector<std::string>> subdirectories;
+
+    for (const IndexEntry &entry : this->entries)
+    {
+        files[ParentDirectory(entry.path)].push_back(&entry);
+    }
+
+    for (const auto &directory : this->directories)
+    {
+        if (directory.first != POOL_ROOT)
+        {
+            subdirectories[ParentDirectory(directory.first)].push_back(directory.first);
+        }
+    }
+
+    std::vector<IndexEntry> entries;
+    std::map<std::string, int64_t> directories;
+    std::size_t updated = this->Scan(POOL_ROOT, files, subdirectories, &entries, &directories);
+
+    std::sort(entries.begin(), entries.end(), [](const IndexEntry &a, const IndexEntry &b)
+    {
+        return a.path < b.path;
+    });
+
+    // Nothing was added, changed or removed, and no directory needs listing again
+    if (updated == 0 && entries.size() == this->entries.size() && directories == this->directories)
+    {
+        return 0;
+    }
+
+    this->entries.swap(entries);
+    this->directories.swap(directories);
+    this->capacities.clear();
+    this->Save();
+
+    return updated;
+}
+
+std::size_t CarrierIndex::Scan(const boost::filesystem::path &directory,
+        const std::map<std::string, std::vector<const IndexEntry *>> &files,
+        const std::map<std::string, std::vector<std::string>> &subdirectories,
+        std::vector<IndexEntry> *entries, std::map<std::string, int64_t> *directories) const
+{
+    const boost::filesystem::path path = (directory == POOL_ROOT) ? this->pool_path : this->pool_path / directory;
+    int64_t modified;
+
+    // The directory was removed since the last update, along with its carriers
+    if (!DirectoryModified(path, &modified))
+    {
+        if (directory == POOL_ROOT)
+        {
+            throw EncodeException("Error: Failed to read the carrier pool");
+        }
+
+        return 0;
+    }
+
+    (*directories)[directory.string()] = modified;
+
+    const auto previous_directory = this->directories.find(directory.string());
+    const auto previous_files = files.find(directory.string());
+    std::size_t updated = 0;
+
+    // Nothing was added to or removed from an unchanged directory, its carriers are kept without being listed
+    if (modified != -1 && previous_directory != this->directories.end() && previous_directory->second == modified)
+    {
+        if (previous_files != files.end())
+        {
+            for (const IndexEntry *entry : previous_files->second)
+            {
+                entries->push_back(*entry);
+            }
+        }
+
+        const auto previous_subdirectories = subdirectories.find(directory.string());
+
+        if (previous_subdirectories != subdirectories.end())
+        {
+            for (const std::string &subdirectory : previous_subdirectories->second)
+            {
+                updated += this->Scan(subdirectory, files, subdirectories, entries, directories);
+            }
+        }
+
+        return updated;
+    }
+
+    std::unordered_map<std::string, const IndexEntry *> indexed;
+
+    if (previous_files != files.end())
+    {
+        for (const IndexEntry *entry : previous_files->second)
+        {
+            indexed[entry->path.string()] = entry;
+        }
+    }
+
+    try {
+        for (boost::filesystem::directory_iterator it(path), end; it != end; ++it)
+        {
+            const boost::filesystem::path relative = (directory == POOL_ROOT) ? it->path().filename() : directory / it->path().filename();
+
+            // Paths are stored one per line up to the first tab, as is the index itself
+            const std::string relative_path = relative.string();
+
+            if (relative_path.find_first_of("\t\n") != std::string::npos || relative_path == INDEX_DIRECTORY)
+            {
+                continue;
+            }
+
+            // Symbolic links to directories aren't followed, so the pool can't loop
+            if (boost::filesystem::is_directory(it->symlink_status()))
+            {
+                updated += this->Scan(relative, files, subdirectories, entries, directories);
+                continue;
+            }
+
+            if (!boost::filesystem::is_regular_file(it->status()))
+            {
+                continue;
+            }
+
+            IndexEntry entry;
+            entry.path = relative;
+            entry.size = boost::filesystem::file_size(it->path());
+            entry.modified = boost::filesystem::last_write_time(it->path());
+
+            // A carrier which hasn't changed keeps its entry, so only new carriers are opened
+            const auto previous = indexed.find(relative_path);
+
+            if (previous != indexed.end() && previous->second->size == entry.size && previous->second->modified == entry.modified)
+            {
+                entries->push_back(*previous->second);
+                continue;
+            }
+
+            if (IndexCarrier(it->path(), &entry))
+            {
+                entries->push_back(entry);
+                updated++;
+            }
+        }
+    }
+    catch (boost::filesystem::filesystem_error &e)
+    {
+        throw EncodeException("Error: Failed to read the carrier pool");
+    }
+
+    return updated;
+}
+
+const std::vector<IndexEntry> &CarrierIndex::Entries() const
+{
+    return this->entries;
+}
+
+boost::filesystem::path CarrierIndex::Select(const CarrierLayout &layout, const std::size_t &payload_size,
+        const std::size_t &filename_length)
+{
+    const std::string key = LayoutName(layout) + "/" + std::to_string(filename_length);
+
+    while (true)
+    {
+        std::multimap<std::size_t, std::size_t> &capacities = this->capacities[key];
+
+        if (capacities.empty())
+        {
+            for (std::size_t i = 0; i < this->entries.size(); i++)
+            {
+                capacities.emplace(PayloadCapacity(this->entries[i].info, layout, filename_length), i);
+            }
+        }
+
+        // The smallest carrier which fits, so the larger carriers are left for larger payloads
+        const auto best = capacities.lower_bound(std::max(payload_size, (std::size_t)1));
+
+        if (best == capacities.end())
+        {
+            throw EncodeException("Error: Failed to encode payload, no carrier in the pool is large enough");
+        }
+
+        const std::size_t index = best->second;
+        const boost::filesystem::path path = this->pool_path / this->entries[index].path;
+        boost::system::error_code error;
+
+        const std::uintmax_t size = boost::filesystem::file_size(path, error);
+        const std::time_t modified = error ? 0 : boost::filesystem::last_write_time(path, error);
+
+        if (!error && size == this->entries[index].size && modified == this->entries[index].modified)
+        {
+            return path;
+        }
+
+        // The carrier was rewritten or removed since it was indexed, index it again and pick again
+        IndexEntry entry;
+        entry.path = this->entries[index].path;
+
+        if (IndexCarrier(path, &entry))
+        {
+            this->entries[index] = entry;
+        }
+        else
+        {
+            this->entries.erase(this->entries.begin() + index);
+        }
+
+        this->capacities.clear();
+        this->Save();
+    }
+}
+
+void CarrierIndex::Save() const
+{
+    const boost::filesystem::path index_directory = this->pool_path / INDEX_DIRECTORY;
+    boost::system::error_code error;
+    boost::filesystem::create_directories(index_directory, error);
+
+    // Each update writes its own temporary file, so concurrent updates don't write over each other
+    std::string temporary_path = (index_directory / (INDEX_FILENAME + ".XXXXXX")).string();
+    const int descriptor = mkstemp(&temporary_path[0]);
+
+    if (descriptor == -1)
+    {
+        throw EncodeException("Error: Failed to write the carrier index");
+    }
+
+    fchmod(descriptor, 0644);
+    close(descriptor);
+
+    {
+        boost::filesystem::ofstream index(temporary_path);
+        index << INDEX_VERSION << "\n";
+
+        for (const auto &directory : this->directories)
+        {
+            index << directory.first << "/\t" << directory.second << "\n";
+        }
+
+        for (const IndexEntry &entry : this->entries)
+        {
+            char hash[9];
+            snprintf(hash, sizeof(hash), "%08x", entry.hash);
+
+            index << entry.path.string() << "\t" << entry.size << "\t" << entry.modified << "\t" << hash << "\t"
+                  << entry.info.format << "\t" << entry.info.rows << "\t" << entry.info.cols << "\t"
+                  << entry.info.channels << "\t" << entry.info.depth << "\t" << entry.info.blocks << "\n";
+        }
+
+        index.close();
+
+        if (index.fail())
+        {
+            boost::filesystem::remove(temporary_path, error);
+            throw EncodeException("Error: Failed to write the carrier index");
+        }
+    }
+
+    // Readers see either the previous index or this one as a whole
+    boost::filesystem::rename(temporary_path, index_directory / INDEX_FILENAME, error);
+
+    if (error)
+    {
+        boost::filesystem::remove(temporary_path, error);
+        throw EncodeException("Error: Failed to write the carrier index");
+    }
+}
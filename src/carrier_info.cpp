@@ -0,0 +1,361 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <algorithm>
+#include <cstdint>
+#include <boost/filesystem/fstream.hpp>
+#include "carrier_info.hpp"
+#include "container_header.hpp"
+#include "discrete_cosine_transform.hpp"
+#include "least_significant_bit.hpp"
+
+/**
+ * Load an unsigned integer of the given number of bytes, in either byte order.
+ */
+static uint32_t LoadInteger(const unsigned char *bytes, const int &size, const bool &little_endian)
+{
+    uint32_t value = 0;
+
+    for (int byte = 0; byte < size; byte++)
+    {
+        value |= (uint32_t)bytes[little_endian ? byte : size - byte - 1] << (byte * 8);
+    }
+
+    return value;
+}
+
+/**
+ * Read the given number of bytes from the image.
+ */
+static void ReadBytes(boost::filesystem::ifstream &file, unsigned char *bytes, const std::size_t &size)
+{
+    if (!file.read(reinterpret_cast<char *>(bytes), size))
+    {
+        throw ImageException("Error: Failed to read image header");
+    }
+}
+
+/**
+ * Read the chunks of a PNG up to its image data, the signature has been read.
+ */
+static CarrierInfo ReadPngInfo(boost::filesystem::ifstream &file)
+{
+    CarrierInfo info = {"png", 0, 0, 0, 0, 0};
+    int color_type = -1;
+    bool transparency = false;
+
+    // The IHDR chunk comes first, a tRNS chunk may follow anywhere before the image data
+    for (unsigned char chunk[13];;)
+    {
+        ReadBytes(file, chunk, 8);
+
+        const uint32_t length = LoadInteger(chunk, 4, false);
+        const std::string type(chunk + 4, chunk + 8);
+
+        if (type == "IDAT" || type == "IEND")
+        {
+            break;
+        }
+        else if (type == "IHDR" && length == 13)
+        {
+            ReadBytes(file, chunk, 13);
+
+            info.cols = LoadInteger(chunk, 4, false);
+            info.rows = LoadInteger(chunk + 4, 4, false);
+            info.depth = (chunk[8] == 16) ? 16 : 8;
+            color_type = chunk[9];
+
+            file.seekg(4, std::ios::cur);
+        }
+        else
+        {
+            transparency |= (type == "tRNS");
+            file.seekg(length + 4, std::ios::cur);
+        }
+    }
+
+    // The same channels as the transformations of StripeReader, palettes are expanded and grayscale with alpha
+    // becomes BGRA
+    switch (color_type)
+    {
+        case 0:
+            info.channels = transparency ? 4 : 1;
+            break;
+        case 2:
+        case 3:
+            info.channels = transparency ? 4 : 3;
+            break;
+        case 4:
+        case 6:
+            info.channels = 4;
+            break;
+        default:
+            throw ImageException("Error: Failed to read image header");
+    }
+
+    return info;
+}
+
+/**
+ * Read the segments of a JPEG up to its SOF segment, the SOI marker has been read.
+ */
+static CarrierInfo ReadJpegInfo(boost::filesystem::ifstream &file)
+{
+    CarrierInfo info = {"jpeg", 0, 0, 0, 8, 0};
+    unsigned char bytes[2];
+
+    for (;;)
+    {
+        // Markers may be preceded by any number of fill bytes
+        ReadBytes(file, bytes, 1);
+
+        if (bytes[0] != 0xFF)
+        {
+            continue;
+        }
+
+        do
+        {
+            ReadBytes(file, bytes, 1);
+        }
+        while (bytes[0] == 0xFF);
+
+        const unsigned char marker = bytes[0];
+
+        // Restart markers, TEM and stuffed zeros have no segment
+        if ((marker >= 0xD0 && marker <= 0xD7) || marker == 0x01 || marker == 0x00)
+        {
+            continue;
+        }
+        else if (marker == 0xD9 || marker == 0xDA)
+        {
+            throw ImageException("Error: Failed to read image header");
+        }
+
+        ReadBytes(file, bytes, 2);
+        const uint32_t length = LoadInteger(bytes, 2, false);
+
+        // Every SOFn marker apart from DHT, JPG and DAC which share the range
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC && length >= 8)
+        {
+            std::vector<unsigned char> segment(length - 2);
+            ReadBytes(file, segment.data(), segment.size());
+
+            const int components = segment[5];
+
+            if (components < 1 || segment.size() < 6 + (std::size_t)components * 3)
+            {
+                throw ImageException("Error: Failed to read image header");
+            }
+
+            info.rows = LoadInteger(&segment[1], 2, false);
+            info.cols = LoadInteger(&segment[3], 2, false);
+            info.channels = (components == 1) ? 1 : 3;
+
+            // The blocks of the first component, which depend on its sampling relative to the largest
+            int max_h = 1;
+            int max_v = 1;
+
+            for (int component = 0; component < components; component++)
+            {
+                max_h = std::max(max_h, segment[7 + (component * 3)] >> 4);
+                max_v = std::max(max_v, segment[7 + (component * 3)] & 0x0F);
+            }
+
+            const std::size_t h = std::max(segment[7] >> 4, 1);
+            const std::size_t v = std::max(segment[7] & 0x0F, 1);
+
+            info.blocks = (((std::size_t)info.cols * h) + (8 * max_h) - 1) / (8 * max_h) *
+                ((((std::size_t)info.rows * v) + (8 * max_v) - 1) / (8 * max_v));
+
+            return info;
+        }
+
+        file.seekg(length - 2, std::ios::cur);
+    }
+}
+
+/**
+ * Read the first IFD of a TIFF, the byte order has been read.
+ */
+static CarrierInfo ReadTiffInfo(boost::filesystem::ifstream &file, const bool &little_endian)
+{
+    CarrierInfo info = {"tiff", 0, 0, 1, 8, 0};
+    unsigned char bytes[12];
+
+    ReadBytes(file, bytes, 6);
+
+    if (LoadInteger(bytes, 2, little_endian) != 42)
+    {
+        throw ImageException("Error: Failed to read image header");
+    }
+
+    file.seekg(LoadInteger(bytes + 2, 4, little_endian));
+    ReadBytes(file, bytes, 2);
+
+    std::vector<unsigned char> entries(LoadInteger(bytes, 2, little_endian) * 12);
+    ReadBytes(file, entries.data(), entries.size());
+
+    for (std::size_t entry = 0; entry < entries.size(); entry += 12)
+    {
+        const unsigned char *field = &entries[entry];
+        const uint32_t tag = LoadInteger(field, 2, little_endian);
+        const uint32_t count = LoadInteger(field + 4, 4, little_endian);
+
+        // A SHORT or LONG value, only the first is needed when there's one per sample
+        const int size = (LoadInteger(field + 2, 2, little_endian) == 3) ? 2 : 4;
+        uint32_t value = LoadInteger(field + 8, size, little_endian);
+
+        if (count * size > 4)
+        {
+            const std::streampos position = file.tellg();
+            file.seekg(value);
+            ReadBytes(file, bytes, size);
+            file.seekg(position);
+
+            value = LoadInteger(bytes, size, little_endian);
+        }
+
+        switch (tag)
+        {
+            case 256:
+                info.cols = value;
+                break;
+            case 257:
+                info.rows = value;
+                break;
+            case 258:
+                info.depth = (value <= 8) ? 8 : value;
+                break;
+            case 277:
+                info.channels = value;
+                break;
+        }
+    }
+
+    return info;
+}
+
+CarrierInfo ReadCarrierInfo(const boost::filesystem::path &image_path)
+{
+    boost::filesystem::ifstream file(image_path, std::ios::binary);
+
+    if (!file.good())
+    {
+        throw ImageException("Error: Failed to open input image");
+    }
+
+    const unsigned char png_signature[] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+    unsigned char signature[8] = {};
+    file.read(reinterpret_cast<char *>(signature), 2);
+
+    CarrierInfo info;
+
+    if (signature[0] == 0xFF && signature[1] == 0xD8)
+    {
+        info = ReadJpegInfo(file);
+    }
+    else if ((signature[0] == 'I' && signature[1] == 'I') || (signature[0] == 'M' && signature[1] == 'M'))
+    {
+        info = ReadTiffInfo(file, signature[0] == 'I');
+    }
+    else if (file.read(reinterpret_cast<char *>(signature) + 2, 6) && std::equal(signature, signature + 8, png_signature))
+    {
+        info = ReadPngInfo(file);
+    }
+    else
+    {
+        throw ImageException("Error: Carrier image must be a PNG, JPEG or TIFF");
+    }
+
+    if (info.rows <= 0 || info.cols <= 0)
+    {
+        throw ImageException("Error: Failed to read image header");
+    }
+
+    return info;
+}
+
+std::vector<CarrierLayout> CarrierLayouts(const CarrierInfo &info)
+{
+    std::vector<CarrierLayout> layouts;
+
+    // The LSB technique only stores 8 and 16 bit samples
+    if (info.depth <= 16)
+    {
+        for (int bits = 1; bits <= 4; bits++)
+        {
+            layouts.push_back({"lsb", bits, 0, 0});
+        }
+    }
+
+    for (int channels = 1; channels <= DiscreteCosineTransform::LayoutChannels(info.channels, 0); channels++)
+    {
+        for (const int pairs : {1, 2, 4, 8})
+        {
+            layouts.push_back({"dct", 0, channels, pairs});
+        }
+    }
+
+    if (info.format == "jpeg")
+    {
+        layouts.push_back({"jpeg", 0, 0, 0});
+    }
+
+    return layouts;
+}
+
+std::string LayoutName(const CarrierLayout &layout)
+{
+    if (layout.technique == "lsb")
+    {
+        return "lsb:" + std::to_string(layout.bits_per_sample);
+    }
+    else if (layout.technique == "dct")
+    {
+        return "dct:" + std::to_string(layout.channels) + "x" + std::to_string(layout.pairs);
+    }
+
+    return layout.technique;
+}
+
+std::size_t PayloadCapacity(const CarrierInfo &info, const CarrierLayout &layout, const std::size_t &filename_length)
+{
+    std::size_t capacity = 0;
+    std::size_t payload_start = 0;
+
+    if (layout.technique == "lsb")
+    {
+        capacity = LeastSignificantBit::LayoutCapacity(info.rows, info.cols, info.channels, layout.bits_per_sample);
+        payload_start = LeastSignificantBit::LayoutPayloadStart(layout.bits_per_sample, filename_length);
+    }
+    else if (layout.technique == "dct")
+    {
+        const int channels = DiscreteCosineTransform::LayoutChannels(info.channels, layout.channels);
+
+        capacity = DiscreteCosineTransform::LayoutCapacity(info.rows, info.cols, channels, layout.pairs);
+        payload_start = DiscreteCosineTransform::LayoutPayloadStart(channels, layout.pairs, filename_length);
+    }
+    else if (layout.technique == "jpeg")
+    {
+        // A bit per block of the first component, as JpegCoefficients
+        capacity = info.blocks;
+        payload_start = HEADER_BITS + (filename_length * 8);
+    }
+
+    return (capacity > payload_start) ? (capacity - payload_start) / 8 : 0;
+}
@@ -0,0 +1,126 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <algorithm>
+#include "container_header.hpp"
+#include "crc32c.hpp"
+
+const unsigned char MAGIC[MAGIC_SIZE] = {0x89, 'S', 'T', 'G'};
+
+/**
+ * Store an integer in the given number of bytes, least significant byte first.
+ */
+static void StoreInteger(const uint64_t &value, const int &size, unsigned char *bytes)
+{
+    for (int byte = 0; byte < size; byte++)
+    {
+        bytes[byte] = (value >> (byte * 8)) & 0xFF;
+    }
+}
+
+/**
+ * Load an integer which was stored by StoreInteger.
+ */
+static uint64_t LoadInteger(const unsigned char *bytes, const int &size)
+{
+    uint64_t value = 0;
+
+    for (int byte = 0; byte < size; byte++)
+    {
+        value |= (uint64_t)bytes[byte] << (byte * 8);
+    }
+
+    return value;
+}
+
+void StoreHeader(const ContainerHeader &header, unsigned char *bytes)
+{
+    std::copy(MAGIC, MAGIC + MAGIC_SIZE, bytes);
+
+    bytes[4] = CONTAINER_VERSION;
+    bytes[5] = header.technique;
+    StoreInteger(std::min(std::max(header.persistence, 0), 0xFFFF), 2, bytes + 6);
+    bytes[8] = header.bits_per_sample;
+    bytes[9] = header.channels;
+    bytes[10] = header.pairs;
+    bytes[11] = header.matrix_bits;
+    StoreInteger(header.filename_length, 4, bytes + 12);
+    StoreInteger(header.payload_length, 8, bytes + 16);
+    StoreInteger(header.payload_crc, 4, bytes + 24);
+    StoreInteger(Crc32c(0, bytes, 28), 4, bytes + 28);
+}
+
+bool HasMagic(const unsigned char *bytes)
+{
+    return std::equal(MAGIC, MAGIC + MAGIC_SIZE, bytes);
+}
+
+ContainerHeader LoadHeader(const unsigned char *bytes, const unsigned char &technique)
+{
+    if (!HasMagic(bytes))
+    {
+        throw DecodeException("Error: Carrier image doesn't contain a payload");
+    }
+
+    if (LoadInteger(bytes + 28, 4) != Crc32c(0, bytes, 28))
+    {
+        throw DecodeException("Error: Payload header is corrupt");
+    }
+
+    if (bytes[4] != CONTAINER_VERSION)
+    {
+        throw DecodeException("Error: Payload was encoded by an unsupported version");
+    }
+
+    if (bytes[5] != technique)
+    {
+        throw DecodeException("Error: Payload was encoded using a different technique");
+    }
+
+    ContainerHeader header;
+    header.technique = bytes[5];
+    header.persistence = LoadInteger(bytes + 6, 2);
+    header.bits_per_sample = bytes[8];
+    header.channels = bytes[9];
+    header.pairs = bytes[10];
+    header.matrix_bits = bytes[11];
+    header.filename_length = LoadInteger(bytes + 12, 4);
+    header.payload_length = LoadInteger(bytes + 16, 8);
+    header.payload_crc = LoadInteger(bytes + 24, 4);
+
+    if (header.filename_length == 0 || header.payload_length == 0)
+    {
+        throw DecodeException("Error: Failed to decode payload length");
+    }
+
+    return header;
+}
+
+void CheckCapacity(const ContainerHeader &header, const std::size_t &payload_start, const std::size_t &capacity)
+{
+    if (payload_start > capacity || header.payload_length > (capacity - payload_start) / 8)
+    {
+        throw DecodeException("Error: Failed to decode payload length");
+    }
+}
+
+void VerifyPayload(const ContainerHeader &header, const uint32_t &payload_crc)
+{
+    if (payload_crc != header.payload_crc)
+    {
+        throw DecodeException("Error: Payload failed its integrity check");
+    }
+}
@@ -0,0 +1,122 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cstring>
+#include "crc32c.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CRC32C_X86
+#endif
+
+typedef uint32_t (*Crc32cKernel)(uint32_t, const unsigned char *, std::size_t);
+
+// The reflected Castagnoli polynomial
+const uint32_t POLYNOMIAL = 0x82F63B78;
+
+/**
+ * A lookup table of the checksum of every byte value.
+ */
+struct Crc32cTable
+{
+    uint32_t entries[256];
+
+    Crc32cTable()
+    {
+        for (uint32_t byte = 0; byte < 256; byte++)
+        {
+            uint32_t crc = byte;
+
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc >> 1) ^ ((crc & 1) ? POLYNOMIAL : 0);
+            }
+
+            this->entries[byte] = crc;
+        }
+    }
+};
+
+static uint32_t Crc32cScalar(uint32_t crc, const unsigned char *data, std::size_t length)
+{
+    static const Crc32cTable table;
+
+    for (std::size_t i = 0; i < length; i++)
+    {
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+
+#ifdef CRC32C_X86
+
+__attribute__((target("sse4.2")))
+static uint32_t Crc32cSSE42(uint32_t crc, const unsigned char *data, std::size_t length)
+{
+    std::size_t i = 0;
+
+#ifdef __x86_64__
+    uint64_t wide = crc;
+
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        wide = _mm_crc32_u64(wide, word);
+    }
+
+    crc = (uint32_t)wide;
+#endif
+
+    for (; i + 4 <= length; i += 4)
+    {
+        uint32_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        crc = _mm_crc32_u32(crc, word);
+    }
+
+    for (; i < length; i++)
+    {
+        crc = _mm_crc32_u8(crc, data[i]);
+    }
+
+    return crc;
+}
+
+#endif // CRC32C_X86
+
+static Crc32cKernel SelectCrc32cKernel()
+{
+#ifdef CRC32C_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        return Crc32cSSE42;
+    }
+#endif
+
+    return Crc32cScalar;
+}
+
+uint32_t Crc32c(const uint32_t &crc, const unsigned char *data, std::size_t length)
+{
+    static const Crc32cKernel kernel = SelectCrc32cKernel();
+
+    // The checksum is kept inverted between parts
+    return ~kernel(~crc, data, length);
+}
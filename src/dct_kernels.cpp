@@ -0,0 +1,350 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <algorithm>
+#include <cstdint>
+#include "dct_kernels.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define DCT_KERNELS_X86
+#endif
+
+// The (0, 2) and (2, 0) coefficients only depend on the column and row sums of
+// the block weighted by the second DCT basis function, which is held here as
+// Q12 fixed point. Every other basis function contributes nothing to them.
+const int32_t BASIS_A = 1892;
+const int32_t BASIS_B = 784;
+const int32_t BASIS[8] = {BASIS_A, BASIS_B, -BASIS_B, -BASIS_A, -BASIS_A, -BASIS_B, BASIS_B, BASIS_A};
+
+// A coefficient is a(0) * sum / 4096, so the persistence is scaled by 4096 / a(0)
+const int32_t PERSISTENCE_SCALE = 11585;
+const int32_t PERSISTENCE_LIMIT = 65535;
+
+// The largest change to a weighted sum once it has been reduced by 256, this
+// keeps the products below within 32 bits
+const int32_t DELTA_LIMIT = 1 << 20;
+
+// The largest change to a sample, in 1/16ths, from a single coefficient
+const int32_t TERM_LIMIT = 32767;
+
+typedef void (*EmbedBlocksKernel)(unsigned char *, std::ptrdiff_t, unsigned char, int32_t);
+
+static inline int32_t ScalePersistence(int persistence)
+{
+    return std::min(std::max(persistence, -PERSISTENCE_LIMIT), PERSISTENCE_LIMIT) * PERSISTENCE_SCALE;
+}
+
+static inline int32_t Saturate16(int32_t value)
+{
+    return std::min(std::max(value, (int32_t)-32768), (int32_t)32767);
+}
+
+// Reduce the change to a weighted sum so that it can be multiplied by the basis
+static inline int32_t ReduceDelta(int32_t delta)
+{
+    return std::min(std::max((delta + 128) >> 8, -DELTA_LIMIT), DELTA_LIMIT);
+}
+
+// The change to each sample along one axis, in 1/16ths, for a reduced change in
+// the weighted sum along that axis
+static inline void Terms(int32_t delta, int16_t *terms)
+{
+    const int16_t a = (int16_t)std::min(std::max((delta * BASIS_A + 16384) >> 15, -TERM_LIMIT), TERM_LIMIT);
+    const int16_t b = (int16_t)std::min(std::max((delta * BASIS_B + 16384) >> 15, -TERM_LIMIT), TERM_LIMIT);
+
+    terms[0] = a; terms[1] = b; terms[2] = -b; terms[3] = -a;
+    terms[4] = -a; terms[5] = -b; terms[6] = b; terms[7] = a;
+}
+
+static void EmbedBlockScalar(unsigned char *pixels, std::ptrdiff_t row_step, std::size_t pixel_step, int bit, int32_t persistence)
+{
+    int32_t row_sums[8] = {0};
+    int32_t col_sums[8] = {0};
+
+    for (int row = 0; row < 8; row++)
+    {
+        for (int col = 0; col < 8; col++)
+        {
+            const int32_t sample = pixels[(row * row_step) + (col * pixel_step)];
+
+            row_sums[row] += sample;
+            col_sums[col] += sample;
+        }
+    }
+
+    // The (0, 2) coefficient is low, the (2, 0) coefficient is high
+    int32_t low = 0;
+    int32_t high = 0;
+
+    for (int i = 0; i < 8; i++)
+    {
+        low += BASIS[i] * col_sums[i];
+        high += BASIS[i] * row_sums[i];
+    }
+
+    // Swap the coefficients so that low is low and high is high, and apply the persistence value
+    const int32_t minimum = std::min(low, high) - persistence;
+    const int32_t maximum = std::max(low, high) + persistence;
+
+    int16_t col_terms[8];
+    int16_t row_terms[8];
+    Terms(ReduceDelta((bit ? minimum : maximum) - low), col_terms);
+    Terms(ReduceDelta((bit ? maximum : minimum) - high), row_terms);
+
+    for (int row = 0; row < 8; row++)
+    {
+        for (int col = 0; col < 8; col++)
+        {
+            unsigned char *sample = pixels + (row * row_step) + (col * pixel_step);
+            const int32_t value = Saturate16(Saturate16((*sample * 16) + col_terms[col]) + row_terms[row]);
+
+            *sample = (unsigned char)std::min(std::max(Saturate16(value + 8) >> 4, 0), 255);
+        }
+    }
+}
+
+static void EmbedBlocksScalar(unsigned char *tile, std::ptrdiff_t tile_step, unsigned char bits, int32_t persistence)
+{
+    for (int block = 0; block < 8; block++)
+    {
+        EmbedBlockScalar(tile + (block * 8), tile_step, 1, (bits >> block) & 1, persistence);
+    }
+}
+
+#ifdef DCT_KERNELS_X86
+
+__attribute__((target("sse4.1")))
+static void EmbedBlocksSSE41(unsigned char *tile, std::ptrdiff_t tile_step, unsigned char bits, int32_t persistence)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i basis = _mm_setr_epi16(BASIS_A, BASIS_B, -BASIS_B, -BASIS_A, -BASIS_A, -BASIS_B, BASIS_B, BASIS_A);
+    const __m128i select = _mm_setr_epi32(1, 2, 4, 8);
+
+    // Process the eight blocks as two groups of four
+    for (int group = 0; group < 2; group++, tile += 32, bits >>= 4)
+    {
+        __m128i col_sums[4] = {zero, zero, zero, zero};
+        __m128i high_01 = zero;
+        __m128i high_23 = zero;
+
+        for (int row = 0; row < 8; row++)
+        {
+            const unsigned char *samples = tile + (row * tile_step);
+            const __m128i samples_01 = _mm_loadu_si128((const __m128i *)samples);
+            const __m128i samples_23 = _mm_loadu_si128((const __m128i *)(samples + 16));
+            const __m128i weight = _mm_set1_epi64x(BASIS[row]);
+
+            // The row sum of each block lands in its own 64bit lane
+            high_01 = _mm_add_epi64(high_01, _mm_mul_epi32(_mm_sad_epu8(samples_01, zero), weight));
+            high_23 = _mm_add_epi64(high_23, _mm_mul_epi32(_mm_sad_epu8(samples_23, zero), weight));
+
+            col_sums[0] = _mm_add_epi16(col_sums[0], _mm_cvtepu8_epi16(samples_01));
+            col_sums[1] = _mm_add_epi16(col_sums[1], _mm_cvtepu8_epi16(_mm_srli_si128(samples_01, 8)));
+            col_sums[2] = _mm_add_epi16(col_sums[2], _mm_cvtepu8_epi16(samples_23));
+            col_sums[3] = _mm_add_epi16(col_sums[3], _mm_cvtepu8_epi16(_mm_srli_si128(samples_23, 8)));
+        }
+
+        const __m128i low = _mm_hadd_epi32(
+                _mm_hadd_epi32(_mm_madd_epi16(col_sums[0], basis), _mm_madd_epi16(col_sums[1], basis)),
+                _mm_hadd_epi32(_mm_madd_epi16(col_sums[2], basis), _mm_madd_epi16(col_sums[3], basis)));
+        const __m128i high = _mm_unpacklo_epi64(_mm_shuffle_epi32(high_01, _MM_SHUFFLE(3, 1, 2, 0)),
+                _mm_shuffle_epi32(high_23, _MM_SHUFFLE(3, 1, 2, 0)));
+
+        // Swap the coefficients so that low is low and high is high, and apply the persistence value
+        const __m128i mask = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(bits & 0x0F), select), select);
+        const __m128i minimum = _mm_sub_epi32(_mm_min_epi32(low, high), _mm_set1_epi32(persistence));
+        const __m128i maximum = _mm_add_epi32(_mm_max_epi32(low, high), _mm_set1_epi32(persistence));
+
+        int32_t low_deltas[4];
+        int32_t high_deltas[4];
+        _mm_storeu_si128((__m128i *)low_deltas, _mm_sub_epi32(_mm_blendv_epi8(maximum, minimum, mask), low));
+        _mm_storeu_si128((__m128i *)high_deltas, _mm_sub_epi32(_mm_blendv_epi8(minimum, maximum, mask), high));
+
+        int16_t col_terms[4][8];
+        int16_t row_terms[4][8];
+
+        for (int block = 0; block < 4; block++)
+        {
+            Terms(ReduceDelta(low_deltas[block]), col_terms[block]);
+            Terms(ReduceDelta(high_deltas[block]), row_terms[block]);
+        }
+
+        const __m128i eight = _mm_set1_epi16(8);
+
+        for (int row = 0; row < 8; row++)
+        {
+            unsigned char *samples = tile + (row * tile_step);
+            __m128i results[4];
+
+            for (int block = 0; block < 4; block++)
+            {
+                __m128i value = _mm_slli_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(samples + (block * 8)))), 4);
+                value = _mm_adds_epi16(value, _mm_loadu_si128((const __m128i *)col_terms[block]));
+                value = _mm_adds_epi16(value, _mm_set1_epi16(row_terms[block][row]));
+
+                results[block] = _mm_srai_epi16(_mm_adds_epi16(value, eight), 4);
+            }
+
+            _mm_storeu_si128((__m128i *)samples, _mm_packus_epi16(results[0], results[1]));
+            _mm_storeu_si128((__m128i *)(samples + 16), _mm_packus_epi16(results[2], results[3]));
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void EmbedBlocksAVX2(unsigned char *tile, std::ptrdiff_t tile_step, unsigned char bits, int32_t persistence)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i basis = _mm256_setr_epi16(BASIS_A, BASIS_B, -BASIS_B, -BASIS_A, -BASIS_A, -BASIS_B, BASIS_B, BASIS_A,
+            BASIS_A, BASIS_B, -BASIS_B, -BASIS_A, -BASIS_A, -BASIS_B, BASIS_B, BASIS_A);
+    const __m256i select = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+    __m256i col_sums[4] = {zero, zero, zero, zero};
+    __m256i high_0123 = zero;
+    __m256i high_4567 = zero;
+
+    for (int row = 0; row < 8; row++)
+    {
+        const unsigned char *samples = tile + (row * tile_step);
+        const __m256i samples_0123 = _mm256_loadu_si256((const __m256i *)samples);
+        const __m256i samples_4567 = _mm256_loadu_si256((const __m256i *)(samples + 32));
+        const __m256i weight = _mm256_set1_epi64x(BASIS[row]);
+
+        // The row sum of each block lands in its own 64bit lane
+        high_0123 = _mm256_add_epi64(high_0123, _mm256_mul_epi32(_mm256_sad_epu8(samples_0123, zero), weight));
+        high_4567 = _mm256_add_epi64(high_4567, _mm256_mul_epi32(_mm256_sad_epu8(samples_4567, zero), weight));
+
+        col_sums[0] = _mm256_add_epi16(col_sums[0], _mm256_cvtepu8_epi16(_mm256_castsi256_si128(samples_0123)));
+        col_sums[1] = _mm256_add_epi16(col_sums[1], _mm256_cvtepu8_epi16(_mm256_extracti128_si256(samples_0123, 1)));
+        col_sums[2] = _mm256_add_epi16(col_sums[2], _mm256_cvtepu8_epi16(_mm256_castsi256_si128(samples_4567)));
+        col_sums[3] = _mm256_add_epi16(col_sums[3], _mm256_cvtepu8_epi16(_mm256_extracti128_si256(samples_4567, 1)));
+    }
+
+    // The horizontal adds leave the blocks interleaved across the two lanes
+    const __m256i low = _mm256_permutevar8x32_epi32(_mm256_hadd_epi32(
+            _mm256_hadd_epi32(_mm256_madd_epi16(col_sums[0], basis), _mm256_madd_epi16(col_sums[1], basis)),
+            _mm256_hadd_epi32(_mm256_madd_epi16(col_sums[2], basis), _mm256_madd_epi16(col_sums[3], basis))),
+            _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+
+    const __m256i even = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    const __m256i high = _mm256_blend_epi32(_mm256_permutevar8x32_epi32(high_0123, even),
+            _mm256_permutevar8x32_epi32(high_4567, even), 0xF0);
+
+    // Swap the coefficients so that low is low and high is high, and apply the persistence value
+    const __m256i mask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), select), select);
+    const __m256i minimum = _mm256_sub_epi32(_mm256_min_epi32(low, high), _mm256_set1_epi32(persistence));
+    const __m256i maximum = _mm256_add_epi32(_mm256_max_epi32(low, high), _mm256_set1_epi32(persistence));
+
+    int32_t low_deltas[8];
+    int32_t high_deltas[8];
+    _mm256_storeu_si256((__m256i *)low_deltas, _mm256_sub_epi32(_mm256_blendv_epi8(maximum, minimum, mask), low));
+    _mm256_storeu_si256((__m256i *)high_deltas, _mm256_sub_epi32(_mm256_blendv_epi8(minimum, maximum, mask), high));
+
+    int16_t col_terms[8][8];
+    int16_t row_terms[8][8];
+
+    for (int block = 0; block < 8; block++)
+    {
+        Terms(ReduceDelta(low_deltas[block]), col_terms[block]);
+        Terms(ReduceDelta(high_deltas[block]), row_terms[block]);
+    }
+
+    const __m256i eight = _mm256_set1_epi16(8);
+
+    for (int row = 0; row < 8; row++)
+    {
+        unsigned char *samples = tile + (row * tile_step);
+        __m256i results[4];
+
+        // Each vector holds two adjacent blocks, one per 128bit lane
+        for (int pair = 0; pair < 4; pair++)
+        {
+            const int block = pair * 2;
+            const __m256i terms = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_set1_epi16(row_terms[block][row])),
+                    _mm_set1_epi16(row_terms[block + 1][row]), 1);
+
+            __m256i value = _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(samples + (block * 8)))), 4);
+            value = _mm256_adds_epi16(value, _mm256_loadu_si256((const __m256i *)col_terms[block]));
+            value = _mm256_adds_epi16(value, terms);
+
+            results[pair] = _mm256_srai_epi16(_mm256_adds_epi16(value, eight), 4);
+        }
+
+        // Packing interleaves the pairs across the lanes, put the blocks back in order
+        _mm256_storeu_si256((__m256i *)samples, _mm256_permute4x64_epi64(_mm256_packus_epi16(results[0], results[1]), 0xD8));
+        _mm256_storeu_si256((__m256i *)(samples + 32), _mm256_permute4x64_epi64(_mm256_packus_epi16(results[2], results[3]), 0xD8));
+    }
+}
+
+#endif // DCT_KERNELS_X86
+
+static EmbedBlocksKernel SelectEmbedBlocksKernel()
+{
+#ifdef DCT_KERNELS_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return EmbedBlocksAVX2;
+    }
+
+    if (__builtin_cpu_supports("sse4.1"))
+    {
+        return EmbedBlocksSSE41;
+    }
+#endif
+
+    return EmbedBlocksScalar;
+}
+
+void EmbedBlocks(unsigned char *pixels, std::ptrdiff_t row_step, std::size_t pixel_step, unsigned char bits, int persistence)
+{
+    static const EmbedBlocksKernel kernel = SelectEmbedBlocksKernel();
+
+    if (pixel_step == 1)
+    {
+        kernel(pixels, row_step, bits, ScalePersistence(persistence));
+        return;
+    }
+
+    // Interleaved samples are gathered into a contiguous tile, and scattered back once embedded
+    unsigned char tile[8 * 64];
+
+    for (int row = 0; row < 8; row++)
+    {
+        for (int col = 0; col < 64; col++)
+        {
+            tile[(row * 64) + col] = pixels[(row * row_step) + (col * pixel_step)];
+        }
+    }
+
+    kernel(tile, 64, bits, ScalePersistence(persistence));
+
+    for (int row = 0; row < 8; row++)
+    {
+        for (int col = 0; col < 64; col++)
+        {
+            pixels[(row * row_step) + (col * pixel_step)] = tile[(row * 64) + col];
+        }
+    }
+}
+
+void EmbedBlock(unsigned char *pixels, std::ptrdiff_t row_step, std::size_t pixel_step, int bit, int persistence)
+{
+    EmbedBlockScalar(pixels, row_step, pixel_step, bit, ScalePersistence(persistence));
+}
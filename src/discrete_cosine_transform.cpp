@@ -15,298 +15,701 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
+#include <algorithm>
+#include <cmath>
+#include "dct_kernels.hpp"
 #include "discrete_cosine_transform.hpp"
-
-const int NUM_THREADS = std::thread::hardware_concurrency();
+#include "crc32c.hpp"
+#include "payload.hpp"
+#include "stats.hpp"
+#include "thread_pool.hpp"
+#include "tracer.hpp"
+
+// The number of payload bytes encoded/decoded by a single task in the thread pool
+const std::size_t GRAIN_SIZE = 64;
+
+// The (u, v) of the mid-frequency coefficients which carry a bit, each is paired with (v, u).
+// A layout with N pairs uses the first N, so a single pair is the original (0, 2)/(2, 0)
+const int COEFFICIENT_PAIRS[8][2] = {{0, 2}, {1, 2}, {0, 3}, {1, 3}, {2, 3}, {0, 4}, {1, 4}, {2, 4}};
+
+// The orthonormal 8x8 DCT-II basis, DCT_BASIS[k][n] = a(k) * cos((2n + 1)k * pi / 16)
+constexpr float DCT_BASIS[8][8] = {
+    {0.353553391f, 0.353553391f, 0.353553391f, 0.353553391f, 0.353553391f, 0.353553391f, 0.353553391f, 0.353553391f},
+    {0.490392640f, 0.415734806f, 0.277785117f, 0.097545161f, -0.097545161f, -0.277785117f, -0.415734806f, -0.490392640f},
+    {0.461939766f, 0.191341716f, -0.191341716f, -0.461939766f, -0.461939766f, -0.191341716f, 0.191341716f, 0.461939766f},
+    {0.415734806f, -0.097545161f, -0.490392640f, -0.277785117f, 0.277785117f, 0.490392640f, 0.097545161f, -0.415734806f},
+    {0.353553391f, -0.353553391f, -0.353553391f, 0.353553391f, 0.353553391f, -0.353553391f, -0.353553391f, 0.353553391f},
+    {0.277785117f, -0.490392640f, 0.097545161f, 0.415734806f, -0.415734806f, -0.097545161f, 0.490392640f, -0.277785117f},
+    {0.191341716f, -0.461939766f, 0.461939766f, -0.191341716f, -0.191341716f, 0.461939766f, -0.461939766f, 0.191341716f},
+    {0.097545161f, -0.277785117f, 0.415734806f, -0.490392640f, 0.490392640f, -0.415734806f, 0.277785117f, -0.097545161f},
+};
 
 void DiscreteCosineTransform::Encode(const boost::filesystem::path &payload_path)
 {
-    // Ensure that the carrier has enough room for the payload
-    if (boost::filesystem::file_size(payload_path) * 8 > this->image_capacity)
+    const std::string payload_filename = payload_path.filename().string();
+    const std::size_t payload_start = this->EncodeFilename(payload_filename);
+    std::size_t payload_size = 0;
+    uint32_t payload_crc = 0;
+
+    // Matrix embedding groups bits across the whole payload, so it's never streamed
+    if (this->stream_window == 0 || this->matrix_bits > 0)
     {
-        throw EncodeException("Error: Failed to encode payload, carrier too small");
-    }
+        // Map the payload into memory, it's embedded straight from the mapping
+        PayloadReader payload(payload_path);
+        payload_size = payload.Size();
+        payload_crc = Crc32c(0, payload.Data(), payload_size);
 
-    // Convert the filename to a vector<unsigned char>
-    std::string payload_filename = payload_path.filename().string();
-    std::vector<unsigned char> filename_bytes(payload_filename.begin(), payload_filename.end());
+        this->EncodePayload(payload_start, payload.Data(), payload.Data() + payload_size);
+    }
+    else
+    {
+        // Embed each window of the payload whilst the next one is being read
+        PayloadStreamReader payload(payload_path, this->stream_window);
+        const unsigned char *window;
 
-    // Encode the filename into the carrier image
-    this->EncodeChunkLength(0, filename_bytes.size());
-    this->EncodeChunk(32, filename_bytes.begin(), filename_bytes.end());
+        for (std::size_t size; (size = payload.Next(&window)) > 0; payload_size += size)
+        {
+            payload_crc = Crc32c(payload_crc, window, size);
+            this->EncodePayload(payload_start + (payload_size * 8), window, window + size);
+        }
+    }
 
-    // Read the payload into a vector<unsigned char>
-    std::vector<unsigned char> payload_bytes = this->ReadPayload(payload_path);
+    // Encode the header last, the payload length and checksum aren't known up front when streaming
+    this->EncodeHeader(payload_filename.size(), payload_size, payload_crc);
 
-    this->EncodeChunkLength(32 + filename_bytes.size() * 8, payload_bytes.size());
+    // Write the steganographic image
+    Stats::Stage stage("write", this->image.total() * this->image.elemSize());
+    cv::imwrite("steg-" + this->image_path.filename().replace_extension(".jpg").string(), this->image,
+            std::vector<int>{CV_IMWRITE_JPEG_QUALITY, 100});
+}
 
-    // Determine how many threads to use so that each thread encodes more than 12B
-    int encode_threads = NUM_THREADS;
+void DiscreteCosineTransform::Decode()
+{
+    std::string payload_filename;
+    const ContainerHeader header = this->DecodeHeader();
+    const std::size_t payload_start = this->DecodeFilename(header, &payload_filename);
+    const std::size_t payload_length = header.payload_length;
 
-    while ((encode_threads > 1) && ((payload_bytes.size() / encode_threads)) < 12)
+    if (this->stream_window == 0 || this->matrix_bits > 0)
     {
-        encode_threads--;
-    }
+        // The payload is decoded straight into the output file
+        PayloadWriter payload("steg-" + payload_filename, payload_length);
 
-    // Encode the payload into the carrier image
-    if (encode_threads == 1)
-    {
-        this->EncodeChunk(64 + (filename_bytes.size() * 8), payload_bytes.begin(), payload_bytes.end());
+        this->DecodePayload(payload_start, payload.Data(), payload.Data() + payload.Size());
+        VerifyPayload(header, Crc32c(0, payload.Data(), payload.Size()));
+        payload.Commit();
     }
     else
     {
-        std::vector<std::thread> threads;
-        threads.reserve(encode_threads);
+        // Write each window of the payload whilst the next one is being decoded
+        PayloadStreamWriter payload("steg-" + payload_filename, this->stream_window);
+        uint32_t payload_crc = 0;
 
-        for (int i = 0; i < encode_threads; i++)
+        for (std::size_t offset = 0; offset < payload_length; offset += this->stream_window)
         {
-            threads.push_back(
-                    std::thread(&DiscreteCosineTransform::EncodeChunk,
-                        this,
-                        64 + (filename_bytes.size() * 8) + (((payload_bytes.size() / encode_threads) * 8) * i),
-                        payload_bytes.begin() + ((payload_bytes.size() / encode_threads) * i),
-                        payload_bytes.end() - ((payload_bytes.size() / encode_threads) * ((encode_threads - 1) - i))));
-        }
+            std::size_t size = std::min(this->stream_window, payload_length - offset);
 
-        // Wait for all the threads to finish encoding
-        for (std::thread &thr : threads)
-        {
-            thr.join();
+            this->DecodePayload(payload_start + (offset * 8), payload.Buffer(), payload.Buffer() + size);
+            payload_crc = Crc32c(payload_crc, payload.Buffer(), size);
+            payload.Write(size);
         }
+
+        // The windows have been written, but the file is removed unless it's committed
+        VerifyPayload(header, payload_crc);
+        payload.Commit();
     }
+}
 
-    // Merge the image channels and convert back to unsigned char
-    cv::merge(this->channels, this->image);
-    this->image.convertTo(this->image, CV_8U);
+void DiscreteCosineTransform::Embed(const std::string &payload_filename, const unsigned char *payload, const std::size_t &payload_size)
+{
+    const std::size_t payload_start = this->EncodeFilename(payload_filename);
 
-    // Write the steganographic image
-    cv::imwrite("steg-" + this->image_path.filename().replace_extension(".jpg").string(), this->image,
-            std::vector<int>{CV_IMWRITE_JPEG_QUALITY, 100});
+    // Encode the payload, and then the header which describes it, into the carrier image
+    this->EncodePayload(payload_start, payload, payload + payload_size);
+    this->EncodeHeader(payload_filename.size(), payload_size, Crc32c(0, payload, payload_size));
 }
 
-void DiscreteCosineTransform::Decode()
+std::vector<unsigned char> DiscreteCosineTransform::EncodeImage()
 {
-    // Decode the filename from the steganographic image
-    unsigned int filename_length = this->DecodeChunkLength(0);
-    std::vector<unsigned char> filename_bytes(filename_length);
-    this->DecodeChunk(32, filename_bytes.begin(), filename_bytes.end());
+    Stats::Stage stage("write", this->image.total() * this->image.elemSize());
 
-    // Convert the filename vector<unsigned char> to a string
-    std::string payload_filename(filename_bytes.begin(), filename_bytes.end());
+    std::vector<unsigned char> image_bytes;
+    cv::imencode(".jpg", this->image, image_bytes, std::vector<int>{CV_IMWRITE_JPEG_QUALITY, 100});
+
+    return image_bytes;
+}
+
+DecodedPayload DiscreteCosineTransform::DecodeBuffer()
+{
+    DecodedPayload payload;
+    const ContainerHeader header = this->DecodeHeader();
+    const std::size_t payload_start = this->DecodeFilename(header, &payload.filename);
+
+    // Decode the payload from the steganographic image, and check it against the header
+    payload.bytes.resize(header.payload_length);
+    this->DecodePayload(payload_start, payload.bytes.data(), payload.bytes.data() + payload.bytes.size());
+    VerifyPayload(header, Crc32c(0, payload.bytes.data(), payload.bytes.size()));
 
-    // Decode the payload length from the steganographic image
-    unsigned int payload_length = this->DecodeChunkLength(32 + (filename_length * 8));
+    return payload;
+}
 
-    // Determine how many threads to use so that each thread decodes more than 12B
-    int decode_threads = NUM_THREADS;
+ContainerHeader DiscreteCosineTransform::Probe(std::string *payload_filename)
+{
+    const ContainerHeader header = this->DecodeHeader();
+    this->DecodeFilename(header, payload_filename);
 
-    while ((decode_threads > 1) && (payload_length / decode_threads) < 12)
+    return header;
+}
+
+void DiscreteCosineTransform::SetFixedPoint(const bool &fixed_point)
+{
+    this->fixed_point = fixed_point;
+}
+
+void DiscreteCosineTransform::SetLayout(const int &channels, const int &pairs)
+{
+    if (pairs != 1 && pairs != 2 && pairs != 4 && pairs != 8)
     {
-        decode_threads--;
+        throw ImageException("Error: The number of coefficient pairs must be 1, 2, 4 or 8");
     }
 
-    // Decode the payload from the steganographic image
-    std::vector<unsigned char> payload_bytes(payload_length);
+    this->channels = DiscreteCosineTransform::LayoutChannels(this->image.channels(), channels);
+    this->pairs = pairs;
+    this->image_capacity = DiscreteCosineTransform::LayoutCapacity(this->image.rows, this->image.cols, this->channels, pairs);
+}
 
-    if (decode_threads == 1)
+void DiscreteCosineTransform::SetMatrixEmbedding(const int &bits)
+{
+    if (bits < 0 || bits > 8)
     {
-        this->DecodeChunk(64 + (filename_length * 8), payload_bytes.begin(), payload_bytes.end());
+        throw ImageException("Error: The number of matrix embedding bits must be between 0 and 8");
     }
-    else
+
+    this->matrix_bits = bits;
+}
+
+void DiscreteCosineTransform::Initialise(const int &persistence)
+{
+    this->persistence = persistence;
+    this->fixed_point = false;
+    this->matrix_bits = 0;
+    this->SetLayout(1, 1);
+
+    // The blocks are embedded into the 8-bit image in place, other depths are
+    // converted up front as the JPEG output is 8-bit regardless
+    if (this->image.depth() != CV_8U)
     {
-        std::vector<std::thread> threads;
-        threads.reserve(decode_threads);
+        Stats::Stage stage("convert", this->image.total() * this->image.elemSize());
+        this->image.convertTo(this->image, CV_8U);
+    }
+}
 
-        for (int i = 0; i < decode_threads; i++)
+void DiscreteCosineTransform::ReadBlock(const unsigned char *pixels, float *block)
+{
+    const std::size_t pixel_size = this->image.elemSize();
+
+    for (int row = 0; row < 8; row++, pixels += this->image.step[0])
+    {
+        for (int col = 0; col < 8; col++)
         {
-            threads.push_back(
-                std::thread(&DiscreteCosineTransform::DecodeChunk,
-                    this,
-                    64 + (filename_length * 8) + (((payload_length / decode_threads) * 8) * i),
-                    payload_bytes.begin() + ((payload_length / decode_threads) * i),
-                    payload_bytes.end() - ((payload_length / decode_threads) * ((decode_threads - 1) - i))));
+            block[(row * 8) + col] = pixels[col * pixel_size];
         }
+    }
+}
+
+void DiscreteCosineTransform::WriteBlock(const float *block, unsigned char *pixels)
+{
+    const std::size_t pixel_size = this->image.elemSize();
 
-        // Wait for all the threads to finish encoding
-        for (std::thread &thr : threads)
+    for (int row = 0; row < 8; row++, pixels += this->image.step[0])
+    {
+        for (int col = 0; col < 8; col++)
         {
-            thr.join();
+            pixels[col * pixel_size] = cv::saturate_cast<unsigned char>(block[(row * 8) + col]);
         }
     }
+}
+
+std::size_t DiscreteCosineTransform::PayloadStart(const std::size_t &filename_length) const
+{
+    return DiscreteCosineTransform::LayoutPayloadStart(this->channels, this->pairs, filename_length);
+}
+
+int DiscreteCosineTransform::LayoutChannels(const int &image_channels, const int &channels)
+{
+    // The JPEG output only keeps the colour channels
+    const int colour_channels = std::min(image_channels, 3);
+
+    return (channels <= 0) ? colour_channels : std::min(channels, colour_channels);
+}
+
+std::size_t DiscreteCosineTransform::LayoutCapacity(const int &rows, const int &cols, const int &channels, const int &pairs)
+{
+    // The final row/column of blocks is never used
+    return (std::size_t)std::max(0, (rows - 8) / 8) * std::max(0, (cols - 8) / 8) * channels * pairs;
+}
 
-    // Write the decoded payload
-    this->WritePayload("steg-" + payload_filename, payload_bytes);
+std::size_t DiscreteCosineTransform::LayoutPayloadStart(const int &channels, const int &pairs, const std::size_t &filename_length)
+{
+    return (HEADER_BITS * channels * pairs) + (filename_length * 8);
+}
+
+std::size_t DiscreteCosineTransform::Capacity() const
+{
+    return this->image_capacity;
 }
 
-void DiscreteCosineTransform::EncodeChunk(const int &start, std::vector<unsigned char>::iterator it, std::vector<unsigned char>::iterator en)
+std::size_t DiscreteCosineTransform::EncodeFilename(const std::string &payload_filename)
 {
-    int bit = 0;
-    bool loops_initialised = false;
+    // Convert the filename to a vector<unsigned char>
+    std::vector<unsigned char> filename_bytes(payload_filename.begin(), payload_filename.end());
+
+    // Encode the filename into the carrier image, straight after the header
+    this->EncodeChunk(this->PayloadStart(0), filename_bytes.data(), filename_bytes.data() + filename_bytes.size());
+
+    return this->PayloadStart(filename_bytes.size());
+}
+
+std::size_t DiscreteCosineTransform::DecodeFilename(const ContainerHeader &header, std::string *payload_filename)
+{
+    // Decode the filename from the steganographic image
+    std::vector<unsigned char> filename_bytes(header.filename_length);
+    this->DecodeChunk(this->PayloadStart(0), filename_bytes.data(), filename_bytes.data() + filename_bytes.size());
+
+    // Convert the filename vector<unsigned char> to a string
+    payload_filename->assign(filename_bytes.begin(), filename_bytes.end());
+
+    return this->PayloadStart(header.filename_length);
+}
+
+void DiscreteCosineTransform::EncodeHeader(const std::size_t &filename_length, const std::size_t &payload_length,
+        const uint32_t &payload_crc)
+{
+    const ContainerHeader header = {TECHNIQUE_DCT, this->persistence, 0, this->channels, this->pairs, this->matrix_bits,
+        filename_length, payload_length, payload_crc};
+    unsigned char header_bytes[HEADER_SIZE];
+    StoreHeader(header, header_bytes);
+
+    // The header is embedded one bit per block in the first channel, in the blocks which are skipped by the
+    // rest of the bitstream
+    const int channels = this->channels;
+    const int pairs = this->pairs;
+    this->SetLayout(1, 1);
+    this->EncodeChunk(0, header_bytes, header_bytes + HEADER_SIZE);
+    this->SetLayout(channels, pairs);
+}
 
-    for (int row = 0; row < this->image.rows - 8; row += 8)
+ContainerHeader DiscreteCosineTransform::DecodeHeader()
+{
+    unsigned char header_bytes[HEADER_SIZE] = {0};
+
+    const int channels = this->channels;
+    const int pairs = this->pairs;
+    this->SetLayout(1, 1);
+
+    // The rest of the header is only decoded when it starts with the magic, so other images are rejected early
+    if (this->image_capacity >= HEADER_BITS)
     {
-        for (int col = 0; col < this->image.cols - 8; col += 8)
+        this->DecodeChunk(0, header_bytes, header_bytes + MAGIC_SIZE);
+
+        if (HasMagic(header_bytes))
         {
-            if (!loops_initialised)
-            {
-                row = start / ((this->image.cols - 8) / 8) * 8;
-                col = start % ((this->image.cols - 8) / 8) * 8;
-                loops_initialised = true;
-            }
+            this->DecodeChunk(MAGIC_SIZE * 8, header_bytes + MAGIC_SIZE, header_bytes + HEADER_SIZE);
+        }
+    }
 
-            // The current 8x8 block we are working on
-            cv::Mat block(channels[0], cv::Rect(col, row, 8, 8));
+    this->SetLayout(channels, pairs);
+
+    const ContainerHeader header = LoadHeader(header_bytes, TECHNIQUE_DCT);
+
+    if (header.channels < 1 || header.channels > 3 || header.matrix_bits < 0 || header.matrix_bits > 8)
+    {
+        throw DecodeException("Error: Payload header is corrupt");
+    }
+
+    // The rest of the bitstream is decoded with the layout it was encoded with
+    try {
+        this->SetLayout(header.channels, header.pairs);
+        this->SetMatrixEmbedding(header.matrix_bits);
+    }
+    catch (ImageException &e)
+    {
+        throw DecodeException("Error: Payload header is corrupt");
+    }
 
-            // A "working" copy of the block
-            cv::Mat trans(cv::Size(8, 8), block.type());
+    if (this->channels != header.channels)
+    {
+        throw DecodeException("Error: Payload was encoded into more colour channels than the image has");
+    }
 
-            // Perform the forward dct
-            cv::dct(block, trans);
+    CheckCapacity(header, this->PayloadStart(header.filename_length), this->image_capacity);
 
-            // Embed the current chunk bit in the carrier
-            this->SwapCoefficients(&trans, this->GetBit(*it, bit % 8));
+    return header;
+}
 
-            // Perform the inverse dct
-            cv::idct(trans, block);
+void DiscreteCosineTransform::EncodePayload(const std::size_t &start, const unsigned char *it, const unsigned char *en)
+{
+    if (this->matrix_bits > 0)
+    {
+        this->EncodeMatrix(start, it, en);
+        return;
+    }
 
-            // We have finished embedding, clean up
-            if (++bit % 8 == 0 && ++it == en)
-            {
-                return;
-            }
-        }
+    Stats::Stage stage("embed", en - it, (en - it) * 8);
+
+    // Ensure that the carrier has enough room for the payload
+    if (start + ((en - it) * 8) > this->image_capacity)
+    {
+        throw EncodeException("Error: Failed to encode payload, carrier too small");
     }
+
+    // The work is split into small ranges of bytes so that it's evenly balanced across the thread pool
+    ThreadPool::Instance().ParallelFor(0, en - it, GRAIN_SIZE, [&](std::size_t begin, std::size_t end)
+    {
+        Tracer::Span span("embed", start + (begin * 8), end - begin, (end - begin) * 8);
+        this->EncodeChunk(start + (begin * 8), it + begin, it + end);
+    });
+}
+
+void DiscreteCosineTransform::DecodePayload(const std::size_t &start, unsigned char *it, unsigned char *en)
+{
+    if (this->matrix_bits > 0)
+    {
+        this->DecodeMatrix(start, it, en);
+        return;
+    }
+
+    Stats::Stage stage("extract", en - it, (en - it) * 8);
+
+    // The work is split into small ranges of bytes so that it's evenly balanced across the thread pool
+    ThreadPool::Instance().ParallelFor(0, en - it, GRAIN_SIZE, [&](std::size_t begin, std::size_t end)
+    {
+        Tracer::Span span("extract", start + (begin * 8), end - begin, (end - begin) * 8);
+        this->DecodeChunk(start + (begin * 8), it + begin, it + end);
+    });
 }
 
-void DiscreteCosineTransform::EncodeChunkLength(const int &start, const unsigned int &chunk_length)
+void DiscreteCosineTransform::EncodeMatrix(const std::size_t &start, const unsigned char *it, const unsigned char *en)
 {
-    int bit = 0;
-    bool loops_initialised = false;
+    Stats::Stage stage("embed", en - it, (en - it) * 8);
+
+    // Each group of 2^k - 1 slots carries k bits of the payload
+    const int slots = (1 << this->matrix_bits) - 1;
+    const std::size_t payload_bits = (en - it) * 8;
+    const std::size_t groups = (payload_bits + this->matrix_bits - 1) / this->matrix_bits;
+
+    // Ensure that the carrier has enough room for the payload
+    if (start + (groups * slots) > this->image_capacity)
+    {
+        throw EncodeException("Error: Failed to encode payload, carrier too small");
+    }
 
-    for (int row = 0; row < this->image.rows - 8; row += 8)
+    // Tasks cover a multiple of eight groups, so they never share a payload byte or a block
+    ThreadPool::Instance().ParallelFor(0, groups, GRAIN_SIZE * 8, [&](std::size_t begin, std::size_t end)
     {
-        for (int col = 0; col < this->image.cols - 8; col += 8)
+        Tracer::Span span("embed", start + (begin * slots), ((end - begin) * this->matrix_bits) / 8, (end - begin) * slots);
+
+        for (std::size_t group = begin; group < end; group++)
         {
-            if (!loops_initialised)
-            {
-                row = start / ((this->image.cols - 8) / 8) * 8;
-                col = start % ((this->image.cols - 8) / 8) * 8;
-                loops_initialised = true;
-            }
+            const std::size_t first = start + (group * slots);
 
-            // The current 8x8 block we are working on
-            cv::Mat block(channels[0], cv::Rect(col, row, 8, 8));
+            // The payload bits carried by this group, the final group is padded with zeros
+            int message = 0;
 
-            // A "working" copy of the block
-            cv::Mat trans(cv::Size(8, 8), block.type());
+            for (int bit = 0; bit < this->matrix_bits; bit++)
+            {
+                const std::size_t index = (group * this->matrix_bits) + bit;
 
-            // Perform the forward dct
-            cv::dct(block, trans);
+                if (index < payload_bits)
+                {
+                    message |= this->GetBit(it[index / 8], index % 8) << bit;
+                }
+            }
 
-            // Swap N DCT coefficients
-            this->SwapCoefficients(&trans, this->GetBit(chunk_length, bit));
+            // The syndrome is the xor of the (one based) positions of the set slots
+            int values[255];
+            float margins[255];
+            int syndrome = 0;
 
-            // Perform the inverse dct
-            cv::idct(trans, block);
+            for (int slot = 0; slot < slots; slot++)
+            {
+                values[slot] = this->ReadSlot(first + slot, &margins[slot]);
+                syndrome ^= values[slot] ? slot + 1 : 0;
+            }
 
-            // We have finished embedding, clean up
-            if (++bit == 32)
+            // At most one slot is flipped to make the syndrome equal the message
+            const int flip = (syndrome ^ message) - 1;
+
+            for (int slot = 0; slot < slots; slot++)
             {
-                return;
+                // Slots which already hold their value with a comfortable margin are left untouched
+                if (slot == flip || margins[slot] < 2 * this->persistence)
+                {
+                    this->WriteSlot(first + slot, values[slot] ^ (slot == flip));
+                }
             }
         }
-    }
+    });
 }
 
-void DiscreteCosineTransform::DecodeChunk(const int start, std::vector<unsigned char>::iterator it, std::vector<unsigned char>::iterator en)
+void DiscreteCosineTransform::DecodeMatrix(const std::size_t &start, unsigned char *it, unsigned char *en)
 {
-    int bit = 0;
-    bool loops_initialised = false;
+    Stats::Stage stage("extract", en - it, (en - it) * 8);
+
+    const int slots = (1 << this->matrix_bits) - 1;
+    const std::size_t payload_bits = (en - it) * 8;
+    const std::size_t groups = (payload_bits + this->matrix_bits - 1) / this->matrix_bits;
 
-    for (int row = 0; row < this->image.rows - 8; row += 8)
+    if (start + (groups * slots) > this->image_capacity)
     {
-        for (int col = 0; col < this->image.cols - 8; col += 8)
+        throw DecodeException("Error: Failed to decode payload");
+    }
+
+    // Tasks cover a multiple of eight groups, so they never share a payload byte
+    ThreadPool::Instance().ParallelFor(0, groups, GRAIN_SIZE * 8, [&](std::size_t begin, std::size_t end)
+    {
+        Tracer::Span span("extract", start + (begin * slots), ((end - begin) * this->matrix_bits) / 8, (end - begin) * slots);
+
+        for (std::size_t group = begin; group < end; group++)
         {
-            if (!loops_initialised)
+            const std::size_t first = start + (group * slots);
+            int syndrome = 0;
+
+            for (int slot = 0; slot < slots; slot++)
             {
-                row = start / ((this->image.cols - 8) / 8) * 8;
-                col = start % ((this->image.cols - 8) / 8) * 8;
-                loops_initialised = true;
+                float margin;
+                syndrome ^= this->ReadSlot(first + slot, &margin) ? slot + 1 : 0;
             }
 
-            // The current 8x8 block we are working on
-            cv::Mat block(channels[0], cv::Rect(col, row, 8, 8));
+            for (int bit = 0; bit < this->matrix_bits; bit++)
+            {
+                const std::size_t index = (group * this->matrix_bits) + bit;
+
+                if (index < payload_bits)
+                {
+                    this->SetBit(&it[index / 8], index % 8, this->GetBit(syndrome, bit));
+                }
+            }
+        }
+    });
+}
+
+int DiscreteCosineTransform::ReadSlot(const std::size_t &slot, float *margin)
+{
+    const int block_bits = this->channels * this->pairs;
+    const int channel = (slot % block_bits) / this->pairs;
+    const int pair = slot % this->pairs;
+
+    SlotCursor cursor = this->Seek(slot / block_bits);
+
+    if (cursor.End())
+    {
+        throw DecodeException("Error: Failed to decode payload");
+    }
+
+    float pixels[64];
+    this->ReadBlock(cursor.Pointer() + channel, pixels);
+    cv::Mat block(8, 8, CV_32F, pixels);
+
+    const float low = this->Coefficient(block, COEFFICIENT_PAIRS[pair][0], COEFFICIENT_PAIRS[pair][1]);
+    const float high = this->Coefficient(block, COEFFICIENT_PAIRS[pair][1], COEFFICIENT_PAIRS[pair][0]);
+
+    *margin = std::abs(high - low);
+
+    return low < high;
+}
+
+void DiscreteCosineTransform::WriteSlot(const std::size_t &slot, const int &value)
+{
+    const int block_bits = this->channels * this->pairs;
+    const int channel = (slot % block_bits) / this->pairs;
+
+    SlotCursor cursor = this->Seek(slot / block_bits);
+
+    if (cursor.End())
+    {
+        throw EncodeException("Error: Failed to encode payload, carrier too small");
+    }
+
+    float pixels[64];
+    this->ReadBlock(cursor.Pointer() + channel, pixels);
+    cv::Mat block(8, 8, CV_32F, pixels);
+
+    this->SwapCoefficients(&block, slot % this->pairs, value);
+    this->WriteBlock(pixels, cursor.Pointer() + channel);
+}
+
+void DiscreteCosineTransform::EncodeChunk(const std::size_t &start, const unsigned char *it, const unsigned char *en)
+{
+    if (this->fixed_point && this->pairs == 1)
+    {
+        this->EncodeChunkFixed(start, it, en);
+        return;
+    }
 
-            // A "working" copy of the block
-            cv::Mat trans(cv::Size(8, 8), block.type());
+    const int block_bits = this->channels * this->pairs;
+    SlotCursor cursor = this->Seek(start / block_bits);
 
-            // Perform the forward dct
-            cv::dct(block, trans);
+    for (int bit = 0, index = start % block_bits; it != en; ++cursor, index = 0)
+    {
+        if (cursor.End())
+        {
+            throw EncodeException("Error: Failed to encode payload, carrier too small");
+        }
+
+        // Each channel of the block is converted once, and carries a bit in each coefficient pair
+        while (index < block_bits && it != en)
+        {
+            const int channel = index / this->pairs;
 
-            // Read from N swapped DCT coefficients
-            this->SetBit(&(*it), bit % 8, (trans.at<float>(0, 2) < trans.at<float>(2, 0)));
+            // The current 8x8 block we are working on, converted only whilst it's being modified
+            float pixels[64];
+            this->ReadBlock(cursor.Pointer() + channel, pixels);
+            cv::Mat block(8, 8, CV_32F, pixels);
 
-            if (++bit % 8 == 0 && ++it == en)
+            for (; index < (channel + 1) * this->pairs && it != en; index++)
             {
-                return;
+                // Embed the current chunk bit in the carrier
+                this->SwapCoefficients(&block, index % this->pairs, this->GetBit(*it, bit % 8));
+
+                if (++bit % 8 == 0)
+                {
+                    ++it;
+                }
             }
+
+            this->WriteBlock(pixels, cursor.Pointer() + channel);
         }
     }
-
-    throw DecodeException("Error: Failed to decode payload");
 }
 
-unsigned int DiscreteCosineTransform::DecodeChunkLength(const int &start)
+void DiscreteCosineTransform::EncodeChunkFixed(const std::size_t &start, const unsigned char *it, const unsigned char *en)
 {
-    unsigned int chunk_length = 0;
+    const std::size_t row_step = this->image.step[0];
+    const std::size_t pixel_size = this->image.elemSize();
 
-    int bit = 0;
-    bool loops_initialised = false;
+    SlotCursor cursor = this->Seek(start / this->channels);
+    int channel = start % this->channels;
 
-    for (int row = 0; row < this->image.rows - 8; row += 8)
+    for (; it != en; ++it)
     {
-        for (int col = 0; col < this->image.cols - 8; col += 8)
+        // Embed the whole byte at once when its eight blocks are on the same row
+        if (this->channels == 1 && cursor.Contiguous() >= 8)
+        {
+            EmbedBlocks(cursor.Pointer(), row_step, pixel_size, *it, this->persistence);
+            cursor += 8;
+            continue;
+        }
+
+        for (int bit = 0; bit < 8; bit++)
         {
-            if (!loops_initialised)
+            if (cursor.End())
             {
-                row = start / ((this->image.cols - 8) / 8) * 8;
-                col = start % ((this->image.cols - 8) / 8) * 8;
-                loops_initialised = true;
+                throw EncodeException("Error: Failed to encode payload, carrier too small");
             }
 
-            // The current 8x8 block we are working on
-            cv::Mat block(channels[0], cv::Rect(col, row, 8, 8));
+            EmbedBlock(cursor.Pointer() + channel, row_step, pixel_size, this->GetBit(*it, bit), this->persistence);
 
-            // A "working" copy of the block
-            cv::Mat trans(cv::Size(8, 8), block.type());
+            if (++channel == this->channels)
+            {
+                channel = 0;
+                ++cursor;
+            }
+        }
+    }
+}
 
-            // Perform the forward dct
-            cv::dct(block, trans);
+void DiscreteCosineTransform::DecodeChunk(const std::size_t &start, unsigned char *it, unsigned char *en)
+{
+    const int block_bits = this->channels * this->pairs;
+    SlotCursor cursor = this->Seek(start / block_bits);
 
-            // Read from N swapped DCT coefficients
-            this->SetBit(&chunk_length, bit, (trans.at<float>(0, 2) < trans.at<float>(2, 0)));
+    for (int bit = 0, index = start % block_bits; it != en; ++cursor, index = 0)
+    {
+        if (cursor.End())
+        {
+            throw DecodeException("Error: Failed to decode payload");
+        }
 
-            if (++bit == 32)
+        while (index < block_bits && it != en)
+        {
+            const int channel = index / this->pairs;
+
+            // The current 8x8 block we are working on
+            float pixels[64];
+            this->ReadBlock(cursor.Pointer() + channel, pixels);
+            cv::Mat block(8, 8, CV_32F, pixels);
+
+            for (; index < (channel + 1) * this->pairs && it != en; index++)
             {
-                // We have decoded the integer, check if it's valid
-                if (chunk_length >= this->image_capacity || chunk_length == 0)
+                // Read from N swapped DCT coefficients
+                const int pair = index % this->pairs;
+                this->SetBit(it, bit % 8, (this->Coefficient(block, COEFFICIENT_PAIRS[pair][0], COEFFICIENT_PAIRS[pair][1]) <
+                        this->Coefficient(block, COEFFICIENT_PAIRS[pair][1], COEFFICIENT_PAIRS[pair][0])));
+
+                if (++bit % 8 == 0)
                 {
-                    throw DecodeException("Error: Failed to decode payload length");
+                    ++it;
                 }
-
-                return chunk_length;
             }
         }
     }
+}
+
+Steganography::SlotCursor DiscreteCosineTransform::Seek(const std::size_t &slot)
+{
+    // Each 8x8 block of pixels is a slot, the final row/column of blocks is never used
+    return SlotCursor(this->image.data, this->image.step[0], this->image.elemSize(), 8,
+            std::max(0, (this->image.rows - 8) / 8), std::max(0, (this->image.cols - 8) / 8), slot);
+}
+
+float DiscreteCosineTransform::Coefficient(const cv::Mat &block, const int &u, const int &v)
+{
+    float coefficient = 0;
+
+    for (int row = 0; row < 8; row++)
+    {
+        const float *pixels = block.ptr<float>(row);
+
+        // Project the row onto the horizontal basis, then onto the vertical basis
+        float projection = 0;
+
+        for (int col = 0; col < 8; col++)
+        {
+            projection += pixels[col] * DCT_BASIS[v][col];
+        }
+
+        coefficient += projection * DCT_BASIS[u][row];
+    }
 
-    throw DecodeException("Error: Failed to decode payload length");
+    return coefficient;
 }
 
-void DiscreteCosineTransform::SwapCoefficients(cv::Mat *block, const int &value)
+void DiscreteCosineTransform::AdjustCoefficient(cv::Mat *block, const int &u, const int &v, const float &delta)
 {
+    for (int row = 0; row < 8; row++)
+    {
+        float *pixels = block->ptr<float>(row);
+        const float scale = delta * DCT_BASIS[u][row];
+
+        for (int col = 0; col < 8; col++)
+        {
+            pixels[col] += scale * DCT_BASIS[v][col];
+        }
+    }
+}
+
+void DiscreteCosineTransform::SwapCoefficients(cv::Mat *block, const int &pair, const int &value)
+{
+    const int u = COEFFICIENT_PAIRS[pair][0];
+    const int v = COEFFICIENT_PAIRS[pair][1];
+
     // Read two coefficients from the image block
-    float low = block->at<float>(0, 2);
-    float high = block->at<float>(2, 0);
+    const float original_low = this->Coefficient(*block, u, v);
+    const float original_high = this->Coefficient(*block, v, u);
+
+    float low = original_low;
+    float high = original_high;
 
     // Swap the coefficients so that low is low and high is high
     if (value && (low > high))
@@ -330,7 +733,8 @@ void DiscreteCosineTransform::SwapCoefficients(cv::Mat *block, const int &value)
         high -= this->persistence;
     }
 
-    // Write the coefficients back to the block
-    block->at<float>(0, 2) = low;
-    block->at<float>(2, 0) = high;
+    // Write the coefficients back to the block, the basis functions are
+    // orthonormal so this is equivalent to a forward and inverse dct
+    this->AdjustCoefficient(block, u, v, low - original_low);
+    this->AdjustCoefficient(block, v, u, high - original_high);
 }
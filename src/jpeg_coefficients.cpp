@@ -0,0 +1,506 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <jpeglib.h>
+#include "jpeg_coefficients.hpp"
+#include "crc32c.hpp"
+#include "payload.hpp"
+#include "stats.hpp"
+#include "thread_pool.hpp"
+#include "tracer.hpp"
+
+// The number of payload bytes encoded/decoded by a single task in the thread pool
+const std::size_t GRAIN_SIZE = 64;
+
+// The (0, 2) and (2, 0) coefficients in libjpeg's natural (row major) order
+const int LOW_COEFFICIENT = 2;
+const int HIGH_COEFFICIENT = 16;
+
+// The largest magnitude of an AC coefficient in an 8-bit baseline JPEG
+const int COEFFICIENT_LIMIT = 1023;
+
+/**
+ * A libjpeg error manager which jumps back to the caller rather than exiting.
+ */
+struct JpegError
+{
+    jpeg_error_mgr manager;
+    jmp_buf jump;
+};
+
+static void JpegErrorExit(j_common_ptr info)
+{
+    longjmp(reinterpret_cast<JpegError *>(info->err)->jump, 1);
+}
+
+struct JpegCoefficients::Coefficients
+{
+    std::vector<unsigned char> image_bytes;
+    jpeg_decompress_struct decompress;
+    JpegError error;
+    jvirt_barray_ptr *arrays;
+    std::vector<JBLOCKROW> rows;
+    std::size_t width;
+
+    Coefficients() : arrays(nullptr), width(0)
+    {
+        this->decompress.err = jpeg_std_error(&this->error.manager);
+        this->error.manager.error_exit = JpegErrorExit;
+        jpeg_create_decompress(&this->decompress);
+    }
+
+    ~Coefficients()
+    {
+        jpeg_destroy_decompress(&this->decompress);
+    }
+};
+
+/**
+ * Read the coefficients of a JPEG, and the block rows of its first component.
+ * This holds no C++ objects on its stack, so libjpeg may jump out of it.
+ *
+ * @return Whether the coefficients were read.
+ */
+static bool ReadCoefficients(jpeg_decompress_struct *decompress, JpegError *error, unsigned char *bytes, std::size_t size,
+        jvirt_barray_ptr **arrays, std::vector<JBLOCKROW> *rows)
+{
+    if (setjmp(error->jump))
+    {
+        return false;
+    }
+
+    jpeg_mem_src(decompress, bytes, size);
+
+    // Keep every marker so that they can be written back out unchanged
+    jpeg_save_markers(decompress, JPEG_COM, 0xFFFF);
+
+    for (int marker = 0; marker < 16; marker++)
+    {
+        jpeg_save_markers(decompress, JPEG_APP0 + marker, 0xFFFF);
+    }
+
+    jpeg_read_header(decompress, TRUE);
+    *arrays = jpeg_read_coefficients(decompress);
+
+    // The arrays are realised in memory once read, so each row stays where it's first accessed
+    const jpeg_component_info *component = &decompress->comp_info[0];
+
+    for (JDIMENSION row = 0; row < component->height_in_blocks; row++)
+    {
+        rows->push_back(decompress->mem->access_virt_barray((j_common_ptr)decompress, (*arrays)[0], row, 1, TRUE)[0]);
+    }
+
+    return true;
+}
+
+/**
+ * Write the coefficients of a JPEG to a buffer allocated by libjpeg, which the
+ * caller must free. This holds no C++ objects on its stack, so libjpeg may jump
+ * out of it.
+ *
+ * @return Whether the coefficients were written.
+ */
+static bool WriteCoefficients(jpeg_decompress_struct *decompress, jvirt_barray_ptr *arrays, unsigned char **buffer,
+        unsigned long *size)
+{
+    jpeg_compress_struct compress;
+    JpegError error;
+
+    compress.err = jpeg_std_error(&error.manager);
+    error.manager.error_exit = JpegErrorExit;
+
+    if (setjmp(error.jump))
+    {
+        jpeg_destroy_compress(&compress);
+        return false;
+    }
+
+    jpeg_create_compress(&compress);
+    jpeg_mem_dest(&compress, buffer, size);
+    jpeg_copy_critical_parameters(decompress, &compress);
+
+    // Fit the Huffman tables to the changed coefficients, which keeps the size close to the input
+    compress.optimize_coding = TRUE;
+    jpeg_write_coefficients(&compress, arrays);
+
+    for (jpeg_saved_marker_ptr marker = decompress->marker_list; marker; marker = marker->next)
+    {
+        // libjpeg writes its own JFIF and Adobe markers
+        if (compress.write_JFIF_header && marker->marker == JPEG_APP0 && marker->data_length >= 5 &&
+                std::memcmp(marker->data, "JFIF", 5) == 0)
+        {
+            continue;
+        }
+
+        if (compress.write_Adobe_marker && marker->marker == JPEG_APP0 + 14 && marker->data_length >= 5 &&
+                std::memcmp(marker->data, "Adobe", 5) == 0)
+        {
+            continue;
+        }
+
+        jpeg_write_marker(&compress, marker->marker, marker->data, marker->data_length);
+    }
+
+    jpeg_finish_compress(&compress);
+    jpeg_destroy_compress(&compress);
+
+    return true;
+}
+
+JpegCoefficients::JpegCoefficients(const boost::filesystem::path &image_path, int persistence)
+{
+    this->image_path = image_path;
+
+    boost::filesystem::ifstream file(image_path, std::ios::binary);
+    std::vector<unsigned char> image_bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (!file.good() && !file.eof())
+    {
+        throw ImageException("Error: Failed to open input image");
+    }
+
+    this->Initialise(image_bytes, persistence);
+}
+
+JpegCoefficients::JpegCoefficients(const std::vector<unsigned char> &image_bytes, int persistence)
+{
+    this->Initialise(image_bytes, persistence);
+}
+
+JpegCoefficients::JpegCoefficients(JpegCoefficients &&other) = default;
+
+JpegCoefficients::~JpegCoefficients() = default;
+
+void JpegCoefficients::Encode(const boost::filesystem::path &payload_path)
+{
+    const std::string payload_filename = payload_path.filename().string();
+    const std::size_t payload_start = this->EncodeFilename(payload_filename);
+    std::size_t payload_size = 0;
+    uint32_t payload_crc = 0;
+
+    if (this->stream_window == 0)
+    {
+        // Map the payload into memory, it's embedded straight from the mapping
+        PayloadReader payload(payload_path);
+        payload_size = payload.Size();
+        payload_crc = Crc32c(0, payload.Data(), payload_size);
+
+        this->EncodePayload(payload_start, payload.Data(), payload.Data() + payload_size);
+    }
+    else
+    {
+        // Embed each window of the payload whilst the next one is being read
+        PayloadStreamReader payload(payload_path, this->stream_window);
+        const unsigned char *window;
+
+        for (std::size_t size; (size = payload.Next(&window)) > 0; payload_size += size)
+        {
+            payload_crc = Crc32c(payload_crc, window, size);
+            this->EncodePayload(payload_start + (payload_size * 8), window, window + size);
+        }
+    }
+
+    // Encode the header last, the payload length and checksum aren't known up front when streaming
+    this->EncodeHeader(payload_filename.size(), payload_size, payload_crc);
+
+    // Write the steganographic image
+    const std::vector<unsigned char> image_bytes = this->EncodeImage();
+    boost::filesystem::ofstream file("steg-" + this->image_path.filename().replace_extension(".jpg").string(), std::ios::binary);
+    file.write(reinterpret_cast<const char *>(image_bytes.data()), image_bytes.size());
+
+    if (!file.good())
+    {
+        throw EncodeException("Error: Failed to write steganographic image");
+    }
+}
+
+void JpegCoefficients::Decode()
+{
+    std::string payload_filename;
+    const ContainerHeader header = this->DecodeHeader();
+    const std::size_t payload_start = this->DecodeFilename(header, &payload_filename);
+    const std::size_t payload_length = header.payload_length;
+
+    if (this->stream_window == 0)
+    {
+        // The payload is decoded straight into the output file
+        PayloadWriter payload("steg-" + payload_filename, payload_length);
+
+        this->DecodePayload(payload_start, payload.Data(), payload.Data() + payload.Size());
+        VerifyPayload(header, Crc32c(0, payload.Data(), payload.Size()));
+        payload.Commit();
+    }
+    else
+    {
+        // Write each window of the payload whilst the next one is being decoded
+        PayloadStreamWriter payload("steg-" + payload_filename, this->stream_window);
+        uint32_t payload_crc = 0;
+
+        for (std::size_t offset = 0; offset < payload_length; offset += this->stream_window)
+        {
+            std::size_t size = std::min(this->stream_window, payload_length - offset);
+
+            this->DecodePayload(payload_start + (offset * 8), payload.Buffer(), payload.Buffer() + size);
+            payload_crc = Crc32c(payload_crc, payload.Buffer(), size);
+            payload.Write(size);
+        }
+
+        // The windows have been written, but the file is removed unless it's committed
+        VerifyPayload(header, payload_crc);
+        payload.Commit();
+    }
+}
+
+void JpegCoefficients::Embed(const std::string &payload_filename, const unsigned char *payload, const std::size_t &payload_size)
+{
+    const std::size_t payload_start = this->EncodeFilename(payload_filename);
+
+    // Encode the payload, and then the header which describes it, into the carrier image
+    this->EncodePayload(payload_start, payload, payload + payload_size);
+    this->EncodeHeader(payload_filename.size(), payload_size, Crc32c(0, payload, payload_size));
+}
+
+std::vector<unsigned char> JpegCoefficients::EncodeImage()
+{
+    Stats::Stage stage("write");
+
+    unsigned char *buffer = nullptr;
+    unsigned long size = 0;
+
+    const bool written = WriteCoefficients(&this->coefficients->decompress, this->coefficients->arrays, &buffer, &size);
+    std::vector<unsigned char> image_bytes;
+
+    if (written)
+    {
+        image_bytes.assign(buffer, buffer + size);
+        stage.Count(size);
+    }
+
+    free(buffer);
+
+    if (!written)
+    {
+        throw EncodeException("Error: Failed to write steganographic image");
+    }
+
+    return image_bytes;
+}
+
+DecodedPayload JpegCoefficients::DecodeBuffer()
+{
+    DecodedPayload payload;
+    const ContainerHeader header = this->DecodeHeader();
+    const std::size_t payload_start = this->DecodeFilename(header, &payload.filename);
+
+    // Decode the payload from the steganographic image, and check it against the header
+    payload.bytes.resize(header.payload_length);
+    this->DecodePayload(payload_start, payload.bytes.data(), payload.bytes.data() + payload.bytes.size());
+    VerifyPayload(header, Crc32c(0, payload.bytes.data(), payload.bytes.size()));
+
+    return payload;
+}
+
+ContainerHeader JpegCoefficients::Probe(std::string *payload_filename)
+{
+    const ContainerHeader header = this->DecodeHeader();
+    this->DecodeFilename(header, payload_filename);
+
+    return header;
+}
+
+void JpegCoefficients::Initialise(const std::vector<unsigned char> &image_bytes, const int &persistence)
+{
+    Stats::Stage stage("read", image_bytes.size());
+
+    this->coefficients.reset(new Coefficients());
+    this->coefficients->image_bytes = image_bytes;
+
+    Coefficients &state = *this->coefficients;
+
+    if (image_bytes.empty() || !ReadCoefficients(&state.decompress, &state.error, state.image_bytes.data(),
+            state.image_bytes.size(), &state.arrays, &state.rows))
+    {
+        throw ImageException("Error: Failed to decode input image");
+    }
+
+    const jpeg_component_info *component = &state.decompress.comp_info[0];
+    const JQUANT_TBL *table = state.decompress.quant_tbl_ptrs[component->quant_tbl_no];
+
+    if (!table)
+    {
+        throw ImageException("Error: Failed to decode input image");
+    }
+
+    // Move the coefficients apart by at least the persistence value, or a single step
+    this->persistence = persistence;
+    const int step = std::max((int)std::min(table->quantval[LOW_COEFFICIENT], table->quantval[HIGH_COEFFICIENT]), 1);
+    this->margin = std::max((persistence + step - 1) / step, 1);
+
+    state.width = component->width_in_blocks;
+    this->image_capacity = (std::size_t)component->width_in_blocks * component->height_in_blocks;
+}
+
+short *JpegCoefficients::Block(const std::size_t &slot) const
+{
+    return this->coefficients->rows[slot / this->coefficients->width][slot % this->coefficients->width];
+}
+
+std::size_t JpegCoefficients::PayloadStart(const std::size_t &filename_length) const
+{
+    return HEADER_BITS + (filename_length * 8);
+}
+
+std::size_t JpegCoefficients::Capacity() const
+{
+    return this->image_capacity;
+}
+
+std::size_t JpegCoefficients::EncodeFilename(const std::string &payload_filename)
+{
+    // Convert the filename to a vector<unsigned char>
+    std::vector<unsigned char> filename_bytes(payload_filename.begin(), payload_filename.end());
+
+    // Encode the filename into the carrier image, straight after the header
+    this->EncodeChunk(this->PayloadStart(0), filename_bytes.data(), filename_bytes.data() + filename_bytes.size());
+
+    return this->PayloadStart(filename_bytes.size());
+}
+
+std::size_t JpegCoefficients::DecodeFilename(const ContainerHeader &header, std::string *payload_filename)
+{
+    // Decode the filename from the steganographic image
+    std::vector<unsigned char> filename_bytes(header.filename_length);
+    this->DecodeChunk(this->PayloadStart(0), filename_bytes.data(), filename_bytes.data() + filename_bytes.size());
+
+    // Convert the filename vector<unsigned char> to a string
+    payload_filename->assign(filename_bytes.begin(), filename_bytes.end());
+
+    return this->PayloadStart(header.filename_length);
+}
+
+void JpegCoefficients::EncodeHeader(const std::size_t &filename_length, const std::size_t &payload_length,
+        const uint32_t &payload_crc)
+{
+    const ContainerHeader header = {TECHNIQUE_JPEG, this->persistence, 0, 0, 0, 0, filename_length, payload_length, payload_crc};
+    unsigned char header_bytes[HEADER_SIZE];
+    StoreHeader(header, header_bytes);
+
+    this->EncodeChunk(0, header_bytes, header_bytes + HEADER_SIZE);
+}
+
+ContainerHeader JpegCoefficients::DecodeHeader()
+{
+    unsigned char header_bytes[HEADER_SIZE] = {0};
+
+    // The rest of the header is only decoded when it starts with the magic, so other images are rejected early
+    if (this->image_capacity >= HEADER_BITS)
+    {
+        this->DecodeChunk(0, header_bytes, header_bytes + MAGIC_SIZE);
+
+        if (HasMagic(header_bytes))
+        {
+            this->DecodeChunk(MAGIC_SIZE * 8, header_bytes + MAGIC_SIZE, header_bytes + HEADER_SIZE);
+        }
+    }
+
+    const ContainerHeader header = LoadHeader(header_bytes, TECHNIQUE_JPEG);
+    CheckCapacity(header, this->PayloadStart(header.filename_length), this->image_capacity);
+
+    return header;
+}
+
+void JpegCoefficients::EncodePayload(const std::size_t &start, const unsigned char *it, const unsigned char *en)
+{
+    Stats::Stage stage("embed", en - it, (en - it) * 8);
+
+    // Ensure that the carrier has enough room for the payload
+    if (start + ((en - it) * 8) > this->image_capacity)
+    {
+        throw EncodeException("Error: Failed to encode payload, carrier too small");
+    }
+
+    // The work is split into small ranges of bytes so that it's evenly balanced across the thread pool
+    ThreadPool::Instance().ParallelFor(0, en - it, GRAIN_SIZE, [&](std::size_t begin, std::size_t end)
+    {
+        Tracer::Span span("embed", start + (begin * 8), end - begin, (end - begin) * 8);
+        this->EncodeChunk(start + (begin * 8), it + begin, it + end);
+    });
+}
+
+void JpegCoefficients::DecodePayload(const std::size_t &start, unsigned char *it, unsigned char *en)
+{
+    Stats::Stage stage("extract", en - it, (en - it) * 8);
+
+    // The work is split into small ranges of bytes so that it's evenly balanced across the thread pool
+    ThreadPool::Instance().ParallelFor(0, en - it, GRAIN_SIZE, [&](std::size_t begin, std::size_t end)
+    {
+        Tracer::Span span("extract", start + (begin * 8), end - begin, (end - begin) * 8);
+        this->DecodeChunk(start + (begin * 8), it + begin, it + end);
+    });
+}
+
+void JpegCoefficients::EncodeChunk(const std::size_t &start, const unsigned char *it, const unsigned char *en)
+{
+    for (std::size_t slot = start, bit = 0; it != en; slot++)
+    {
+        if (slot >= this->image_capacity)
+        {
+            throw EncodeException("Error: Failed to encode payload, carrier too small");
+        }
+
+        this->SwapCoefficients(this->Block(slot), this->GetBit(*it, bit % 8));
+
+        if (++bit % 8 == 0)
+        {
+            ++it;
+        }
+    }
+}
+
+void JpegCoefficients::DecodeChunk(const std::size_t &start, unsigned char *it, unsigned char *en)
+{
+    for (std::size_t slot = start, bit = 0; it != en; slot++)
+    {
+        if (slot >= this->image_capacity)
+        {
+            throw DecodeException("Error: Failed to decode payload");
+        }
+
+        const short *block = this->Block(slot);
+        this->SetBit(it, bit % 8, block[LOW_COEFFICIENT] < block[HIGH_COEFFICIENT]);
+
+        if (++bit % 8 == 0)
+        {
+            ++it;
+        }
+    }
+}
+
+void JpegCoefficients::SwapCoefficients(short *block, const int &value)
+{
+    // Clamping to the coefficient range keeps them apart, as the margin is at least one
+    const short minimum = std::max(std::min(block[LOW_COEFFICIENT], block[HIGH_COEFFICIENT]) - this->margin, -COEFFICIENT_LIMIT);
+    const short maximum = std::min(std::max(block[LOW_COEFFICIENT], block[HIGH_COEFFICIENT]) + this->margin, COEFFICIENT_LIMIT);
+
+    block[LOW_COEFFICIENT] = value ? minimum : maximum;
+    block[HIGH_COEFFICIENT] = value ? maximum : minimum;
+}
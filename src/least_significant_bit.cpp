@@ -15,255 +15,446 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
+#include <algorithm>
 #include "least_significant_bit.hpp"
+#include "bit_kernels.hpp"
+#include "crc32c.hpp"
+#include "payload.hpp"
+#include "stats.hpp"
+#include "thread_pool.hpp"
+#include "tracer.hpp"
 
-const int NUM_THREADS = std::thread::hardware_concurrency();
+// The number of payload bytes encoded/decoded by a single task in the thread pool
+const std::size_t GRAIN_SIZE = 65536;
 
 void LeastSignificantBit::Encode(const boost::filesystem::path &payload_path)
 {
-    // Ensure that the carrier has enough room for the payload
-    if (boost::filesystem::file_size(payload_path) * 8 > this->image_capacity)
-    {
-        throw EncodeException("Error: Failed to encode payload, carrier too small");
-    }
+    const std::string payload_filename = payload_path.filename().string();
+    const std::size_t payload_start = this->EncodeFilename(payload_filename);
+    std::size_t payload_size = 0;
+    uint32_t payload_crc = 0;
 
-    // Convert the filename to a vector<unsigned char>
-    std::string filename = payload_path.filename().string();
-    std::vector<unsigned char> filename_bytes(filename.begin(), filename.end());
+    if (this->stream_window == 0)
+    {
+        // Map the payload into memory, it's embedded straight from the mapping
+        PayloadReader payload(payload_path);
+        payload_size = payload.Size();
+        payload_crc = Crc32c(0, payload.Data(), payload_size);
 
-    // Encode the filename length into the carrier image
-    this->EncodeChunkLength(0, filename_bytes.size());
+        this->EncodePayload(payload_start, payload.Data(), payload.Data() + payload_size);
+    }
+    else
+    {
+        // Embed each window of the payload whilst the next one is being read
+        PayloadStreamReader payload(payload_path, this->stream_window);
+        const unsigned char *window;
 
-    // Encode the filename into the carrier image
-    this->EncodeChunk(32, filename_bytes.begin(), filename_bytes.end());
+        for (std::size_t size; (size = payload.Next(&window)) > 0; payload_size += size)
+        {
+            payload_crc = Crc32c(payload_crc, window, size);
+            this->EncodePayload(payload_start + (payload_size * 8), window, window + size);
+        }
+    }
 
-    // Read the payload into a vector<unsigned char>
-    std::vector<unsigned char> payload_bytes = this->ReadPayload(payload_path);
+    // Encode the header last, the payload length and checksum aren't known up front when streaming
+    this->EncodeHeader(payload_filename.size(), payload_size, payload_crc);
 
-    // Encode the payload length into the carrier image
-    this->EncodeChunkLength(32 + (filename_bytes.size() * 8), payload_bytes.size());
+    // Write the steganographic image
+    Stats::Stage stage("write", this->image.total() * this->image.elemSize());
+    cv::imwrite("steg-" + this->image_path.filename().replace_extension(".png").string(), this->image,
+            std::vector<int>{cv::IMWRITE_PNG_STRATEGY_HUFFMAN_ONLY, 1});
+}
 
-    // Determine how many threads to use so that each thread encodes more than 3500KB
-    int encode_threads = NUM_THREADS;
+void LeastSignificantBit::Decode()
+{
+    std::string payload_filename;
+    const ContainerHeader header = this->DecodeHeader();
+    const std::size_t payload_start = this->DecodeFilename(header, &payload_filename);
+    const std::size_t payload_length = header.payload_length;
 
-    while ((encode_threads > 1) && ((payload_bytes.size() / encode_threads)) < 3500)
+    if (this->stream_window == 0)
     {
-        encode_threads--;
-    }
+        // The payload is decoded straight into the output file
+        PayloadWriter payload("steg-" + payload_filename, payload_length);
 
-    // Encode the payload into the carrier image
-    if (encode_threads == 1)
-    {
-        this->EncodeChunk(64 + (filename_bytes.size() * 8), payload_bytes.begin(), payload_bytes.end());
+        this->DecodePayload(payload_start, payload.Data(), payload.Data() + payload.Size());
+        VerifyPayload(header, Crc32c(0, payload.Data(), payload.Size()));
+        payload.Commit();
     }
     else
     {
-        std::vector<std::thread> threads;
-        threads.reserve(encode_threads);
+        // Write each window of the payload whilst the next one is being decoded
+        PayloadStreamWriter payload("steg-" + payload_filename, this->stream_window);
+        uint32_t payload_crc = 0;
 
-        for (int i = 0; i < encode_threads; i++)
+        for (std::size_t offset = 0; offset < payload_length; offset += this->stream_window)
         {
-            threads.push_back(
-                    std::thread(&LeastSignificantBit::EncodeChunk,
-                        this,
-                        64 + (filename_bytes.size() * 8) + (((payload_bytes.size() / encode_threads) * 8) * i),
-                        payload_bytes.begin() + ((payload_bytes.size() / encode_threads) * i),
-                        payload_bytes.end() - ((payload_bytes.size() / encode_threads) * ((encode_threads - 1) - i))));
-        }
+            std::size_t size = std::min(this->stream_window, payload_length - offset);
 
-        // Wait for all the threads to finish encoding
-        for (std::thread &thr : threads)
-        {
-            thr.join();
+            this->DecodePayload(payload_start + (offset * 8), payload.Buffer(), payload.Buffer() + size);
+            payload_crc = Crc32c(payload_crc, payload.Buffer(), size);
+            payload.Write(size);
         }
+
+        // The windows have been written, but the file is removed unless it's committed
+        VerifyPayload(header, payload_crc);
+        payload.Commit();
     }
+}
 
-    // Write the steganographic image
-    cv::imwrite("steg-" + this->image_path.filename().replace_extension(".png").string(), this->image,
-            std::vector<int>{cv::IMWRITE_PNG_STRATEGY_HUFFMAN_ONLY, 1});
+void LeastSignificantBit::Embed(const std::string &payload_filename, const unsigned char *payload, const std::size_t &payload_size)
+{
+    const std::size_t payload_start = this->EncodeFilename(payload_filename);
+
+    // Encode the payload, and then the header which describes it, into the carrier image
+    this->EncodePayload(payload_start, payload, payload + payload_size);
+    this->EncodeHeader(payload_filename.size(), payload_size, Crc32c(0, payload, payload_size));
 }
 
-void LeastSignificantBit::Decode()
+std::vector<unsigned char> LeastSignificantBit::EncodeImage()
 {
-    // Decode the filename from the steganographic image
-    unsigned int filename_length = this->DecodeChunkLength(0);
-    std::vector<unsigned char> filename_bytes(filename_length);
-    this->DecodeChunk(32, filename_bytes.begin(), filename_bytes.end());
+    Stats::Stage stage("write", this->image.total() * this->image.elemSize());
 
-    // Convert the filename vector<unsigned char> to a string
-    std::string payload_filename(filename_bytes.begin(), filename_bytes.end());
+    std::vector<unsigned char> image_bytes;
+    cv::imencode(".png", this->image, image_bytes, std::vector<int>{cv::IMWRITE_PNG_STRATEGY_HUFFMAN_ONLY, 1});
+
+    return image_bytes;
+}
+
+DecodedPayload LeastSignificantBit::DecodeBuffer()
+{
+    DecodedPayload payload;
+    const ContainerHeader header = this->DecodeHeader();
+    const std::size_t payload_start = this->DecodeFilename(header, &payload.filename);
 
-    // Decode the payload length from the steganographic image
-    unsigned int payload_length = this->DecodeChunkLength(32 + (filename_length * 8));
+    // Decode the payload from the steganographic image, and check it against the header
+    payload.bytes.resize(header.payload_length);
+    this->DecodePayload(payload_start, payload.bytes.data(), payload.bytes.data() + payload.bytes.size());
+    VerifyPayload(header, Crc32c(0, payload.bytes.data(), payload.bytes.size()));
 
-    // Determine how many threads to use so that each thread decodes more than 3500KB
-    int decode_threads = NUM_THREADS;
+    return payload;
+}
 
-    while ((decode_threads > 1) && (payload_length / decode_threads) < 3500)
+ContainerHeader LeastSignificantBit::Probe(std::string *payload_filename)
+{
+    const ContainerHeader header = this->DecodeHeader();
+    this->DecodeFilename(header, payload_filename);
+
+    return header;
+}
+
+void LeastSignificantBit::SetBitsPerSample(const int &bits)
+{
+    this->embed_kernel = SelectSampleEmbedKernel(this->image.elemSize1(), bits);
+    this->extract_kernel = SelectSampleExtractKernel(this->image.elemSize1(), bits);
+
+    if (this->embed_kernel == nullptr || this->extract_kernel == nullptr)
     {
-        decode_threads--;
+        throw ImageException("Error: Bits per sample must be between 1 and 4");
     }
 
-    // Decode the payload from the steganographic image
-    std::vector<unsigned char> payload_bytes(payload_length);
+    this->bits_per_sample = bits;
+    this->image_capacity = LeastSignificantBit::LayoutCapacity(this->image.rows, this->image.cols, this->image.channels(), bits);
+}
+
+void LeastSignificantBit::SetFileOrder(const bool &bottom_up, const bool &reversed_channels)
+{
+    this->bottom_up = bottom_up;
+    this->reversed_channels = reversed_channels && this->image.channels() > 1;
+}
 
-    if (decode_threads == 1)
+void LeastSignificantBit::Initialise()
+{
+    this->bottom_up = false;
+    this->reversed_channels = false;
+
+    // Samples are either 8 or 16 bits wide, wider samples aren't stored losslessly as PNG
+    if (this->image.elemSize1() > 2)
     {
-        this->DecodeChunk(64 + (filename_length * 8), payload_bytes.begin(), payload_bytes.end());
+        throw ImageException("Error: Carrier image samples must be 8 or 16 bits wide");
+    }
+
+    this->SetBitsPerSample(1);
+}
+
+std::size_t LeastSignificantBit::PayloadStart(const std::size_t &filename_length) const
+{
+    return LeastSignificantBit::LayoutPayloadStart(this->bits_per_sample, filename_length);
+}
+
+std::size_t LeastSignificantBit::LayoutCapacity(const int &rows, const int &cols, const int &channels, const int &bits)
+{
+    return (std::size_t)rows * cols * channels * bits;
+}
+
+std::size_t LeastSignificantBit::LayoutPayloadStart(const int &bits, const std::size_t &filename_length)
+{
+    // The payload starts on a unit boundary so that it's embedded a unit at a time, and every field of
+    // the bitstream starts on a byte boundary
+    const std::size_t unit = 8 * bits;
+
+    return (HEADER_BITS * bits) + ((((filename_length * 8) + unit - 1) / unit) * unit);
+}
+
+std::size_t LeastSignificantBit::Capacity() const
+{
+    return this->image_capacity;
+}
+
+unsigned char *LeastSignificantBit::SamplePointer(const SlotCursor &cursor) const
+{
+    if (!this->reversed_channels)
+    {
+        return cursor.Pointer();
+    }
+
+    // Every row of slots starts on a pixel, so the slot number gives the channel within the pixel
+    const std::ptrdiff_t channels = this->image.channels();
+    const std::ptrdiff_t channel = cursor.Slot() % channels;
+
+    return cursor.Pointer() + ((channels - 1 - (2 * channel)) * (std::ptrdiff_t)this->image.elemSize1());
+}
+
+void LeastSignificantBit::SetSampleBit(const SlotCursor &cursor, const int &bit, const int &value)
+{
+    if (this->image.elemSize1() == 2)
+    {
+        this->SetBit(reinterpret_cast<uint16_t *>(this->SamplePointer(cursor)), bit, value);
     }
     else
     {
-        std::vector<std::thread> threads;
-        threads.reserve(decode_threads);
+        this->SetBit(this->SamplePointer(cursor), bit, value);
+    }
+}
 
-        for (int i = 0; i < decode_threads; i++)
-        {
-            threads.push_back(
-                std::thread(&LeastSignificantBit::DecodeChunk,
-                    this,
-                    64 + (filename_length * 8) + (((payload_length / decode_threads) * 8) * i),
-                    payload_bytes.begin() + ((payload_length / decode_threads) * i),
-                    payload_bytes.end() - ((payload_length / decode_threads) * ((decode_threads - 1) - i))));
-        }
+int LeastSignificantBit::GetSampleBit(const SlotCursor &cursor, const int &bit)
+{
+    if (this->image.elemSize1() == 2)
+    {
+        return this->GetBit(*reinterpret_cast<uint16_t *>(this->SamplePointer(cursor)), bit);
+    }
+
+    return this->GetBit(*this->SamplePointer(cursor), bit);
+}
+
+std::size_t LeastSignificantBit::EncodeFilename(const std::string &payload_filename)
+{
+    // Convert the filename to a vector<unsigned char>
+    std::vector<unsigned char> filename_bytes(payload_filename.begin(), payload_filename.end());
+
+    // Encode the filename into the carrier image, straight after the header
+    this->EncodeChunk(this->PayloadStart(0), filename_bytes.data(), filename_bytes.data() + filename_bytes.size());
+
+    return this->PayloadStart(filename_bytes.size());
+}
+
+std::size_t LeastSignificantBit::DecodeFilename(const ContainerHeader &header, std::string *payload_filename)
+{
+    // Decode the filename from the steganographic image
+    std::vector<unsigned char> filename_bytes(header.filename_length);
+    this->DecodeChunk(this->PayloadStart(0), filename_bytes.data(), filename_bytes.data() + filename_bytes.size());
+
+    // Convert the filename vector<unsigned char> to a string
+    payload_filename->assign(filename_bytes.begin(), filename_bytes.end());
+
+    return this->PayloadStart(header.filename_length);
+}
+
+void LeastSignificantBit::EncodeHeader(const std::size_t &filename_length, const std::size_t &payload_length,
+        const uint32_t &payload_crc)
+{
+    const ContainerHeader header = {TECHNIQUE_LSB, 0, this->bits_per_sample, 0, 0, 0, filename_length, payload_length, payload_crc};
+    unsigned char header_bytes[HEADER_SIZE];
+    StoreHeader(header, header_bytes);
+
+    // The header is embedded one bit per sample, in the samples which are skipped by the rest of the bitstream
+    const int bits = this->bits_per_sample;
+    this->SetBitsPerSample(1);
+    this->EncodeChunk(0, header_bytes, header_bytes + HEADER_SIZE);
+    this->SetBitsPerSample(bits);
+}
+
+ContainerHeader LeastSignificantBit::DecodeHeader()
+{
+    unsigned char header_bytes[HEADER_SIZE] = {0};
+
+    const int bits = this->bits_per_sample;
+    this->SetBitsPerSample(1);
+
+    // The rest of the header is only decoded when it starts with the magic, so other images are rejected early
+    if (this->image_capacity >= HEADER_BITS)
+    {
+        this->DecodeChunk(0, header_bytes, header_bytes + MAGIC_SIZE);
 
-        // Wait for all the threads to finish encoding
-        for (std::thread &thr : threads)
+        if (HasMagic(header_bytes))
         {
-            thr.join();
+            this->DecodeChunk(MAGIC_SIZE * 8, header_bytes + MAGIC_SIZE, header_bytes + HEADER_SIZE);
         }
     }
 
-    // Write the decoded payload
-    this->WritePayload("steg-" + payload_filename, payload_bytes);
+    this->SetBitsPerSample(bits);
+
+    const ContainerHeader header = LoadHeader(header_bytes, TECHNIQUE_LSB);
+
+    if (header.bits_per_sample < 1 || header.bits_per_sample > 4)
+    {
+        throw DecodeException("Error: Payload header is corrupt");
+    }
+
+    // The rest of the bitstream is decoded with the bits per sample it was encoded with
+    this->SetBitsPerSample(header.bits_per_sample);
+    CheckCapacity(header, this->PayloadStart(header.filename_length), this->image_capacity);
+
+    return header;
 }
 
-void LeastSignificantBit::EncodeChunk(const int &start, std::vector<unsigned char>::iterator it, std::vector<unsigned char>::iterator en)
+void LeastSignificantBit::EncodePayload(const std::size_t &start, const unsigned char *it, const unsigned char *en)
 {
-    int bit = 0;
-    bool loops_initialised = false;
+    Stats::Stage stage("embed", en - it, (en - it) * 8);
 
-    for (int row = 0; row < this->image.rows; row++)
+    // Ensure that the carrier has enough room for the payload
+    if (start + ((en - it) * 8) > this->image_capacity)
     {
-        for (int col = 0; col < this->image.cols; col++)
-        {
-            for (int cha = 0; cha < this->image.channels(); cha++)
-            {
-                if (!loops_initialised)
-                {
-                    row = (start / this->image.channels()) / this->image.cols;
-                    col = (start / this->image.channels()) % this->image.cols;
-                    cha = start % this->image.channels();
-                    loops_initialised = true;
-                }
-
-                this->SetBit(&this->image.at<cv::Vec3b>(row, col)[cha], 0, this->GetBit(*it, bit % 8));
-
-                if (++bit % 8 == 0 && ++it == en)
-                {
-                    return;
-                }
-            }
-        }
+        throw EncodeException("Error: Failed to encode payload, carrier too small");
     }
+
+    // The work is split into small ranges of bytes so that it's evenly balanced across the thread pool.
+    // Ranges are laid on the grid of whole units of the bitstream rather than from the start, so that no
+    // two ranges share a sample when the start isn't on a unit boundary e.g. a later window of a stream
+    const std::size_t grain = GRAIN_SIZE - (GRAIN_SIZE % this->bits_per_sample);
+    const std::size_t offset = (start / 8) % this->bits_per_sample;
+
+    ThreadPool::Instance().ParallelFor(0, offset + (en - it), grain, [&](std::size_t begin, std::size_t end)
+    {
+        begin = std::max(begin, offset) - offset;
+        end -= offset;
+
+        Tracer::Span span("embed", start + (begin * 8), end - begin);
+        this->EncodeChunk(start + (begin * 8), it + begin, it + end);
+    });
+}
+
+void LeastSignificantBit::DecodePayload(const std::size_t &start, unsigned char *it, unsigned char *en)
+{
+    Stats::Stage stage("extract", en - it, (en - it) * 8);
+
+    // The work is split into small ranges of bytes so that it's evenly balanced across the thread pool,
+    // on the same grid of whole units as when encoding
+    const std::size_t grain = GRAIN_SIZE - (GRAIN_SIZE % this->bits_per_sample);
+    const std::size_t offset = (start / 8) % this->bits_per_sample;
+
+    ThreadPool::Instance().ParallelFor(0, offset + (en - it), grain, [&](std::size_t begin, std::size_t end)
+    {
+        begin = std::max(begin, offset) - offset;
+        end -= offset;
+
+        Tracer::Span span("extract", start + (begin * 8), end - begin);
+        this->DecodeChunk(start + (begin * 8), it + begin, it + end);
+    });
 }
 
-void LeastSignificantBit::EncodeChunkLength(const int &start, const unsigned int &chunk_length)
+void LeastSignificantBit::EncodeChunk(const std::size_t &start, const unsigned char *it, const unsigned char *en)
 {
-    int bit = 0;
-    bool loops_initialised = false;
+    SlotCursor cursor = this->Seek(start / this->bits_per_sample);
+    int sample_bit = start % this->bits_per_sample;
 
-    for (int row = 0; row < this->image.rows; row++)
+    while (it != en)
     {
-        for (int col = 0; col < this->image.cols; col++)
+        // Embed as many whole units as fit in the remainder of the current row of samples, the kernels
+        // can't reorder the channels of a pixel
+        std::size_t units = (sample_bit != 0 || this->reversed_channels) ? 0 :
+            std::min(cursor.Contiguous() / 8, (std::size_t)(en - it) / this->bits_per_sample);
+
+        if (units > 0)
         {
-            for (int cha = 0; cha < this->image.channels(); cha++)
+            this->embed_kernel(cursor.Pointer(), it, units);
+
+            it += units * this->bits_per_sample;
+            cursor += units * 8;
+
+            continue;
+        }
+
+        // The next byte is unaligned, or straddles two rows of samples, embed it a bit at a time
+        for (int bit = 0; bit < 8; bit++)
+        {
+            if (cursor.End())
             {
-                if (!loops_initialised)
-                {
-                    row = (start / this->image.channels()) / this->image.cols;
-                    col = (start / this->image.channels()) % this->image.cols;
-                    cha = start % this->image.channels();
-                    loops_initialised = true;
-                }
-
-                this->SetBit(&this->image.at<cv::Vec3b>(row, col)[cha], 0, this->GetBit(chunk_length, bit));
-
-                if (++bit == 32)
-                {
-                    return;
-                }
+                throw EncodeException("Error: Failed to encode payload, carrier too small");
+            }
+
+            this->SetSampleBit(cursor, sample_bit, this->GetBit(*it, bit));
+
+            if (++sample_bit == this->bits_per_sample)
+            {
+                sample_bit = 0;
+                ++cursor;
             }
         }
+
+        ++it;
     }
 }
 
-void LeastSignificantBit::DecodeChunk(const int start, std::vector<unsigned char>::iterator it, std::vector<unsigned char>::iterator en)
+void LeastSignificantBit::DecodeChunk(const std::size_t &start, unsigned char *it, unsigned char *en)
 {
-    int bit = 0;
-    bool loops_initialised = false;
+    SlotCursor cursor = this->Seek(start / this->bits_per_sample);
+    int sample_bit = start % this->bits_per_sample;
 
-    for (int row = 0; row < this->image.rows; row++)
+    while (it != en)
     {
-        for (int col = 0; col < this->image.cols; col++)
+        // Extract as many whole units as fit in the remainder of the current row of samples, the kernels
+        // can't reorder the channels of a pixel
+        std::size_t units = (sample_bit != 0 || this->reversed_channels) ? 0 :
+            std::min(cursor.Contiguous() / 8, (std::size_t)(en - it) / this->bits_per_sample);
+
+        if (units > 0)
+        {
+            this->extract_kernel(cursor.Pointer(), it, units);
+
+            it += units * this->bits_per_sample;
+            cursor += units * 8;
+
+            continue;
+        }
+
+        // The next byte is unaligned, or straddles two rows of samples, extract it a bit at a time
+        for (int bit = 0; bit < 8; bit++)
         {
-            for (int cha = 0; cha < this->image.channels(); cha++)
+            if (cursor.End())
+            {
+                throw DecodeException("Error: Failed to decode payload");
+            }
+
+            this->SetBit(it, bit, this->GetSampleBit(cursor, sample_bit));
+
+            if (++sample_bit == this->bits_per_sample)
             {
-                if (!loops_initialised)
-                {
-                    row = (start / this->image.channels()) / this->image.cols;
-                    col = (start / this->image.channels()) % this->image.cols;
-                    cha = start % this->image.channels();
-                    loops_initialised = true;
-                }
-
-                this->SetBit(&(*it), bit % 8, this->GetBit(this->image.at<cv::Vec3b>(row, col)[cha], 0));
-
-                if (++bit % 8 == 0 && ++it == en)
-                {
-                    return;
-                }
+                sample_bit = 0;
+                ++cursor;
             }
         }
-    }
 
-    throw DecodeException("Error: Failed to decode payload");
+        ++it;
+    }
 }
 
-unsigned int LeastSignificantBit::DecodeChunkLength(const int &start)
+Steganography::SlotCursor LeastSignificantBit::Seek(const std::size_t &slot)
 {
-    unsigned int chunk_length = 0;
-
-    int bit = 0;
-    bool loops_initialised = false;
+    // The rows of a bottom-up carrier are walked from the last with a negative step
+    if (this->bottom_up)
+    {
+        return SlotCursor(this->image.ptr(this->image.rows - 1), -(std::ptrdiff_t)this->image.step[0], this->image.elemSize1(), 1,
+                this->image.rows, this->image.cols * this->image.channels(), slot);
+    }
 
-    for (int row = 0; row < this->image.rows; row++)
+    // Each sample is a slot, when the image is continuous its rows form a single row of samples
+    if (this->image.isContinuous())
     {
-        for (int col = 0; col < this->image.cols; col++)
-        {
-            for (int cha = 0; cha < this->image.channels(); cha++)
-            {
-                if (!loops_initialised)
-                {
-                    row = (start / this->image.channels()) / this->image.cols;
-                    col = (start / this->image.channels()) % this->image.cols;
-                    cha = start % this->image.channels();
-                    loops_initialised = true;
-                }
-
-                this->SetBit(&chunk_length, bit, this->GetBit(this->image.at<cv::Vec3b>(row, col)[cha], 0));
-
-                if (++bit == 32)
-                {
-                    if (chunk_length == 0 || chunk_length > this->image_capacity)
-                    {
-                        throw DecodeException("Error: Failed to decode payload length");
-                    }
-
-                    return chunk_length;
-                }
-            }
-        }
+        return SlotCursor(this->image.data, 0, this->image.elemSize1(), 1,
+                1, this->image.total() * this->image.channels(), slot);
     }
 
-    throw DecodeException("Error: Failed to decode payload length");
+    return SlotCursor(this->image.data, this->image.step[0], this->image.elemSize1(), 1,
+            this->image.rows, this->image.cols * this->image.channels(), slot);
 }
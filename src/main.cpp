@@ -15,12 +15,23 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <optparse.hpp>
 #include "least_significant_bit.hpp"
 #include "discrete_cosine_transform.hpp"
+#include "jpeg_coefficients.hpp"
+#include "mapped_carrier.hpp"
+#include "striped_steganography.hpp"
+#include "batch.hpp"
+#include "carrier_index.hpp"
+#include "probe.hpp"
+#include "payload.hpp"
+#include "stats.hpp"
+#include "tracer.hpp"
+#include "thread_pool.hpp"
 
 void help(optparse::OptionParser parser, std::string command)
 {
@@ -31,6 +42,7 @@ void help(optparse::OptionParser parser, std::string command)
     else if (command == "en" || command == "encode")
     {
         std::cout << "Usage: encode [options] image payload" << std::endl;
+        std::cout << "       encode --pool directory [options] payload" << std::endl;
         std::cout << std::endl
                   << "Options:" << std::endl
                   << parser.format_option_help();
@@ -42,6 +54,119 @@ void help(optparse::OptionParser parser, std::string command)
                   << "Options:" << std::endl
                   << parser.format_option_help();
     }
+    else if (command == "batch")
+    {
+        std::cout << "Usage: batch [options] manifest" << std::endl;
+        std::cout << std::endl
+                  << "Each line of the manifest is a tab separated carrier, payload and optionally" << std::endl
+                  << "the technique and output path." << std::endl;
+        std::cout << std::endl
+                  << "Options:" << std::endl
+                  << parser.format_option_help();
+    }
+    else if (command == "capacity")
+    {
+        std::cout << "Usage: capacity [options] directory|manifest" << std::endl;
+        std::cout << std::endl
+                  << "Prints a JSON line for each image giving the number of bytes, shared by the" << std::endl
+                  << "payload and its filename, which each technique can store with each of its" << std::endl
+                  << "layouts. Only the header of each PNG, JPEG or TIFF is read." << std::endl;
+        std::cout << std::endl
+                  << "Options:" << std::endl
+                  << parser.format_option_help();
+    }
+    else if (command == "probe")
+    {
+        std::cout << "Usage: probe [options] directory|manifest" << std::endl;
+        std::cout << std::endl
+                  << "Prints a JSON line for each image giving the technique, filename and size of" << std::endl
+                  << "its payload. The images of a directory are found recursively, each line of a" << std::endl
+                  << "manifest is an image path." << std::endl;
+        std::cout << std::endl
+                  << "Options:" << std::endl
+                  << parser.format_option_help();
+    }
+}
+
+/**
+ * Read the whole of stdin into memory.
+ */
+std::vector<unsigned char> read_stdin()
+{
+    try {
+        PayloadReader input("/dev/stdin");
+        return std::vector<unsigned char>(input.Data(), input.Data() + input.Size());
+    }
+    catch (EncodeException &e)
+    {
+        throw ImageException("Error: Failed to read input image");
+    }
+}
+
+/**
+ * Open the carrier image given on the command line, "-" reads it from stdin.
+ */
+template <class Technique, class... Arguments>
+Technique open_carrier(const std::string &carrier, Arguments... arguments)
+{
+    if (carrier == "-")
+    {
+        return Technique(read_stdin(), arguments...);
+    }
+
+    return Technique(boost::filesystem::path(carrier), arguments...);
+}
+
+/**
+ * Write a buffer to the output given on the command line, "-" writes it to stdout.
+ */
+void write_output(const std::string &output, const std::vector<unsigned char> &bytes)
+{
+    bool written;
+
+    if (output == "-")
+    {
+        std::cout.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+        std::cout.flush();
+        written = std::cout.good();
+    }
+    else
+    {
+        boost::filesystem::ofstream file(output, std::ios::binary);
+        file.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+        file.close();
+        written = !file.fail();
+    }
+
+    if (!written)
+    {
+        std::cerr << "Error: Failed to write \"" << output << "\"" << std::endl;
+        exit(1);
+    }
+}
+
+/**
+ * Pick the smallest carrier image of the pool which fits the payload, the index
+ * of the pool is brought up to date first.
+ */
+boost::filesystem::path select_carrier(const optparse::Values &options, const std::string &payload_path)
+{
+    CarrierIndex index(std::string(options.get("pool")));
+    index.Update();
+
+    const std::string technique = options.get("technique");
+    const CarrierLayout layout = {technique, options.get("bits"), options.get("channels"), options.get("pairs")};
+    std::size_t payload_size = boost::filesystem::file_size(payload_path);
+
+    // Matrix embedding spends 2^k - 1 slots on every k bits of the payload
+    const int matrix = options.get("matrix");
+
+    if (technique == "dct" && matrix > 0)
+    {
+        payload_size = (((((payload_size * 8) + matrix - 1) / matrix) * ((1 << matrix) - 1)) + 7) / 8;
+    }
+
+    return index.Select(layout, payload_size, boost::filesystem::path(payload_path).filename().string().size());
 }
 
 int main(int argc, char **argv)
@@ -50,7 +175,10 @@ int main(int argc, char **argv)
         .usage("%prog [options] <command> [arguments]\n\n"
             "where <command> is one of:\n\n"
             "\tencode (en) - Encode a file into a carrier image\n"
-            "\tdecode (de) - Decode a file from a carrier image\n\n"
+            "\tdecode (de) - Decode a file from a carrier image\n"
+            "\tbatch       - Encode each of the jobs listed in a manifest\n"
+            "\tprobe       - Find the images containing a payload\n"
+            "\tcapacity    - Calculate the capacity of images from their headers\n\n"
             "Use \"%prog help <command>\" for help on a specific command");
 
     parser.add_option("-p", "--persistence")
@@ -58,13 +186,123 @@ int main(int argc, char **argv)
         .type("int")
         .set_default(10);
 
+    parser.add_option("--bits")
+        .help("lsb encode into this many least significant bits of each sample, between 1 and 4, decode reads it from the payload header")
+        .type("int")
+        .set_default(1);
+
+    parser.add_option("--channels")
+        .help("dct encode into this many colour channels of each block, 0 uses every colour channel, decode reads it from the payload header")
+        .type("int")
+        .set_default(1);
+
+    parser.add_option("--pairs")
+        .help("dct encode into this many coefficient pairs of each channel, excepts values 1, 2, 4 or 8, decode reads it from the payload header")
+        .type("int")
+        .set_default(1);
+
+    parser.add_option("--matrix")
+        .help("dct encode the payload with matrix embedding, k bits in every 2^k - 1 blocks, 0 disables it, decode reads it from the payload header")
+        .type("int")
+        .set_default(0);
+
+    parser.add_option("--fixed-point")
+        .help("dct encode using fixed point SIMD kernels rather than floating point")
+        .action("store_true");
+
     parser.add_option("-t", "--technique")
-        .help("encode/decode technique, excepts values 'lsb' or 'dct'")
+        .help("encode/decode technique, excepts values 'lsb', 'dct' or 'jpeg'")
         .type("string")
         .set_default("dct");
 
+    parser.add_option("-j", "--threads")
+        .help("number of threads used to encode/decode, defaults to one per hardware thread")
+        .type("int")
+        .set_default(0);
+
+    parser.add_option("-s", "--stream")
+        .help("stream the payload through windows of this many MiB rather than holding it in memory")
+        .type("int")
+        .set_default(0);
+
+    parser.add_option("-m", "--memory")
+        .help("lsb/dct encode/decode the carrier image a stripe of rows at a time, holding at most this many MiB of pixels")
+        .type("int")
+        .set_default(0);
+
+    parser.add_option("--in-place")
+        .help("lsb encode/decode an uncompressed PGM, PPM or BMP carrier image through a memory mapping, only writing the pages which change")
+        .action("store_true");
+
+    parser.add_option("--pool")
+        .help("encode into the smallest carrier image of this directory which fits the payload, only the header of each new carrier is read into the directory's index")
+        .type("string")
+        .set_default("");
+
+    parser.add_option("-o", "--output")
+        .help("path to write the steganographic image/decoded payload to, '-' writes to stdout")
+        .type("string")
+        .set_default("");
+
+    parser.add_option("--stats")
+        .help("write the time spent in each stage, and hardware counters where available, to stderr as JSON")
+        .action("store_true");
+
+    parser.add_option("--trace")
+        .help("write a Chrome trace_event timeline of every chunk encoded/decoded to this path")
+        .type("string")
+        .set_default("");
+
     const optparse::Values options = parser.parse_args(argc, argv);
-    const std::vector<std::string> arguments = parser.args();
+    std::vector<std::string> arguments = parser.args();
+
+    if ((int)options.get("threads") < 0)
+    {
+        std::cerr << "Error: The number of threads must not be negative" << std::endl;
+        exit(1);
+    }
+
+    // Start recording before the thread pool is created so its threads are counted
+    if (options.get("stats"))
+    {
+        Stats::Enable(true);
+    }
+
+    ThreadPool::SetThreads((int)options.get("threads"));
+
+    if (!std::string(options.get("trace")).empty())
+    {
+        Tracer::Enable();
+    }
+
+    if ((int)options.get("stream") < 0)
+    {
+        std::cerr << "Error: The stream window must not be negative" << std::endl;
+        exit(1);
+    }
+
+    const std::size_t stream_window = (std::size_t)(int)options.get("stream") << 20;
+
+    if ((int)options.get("memory") < 0)
+    {
+        std::cerr << "Error: The memory budget must not be negative" << std::endl;
+        exit(1);
+    }
+
+    if ((int)options.get("memory") > 0 && (int)options.get("matrix") > 0)
+    {
+        std::cerr << "Error: Matrix embedding can't be used a stripe at a time" << std::endl;
+        exit(1);
+    }
+
+    if (options.get("in_place") && (std::string(options.get("technique")) != "lsb" || (int)options.get("memory") > 0))
+    {
+        std::cerr << "Error: Only the lsb technique can encode/decode in place" << std::endl;
+        exit(1);
+    }
+
+    const std::size_t memory_budget = (std::size_t)(int)options.get("memory") << 20;
+    const std::string output = options.get("output");
 
     if (arguments.size() == 0)
     {
@@ -85,27 +323,160 @@ int main(int argc, char **argv)
     }
     else if (arguments[0] == "en" || arguments[0] == "encode")
     {
+        // The carrier is picked from the pool rather than given
+        if (!std::string(options.get("pool")).empty() && arguments.size() == 2)
+        {
+            if (arguments[1] == "-" || options.get("in_place"))
+            {
+                std::cerr << "Error: A carrier is only picked from the pool for a payload file, which isn't encoded in place" << std::endl;
+                exit(1);
+            }
+
+            try {
+                arguments.push_back(select_carrier(options, arguments[1]).string());
+            }
+            catch (EncodeException &e)
+            {
+                std::cerr << e.what() << std::endl;
+                exit(1);
+            }
+            catch (boost::filesystem::filesystem_error &e)
+            {
+                std::cerr << "No such file or directory: \"" << arguments[1] << "\"" << std::endl;
+                exit(1);
+            }
+        }
+
         if (arguments.size() != 3)
         {
             help(parser, "encode");
         }
 
-        if (!boost::filesystem::exists(arguments[1]))
+        if (arguments[1] == "-" && arguments[2] == "-")
+        {
+            std::cerr << "Error: The payload and carrier can't both be read from stdin" << std::endl;
+            exit(1);
+        }
+
+        if (arguments[1] != "-" && !boost::filesystem::exists(arguments[1]))
         {
             std::cerr << "No such file or directory: \"" << arguments[1] << "\"" << std::endl;
             exit(1);
         }
 
+        // Piped images and other outputs are encoded in memory, which neither reads stripes nor streams windows
+        const bool in_memory = !output.empty() || arguments[1] == "-" || arguments[2] == "-";
+
+        if (in_memory && memory_budget > 0)
+        {
+            std::cerr << "Error: Carrier images encoded a stripe at a time can't be piped or written to --output" << std::endl;
+            exit(1);
+        }
+
+        if ((in_memory || options.get("in_place")) && stream_window > 0)
+        {
+            std::cerr << "Error: Payloads can't be streamed when piped, written to --output or encoded in place" << std::endl;
+            exit(1);
+        }
+
         try {
-            if (std::string(options.get("technique")) == "lsb")
+            if (options.get("in_place"))
+            {
+                if (arguments[2] == "-" || output == "-")
+                {
+                    std::cerr << "Error: Carrier images encoded in place can't be piped" << std::endl;
+                    exit(1);
+                }
+
+                // The carrier is copied to the output and the payload is embedded straight into its mapped pixels
+                PayloadReader payload(arguments[1] == "-" ? "/dev/stdin" : arguments[1]);
+                const std::string payload_filename = (arguments[1] == "-") ? "stdin" : boost::filesystem::path(arguments[1]).filename().string();
+
+                MappedCarrier carrier(arguments[2], output.empty() ? "steg-" + boost::filesystem::path(arguments[2]).filename().string() : output);
+                LeastSignificantBit lsb = LeastSignificantBit(carrier.Pixels());
+                lsb.SetBitsPerSample(options.get("bits"));
+                lsb.SetFileOrder(carrier.BottomUp(), carrier.ReversedChannels());
+                lsb.Embed(payload_filename, payload.Data(), payload.Size());
+                carrier.Commit();
+            }
+            else if (output.empty() && arguments[1] != "-" && arguments[2] != "-")
             {
-                LeastSignificantBit lsb = LeastSignificantBit(arguments[2]);
-                lsb.Encode(arguments[1]);
+                if (memory_budget > 0)
+                {
+                    StripedSteganography striped = StripedSteganography(arguments[2], options.get("technique"), memory_budget);
+                    striped.SetPersistence(options.get("persistence"));
+                    striped.SetBitsPerSample(options.get("bits"));
+                    striped.SetLayout(options.get("channels"), options.get("pairs"));
+                    striped.SetFixedPoint(options.get("fixed_point"));
+                    striped.Encode(arguments[1]);
+                }
+                else if (std::string(options.get("technique")) == "lsb")
+                {
+                    LeastSignificantBit lsb = LeastSignificantBit(arguments[2]);
+                    lsb.SetBitsPerSample(options.get("bits"));
+                    lsb.SetStreamWindow(stream_window);
+                    lsb.Encode(arguments[1]);
+                }
+                else if (std::string(options.get("technique")) == "dct")
+                {
+                    DiscreteCosineTransform dct = DiscreteCosineTransform(arguments[2], options.get("persistence"));
+                    dct.SetLayout(options.get("channels"), options.get("pairs"));
+                    dct.SetMatrixEmbedding(options.get("matrix"));
+                    dct.SetStreamWindow(stream_window);
+                    dct.SetFixedPoint(options.get("fixed_point"));
+                    dct.Encode(arguments[1]);
+                }
+                else if (std::string(options.get("technique")) == "jpeg")
+                {
+                    JpegCoefficients jpeg = JpegCoefficients(arguments[2], options.get("persistence"));
+                    jpeg.SetStreamWindow(stream_window);
+                    jpeg.Encode(arguments[1]);
+                }
             }
-            else if (std::string(options.get("technique")) == "dct")
+            else
             {
-                DiscreteCosineTransform dct = DiscreteCosineTransform(arguments[2], options.get("persistence"));
-                dct.Encode(arguments[1]);
+                // Piped input/output is encoded entirely in memory
+                PayloadReader payload(arguments[1] == "-" ? "/dev/stdin" : arguments[1]);
+                const std::string payload_filename = (arguments[1] == "-") ? "stdin" : boost::filesystem::path(arguments[1]).filename().string();
+                std::vector<unsigned char> image_bytes;
+                std::string extension;
+
+                if (std::string(options.get("technique")) == "lsb")
+                {
+                    LeastSignificantBit lsb = open_carrier<LeastSignificantBit>(arguments[2]);
+                    lsb.SetBitsPerSample(options.get("bits"));
+                    image_bytes = lsb.EncodeBuffer(payload_filename, payload.Data(), payload.Size());
+                    extension = ".png";
+                }
+                else if (std::string(options.get("technique")) == "dct")
+                {
+                    DiscreteCosineTransform dct = open_carrier<DiscreteCosineTransform>(arguments[2], (int)options.get("persistence"));
+                    dct.SetLayout(options.get("channels"), options.get("pairs"));
+                    dct.SetMatrixEmbedding(options.get("matrix"));
+                    dct.SetFixedPoint(options.get("fixed_point"));
+                    image_bytes = dct.EncodeBuffer(payload_filename, payload.Data(), payload.Size());
+                    extension = ".jpg";
+                }
+                else if (std::string(options.get("technique")) == "jpeg")
+                {
+                    JpegCoefficients jpeg = open_carrier<JpegCoefficients>(arguments[2], (int)options.get("persistence"));
+                    image_bytes = jpeg.EncodeBuffer(payload_filename, payload.Data(), payload.Size());
+                    extension = ".jpg";
+                }
+
+                // A carrier read from stdin is written to stdout unless told otherwise
+                if (!output.empty())
+                {
+                    write_output(output, image_bytes);
+                }
+                else if (arguments[2] == "-")
+                {
+                    write_output("-", image_bytes);
+                }
+                else
+                {
+                    write_output("steg-" + boost::filesystem::path(arguments[2]).filename().replace_extension(extension).string(), image_bytes);
+                }
             }
         }
         catch (ImageException &e)
@@ -126,16 +497,103 @@ int main(int argc, char **argv)
             help(parser, "decode");
         }
 
+        // Piped images and other outputs are decoded in memory, which neither reads stripes nor streams windows
+        const bool in_memory = !output.empty() || arguments[1] == "-";
+
+        if (in_memory && memory_budget > 0)
+        {
+            std::cerr << "Error: Carrier images decoded a stripe at a time can't be piped or written to --output" << std::endl;
+            exit(1);
+        }
+
+        if (in_memory && stream_window > 0)
+        {
+            std::cerr << "Error: Payloads can't be streamed when piped or written to --output" << std::endl;
+            exit(1);
+        }
+
         try {
-            if (std::string(options.get("technique")) == "lsb")
+            if (options.get("in_place"))
             {
-                LeastSignificantBit lsb = LeastSignificantBit(arguments[1]);
-                lsb.Decode();
+                if (arguments[1] == "-")
+                {
+                    std::cerr << "Error: Carrier images decoded in place can't be piped" << std::endl;
+                    exit(1);
+                }
+
+                MappedCarrier carrier(arguments[1]);
+                LeastSignificantBit lsb = LeastSignificantBit(carrier.Pixels());
+                lsb.SetBitsPerSample(options.get("bits"));
+                lsb.SetFileOrder(carrier.BottomUp(), carrier.ReversedChannels());
+
+                if (output.empty())
+                {
+                    lsb.SetStreamWindow(stream_window);
+                    lsb.Decode();
+                }
+                else
+                {
+                    DecodedPayload payload = lsb.DecodeBuffer();
+                    write_output(output, payload.bytes);
+                }
             }
-            else if (std::string(options.get("technique")) == "dct")
+            else if (output.empty() && arguments[1] != "-")
             {
-                DiscreteCosineTransform dct = DiscreteCosineTransform(arguments[1], options.get("persistence"));
-                dct.Decode();
+                if (memory_budget > 0)
+                {
+                    StripedSteganography striped = StripedSteganography(arguments[1], options.get("technique"), memory_budget);
+                    striped.SetPersistence(options.get("persistence"));
+                    striped.SetBitsPerSample(options.get("bits"));
+                    striped.SetLayout(options.get("channels"), options.get("pairs"));
+                    striped.Decode();
+                }
+                else if (std::string(options.get("technique")) == "lsb")
+                {
+                    LeastSignificantBit lsb = LeastSignificantBit(arguments[1]);
+                    lsb.SetBitsPerSample(options.get("bits"));
+                    lsb.SetStreamWindow(stream_window);
+                    lsb.Decode();
+                }
+                else if (std::string(options.get("technique")) == "dct")
+                {
+                    DiscreteCosineTransform dct = DiscreteCosineTransform(arguments[1], options.get("persistence"));
+                    dct.SetLayout(options.get("channels"), options.get("pairs"));
+                    dct.SetMatrixEmbedding(options.get("matrix"));
+                    dct.SetStreamWindow(stream_window);
+                    dct.Decode();
+                }
+                else if (std::string(options.get("technique")) == "jpeg")
+                {
+                    JpegCoefficients jpeg = JpegCoefficients(arguments[1], options.get("persistence"));
+                    jpeg.SetStreamWindow(stream_window);
+                    jpeg.Decode();
+                }
+            }
+            else
+            {
+                // Piped input/output is decoded entirely in memory
+                DecodedPayload payload;
+
+                if (std::string(options.get("technique")) == "lsb")
+                {
+                    LeastSignificantBit lsb = open_carrier<LeastSignificantBit>(arguments[1]);
+                    lsb.SetBitsPerSample(options.get("bits"));
+                    payload = lsb.DecodeBuffer();
+                }
+                else if (std::string(options.get("technique")) == "dct")
+                {
+                    DiscreteCosineTransform dct = open_carrier<DiscreteCosineTransform>(arguments[1], (int)options.get("persistence"));
+                    dct.SetLayout(options.get("channels"), options.get("pairs"));
+                    dct.SetMatrixEmbedding(options.get("matrix"));
+                    payload = dct.DecodeBuffer();
+                }
+                else if (std::string(options.get("technique")) == "jpeg")
+                {
+                    JpegCoefficients jpeg = open_carrier<JpegCoefficients>(arguments[1], (int)options.get("persistence"));
+                    payload = jpeg.DecodeBuffer();
+                }
+
+                write_output(output.empty() ? "steg-" + payload.filename : output, payload.bytes);
             }
         }
         catch (ImageException &e)
@@ -149,4 +607,90 @@ int main(int argc, char **argv)
             exit(1);
         }
     }
+    else if (arguments[0] == "batch")
+    {
+        if (arguments.size() != 2)
+        {
+            help(parser, "batch");
+            exit(1);
+        }
+
+        try {
+            const std::vector<BatchJob> jobs = BatchEncoder::ReadManifest(arguments[1], options.get("technique"));
+
+            // Each stage of the pipeline gets as many threads as the embedding thread pool
+            BatchEncoder encoder(ThreadPool::Instance().Threads(), options.get("persistence"));
+            encoder.SetBitsPerSample(options.get("bits"));
+            encoder.SetLayout(options.get("channels"), options.get("pairs"));
+            encoder.SetMatrixEmbedding(options.get("matrix"));
+            encoder.SetFixedPoint(options.get("fixed_point"));
+            const BatchReport report = encoder.Run(jobs);
+
+            for (const std::string &error : report.errors)
+            {
+                std::cerr << error << std::endl;
+            }
+
+            std::cout << "Encoded " << report.completed << "/" << jobs.size() << " jobs in " << report.seconds << " seconds ("
+                      << (report.seconds > 0 ? report.completed / report.seconds : 0) << " jobs/sec)" << std::endl;
+
+            if (!report.errors.empty())
+            {
+                exit(1);
+            }
+        }
+        catch (EncodeException &e)
+        {
+            std::cerr << e.what() << std::endl;
+            exit(1);
+        }
+    }
+    else if (arguments[0] == "probe")
+    {
+        if (arguments.size() != 2)
+        {
+            help(parser, "probe");
+            exit(1);
+        }
+
+        try {
+            CorpusProbe::Run(CorpusProbe::ReadImages(arguments[1]), std::cout);
+        }
+        catch (DecodeException &e)
+        {
+            std::cerr << e.what() << std::endl;
+            exit(1);
+        }
+    }
+    else if (arguments[0] == "capacity")
+    {
+        if (arguments.size() != 2)
+        {
+            help(parser, "capacity");
+            exit(1);
+        }
+
+        try {
+            for (const boost::filesystem::path &image_path : CorpusProbe::ReadImages(arguments[1]))
+            {
+                std::cout << CorpusProbe::Capacity(image_path) << "\n";
+            }
+        }
+        catch (DecodeException &e)
+        {
+            std::cerr << e.what() << std::endl;
+            exit(1);
+        }
+    }
+
+    if (options.get("stats"))
+    {
+        std::cerr << Stats::Json() << std::endl;
+    }
+
+    if (!std::string(options.get("trace")).empty())
+    {
+        std::ofstream trace(std::string(options.get("trace")));
+        Tracer::Write(trace);
+    }
 }
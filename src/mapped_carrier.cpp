@@ -0,0 +1,396 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <vector>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mapped_carrier.hpp"
+
+// The size of each read/write when the carrier can't be copied within the kernel
+const std::size_t COPY_SIZE = 1 << 20;
+
+// Image dimensions larger than this are rejected rather than risking overflow
+const std::size_t MAX_DIMENSION = 1 << 30;
+
+/**
+ * Read a little endian integer from the headers of a BMP image.
+ */
+static uint32_t ReadLittleEndian(const unsigned char *data, const int &bytes)
+{
+    uint32_t value = 0;
+
+    for (int byte = 0; byte < bytes; byte++)
+    {
+        value |= (uint32_t)data[byte] << (byte * 8);
+    }
+
+    return value;
+}
+
+/**
+ * Read the next decimal field of a PGM/PPM header, skipping whitespace and
+ * comments, which run to the end of the line.
+ */
+static bool ReadNetpbmField(const unsigned char *data, const std::size_t &size, std::size_t *offset, std::size_t *value)
+{
+    while (*offset < size && (std::isspace(data[*offset]) || data[*offset] == '#'))
+    {
+        if (data[*offset] == '#')
+        {
+            while (*offset < size && data[*offset] != '\n')
+            {
+                (*offset)++;
+            }
+        }
+        else
+        {
+            (*offset)++;
+        }
+    }
+
+    if (*offset == size || !std::isdigit(data[*offset]))
+    {
+        return false;
+    }
+
+    for (*value = 0; *offset < size && std::isdigit(data[*offset]); (*offset)++)
+    {
+        *value = (*value * 10) + (data[*offset] - '0');
+
+        if (*value > MAX_DIMENSION)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+MappedCarrier::MappedCarrier(const boost::filesystem::path &image_path)
+    : committed(false), mapping(nullptr), size(0), bottom_up(false), reversed_channels(false)
+{
+    int descriptor = open(image_path.c_str(), O_RDONLY);
+
+    if (descriptor == -1)
+    {
+        throw ImageException("Error: Failed to open input image");
+    }
+
+    try {
+        // Decoding never writes to the pixels, but a private mapping lets them be exposed as a cv::Mat
+        this->Map(descriptor, MAP_PRIVATE);
+    }
+    catch (ImageException &e)
+    {
+        close(descriptor);
+        this->Close();
+        throw;
+    }
+
+    close(descriptor);
+}
+
+MappedCarrier::MappedCarrier(const boost::filesystem::path &image_path, const boost::filesystem::path &output_path)
+    : committed(false), mapping(nullptr), size(0), bottom_up(false), reversed_channels(false)
+{
+    int source = open(image_path.c_str(), O_RDONLY);
+
+    if (source == -1)
+    {
+        throw ImageException("Error: Failed to open input image");
+    }
+
+    struct stat status;
+
+    if (fstat(source, &status) != 0 || !S_ISREG(status.st_mode))
+    {
+        close(source);
+        throw ImageException("Error: Failed to open input image");
+    }
+
+    // Opening the output truncates it, which would destroy the carrier if they're the same file
+    boost::system::error_code error;
+
+    if (boost::filesystem::equivalent(image_path, output_path, error))
+    {
+        close(source);
+        throw ImageException("Error: The output image can't be the carrier image");
+    }
+
+    int destination = open(output_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+
+    if (destination == -1)
+    {
+        close(source);
+        throw ImageException("Error: Failed to create output image");
+    }
+
+    // From here on a failure removes the partial output
+    this->output_path = output_path;
+
+    try {
+        if (!MappedCarrier::Copy(source, destination, status.st_size))
+        {
+            throw ImageException("Error: Failed to copy input image");
+        }
+
+        this->Map(destination, MAP_SHARED);
+    }
+    catch (ImageException &e)
+    {
+        close(source);
+        close(destination);
+        this->Close();
+        throw;
+    }
+
+    close(source);
+    close(destination);
+}
+
+MappedCarrier::~MappedCarrier()
+{
+    this->Close();
+}
+
+cv::Mat MappedCarrier::Pixels() const
+{
+    return this->pixels;
+}
+
+bool MappedCarrier::BottomUp() const
+{
+    return this->bottom_up;
+}
+
+bool MappedCarrier::ReversedChannels() const
+{
+    return this->reversed_channels;
+}
+
+void MappedCarrier::Commit()
+{
+    this->pixels.release();
+
+    if (this->mapping)
+    {
+        munmap(this->mapping, this->size);
+        this->mapping = nullptr;
+    }
+
+    this->committed = true;
+}
+
+void MappedCarrier::Close()
+{
+    this->pixels.release();
+
+    if (this->mapping)
+    {
+        munmap(this->mapping, this->size);
+        this->mapping = nullptr;
+    }
+
+    // The output was never committed, don't leave a partial file behind
+    if (!this->output_path.empty() && !this->committed)
+    {
+        unlink(this->output_path.c_str());
+    }
+}
+
+void MappedCarrier::Map(const int &descriptor, const int &flags)
+{
+    struct stat status;
+
+    if (fstat(descriptor, &status) != 0 || !S_ISREG(status.st_mode) || status.st_size < 2)
+    {
+        throw ImageException("Error: Failed to open input image");
+    }
+
+    this->size = status.st_size;
+    void *mapping = mmap(nullptr, this->size, PROT_READ | PROT_WRITE, flags, descriptor, 0);
+
+    if (mapping == MAP_FAILED)
+    {
+        throw ImageException("Error: Failed to map input image");
+    }
+
+    this->mapping = static_cast<unsigned char *>(mapping);
+
+    if (this->mapping[0] == 'P')
+    {
+        this->ParseNetpbm();
+    }
+    else if (this->mapping[0] == 'B' && this->mapping[1] == 'M')
+    {
+        this->ParseBitmap();
+    }
+    else
+    {
+        throw ImageException("Error: Carrier image must be an uncompressed PGM, PPM or BMP image");
+    }
+}
+
+void MappedCarrier::ParseNetpbm()
+{
+    if (this->mapping[1] != '5' && this->mapping[1] != '6')
+    {
+        throw ImageException("Error: Carrier image must be a binary PGM or PPM image");
+    }
+
+    const int channels = (this->mapping[1] == '5') ? 1 : 3;
+    std::size_t offset = 2;
+    std::size_t cols, rows, maxval;
+
+    if (!ReadNetpbmField(this->mapping, this->size, &offset, &cols) || !ReadNetpbmField(this->mapping, this->size, &offset, &rows)
+            || !ReadNetpbmField(this->mapping, this->size, &offset, &maxval) || offset == this->size || !std::isspace(this->mapping[offset])
+            || cols == 0 || rows == 0 || maxval == 0)
+    {
+        throw ImageException("Error: Failed to parse input image header");
+    }
+
+    // Samples with a maxval above 255 are 16-bit big endian, which the LSB kernels can't address
+    if (maxval > 255)
+    {
+        throw ImageException("Error: Carrier image samples must be 8 bits wide");
+    }
+
+    // A single whitespace character separates the header from the pixels
+    offset++;
+
+    if (rows > (this->size - offset) / (cols * channels))
+    {
+        throw ImageException("Error: Input image is truncated");
+    }
+
+    this->pixels = cv::Mat(rows, cols, CV_MAKETYPE(CV_8U, channels), this->mapping + offset);
+
+    // PPM samples are stored RGB, cv::imread gives BGR
+    this->reversed_channels = (channels == 3);
+}
+
+void MappedCarrier::ParseBitmap()
+{
+    // The file header followed by at least a BITMAPINFOHEADER
+    if (this->size < 54 || ReadLittleEndian(this->mapping + 14, 4) < 40)
+    {
+        throw ImageException("Error: Failed to parse input image header");
+    }
+
+    const std::size_t offset = ReadLittleEndian(this->mapping + 10, 4);
+    const int32_t width = ReadLittleEndian(this->mapping + 18, 4);
+    const int32_t height = ReadLittleEndian(this->mapping + 22, 4);
+    const int bits = ReadLittleEndian(this->mapping + 28, 2);
+    const uint32_t compression = ReadLittleEndian(this->mapping + 30, 4);
+
+    // cv::imread drops the fourth byte of a 32-bit pixel, so it can't carry bits which decode normally
+    if (compression != 0 || bits != 24)
+    {
+        throw ImageException("Error: Carrier image must be an uncompressed 24-bit BMP image");
+    }
+
+    // A negative height is a top-down image, otherwise the rows are stored bottom-up
+    const std::size_t cols = (width > 0) ? width : 0;
+    const std::size_t rows = (height < 0) ? -(int64_t)height : height;
+
+    if (cols == 0 || rows == 0 || cols > MAX_DIMENSION || rows > MAX_DIMENSION || offset > this->size)
+    {
+        throw ImageException("Error: Failed to parse input image header");
+    }
+
+    // Each row is padded to a multiple of four bytes
+    const std::size_t step = ((cols * bits + 31) / 32) * 4;
+
+    if (rows > (this->size - offset) / step)
+    {
+        throw ImageException("Error: Input image is truncated");
+    }
+
+    this->pixels = cv::Mat(rows, cols, CV_8UC3, this->mapping + offset, step);
+    this->bottom_up = (height > 0);
+}
+
+bool MappedCarrier::Copy(const int &source, const int &destination, const std::size_t &size)
+{
+#ifdef FICLONE
+    // Share the source's extents, the filesystem only copies the pages which are later written
+    if (ioctl(destination, FICLONE, source) == 0)
+    {
+        return true;
+    }
+#endif
+
+    std::size_t copied = 0;
+
+    // Copy within the kernel, falling back to reads and writes where that isn't supported
+    while (copied < size)
+    {
+        ssize_t bytes = copy_file_range(source, nullptr, destination, nullptr, size - copied, 0);
+
+        if (bytes < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (bytes <= 0)
+        {
+            break;
+        }
+
+        copied += bytes;
+    }
+
+    std::vector<unsigned char> buffer(copied < size ? COPY_SIZE : 0);
+
+    while (copied < size)
+    {
+        ssize_t bytes = read(source, buffer.data(), std::min(COPY_SIZE, size - copied));
+
+        if (bytes < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (bytes <= 0)
+        {
+            return false;
+        }
+
+        for (ssize_t written = 0; written < bytes;)
+        {
+            ssize_t chunk = write(destination, buffer.data() + written, bytes - written);
+
+            if (chunk < 0 && errno != EINTR)
+            {
+                return false;
+            }
+
+            written += std::max(chunk, (ssize_t)0);
+        }
+
+        copied += bytes;
+    }
+
+    return true;
+}
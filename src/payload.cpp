@@ -0,0 +1,392 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "payload.hpp"
+
+// The size of each read when the payload can't be memory mapped
+const std::size_t READ_SIZE = 1 << 20;
+
+/**
+ * Create the file which a payload is decoded into. Regular files, and paths
+ * which don't exist yet, are decoded into a temporary file alongside them which
+ * replaces them on commit, so a failed decode never touches an existing file;
+ * anything else (e.g. a pipe) is written directly.
+ *
+ * @param payload_path The path to the payload file.
+ * @param temporary_path Set to the path of the temporary file, left empty when
+ * the payload is written directly.
+ * @return The open file descriptor, -1 on failure.
+ */
+static int CreatePayload(const boost::filesystem::path &payload_path, std::string *temporary_path)
+{
+    struct stat status;
+
+    if (stat(payload_path.c_str(), &status) == 0 && !S_ISREG(status.st_mode))
+    {
+        return open(payload_path.c_str(), O_WRONLY);
+    }
+
+    const boost::filesystem::path directory = payload_path.has_parent_path() ? payload_path.parent_path() : ".";
+    *temporary_path = (directory / (payload_path.filename().string() + ".XXXXXX")).string();
+
+    const int descriptor = mkstemp(&(*temporary_path)[0]);
+
+    if (descriptor == -1)
+    {
+        temporary_path->clear();
+        return -1;
+    }
+
+    fchmod(descriptor, 0644);
+    return descriptor;
+}
+
+/**
+ * Replace the payload file with the temporary file it was decoded into.
+ *
+ * @param temporary_path The path of the temporary file, empty when the payload
+ * was written directly.
+ * @param payload_path The path to the payload file.
+ * @exception DecodeException Thrown when the payload can't be replaced.
+ */
+static void ReplacePayload(const std::string &temporary_path, const boost::filesystem::path &payload_path)
+{
+    if (!temporary_path.empty() && rename(temporary_path.c_str(), payload_path.c_str()) != 0)
+    {
+        unlink(temporary_path.c_str());
+        throw DecodeException("Error: Failed to write payload");
+    }
+}
+
+PayloadReader::PayloadReader(const boost::filesystem::path &payload_path) : mapping(nullptr), data(nullptr), size(0)
+{
+    int descriptor = open(payload_path.c_str(), O_RDONLY);
+
+    if (descriptor == -1)
+    {
+        throw EncodeException("Error: Failed to open payload");
+    }
+
+    struct stat status;
+
+    if (fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0)
+    {
+        this->mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+        if (this->mapping == MAP_FAILED)
+        {
+            this->mapping = nullptr;
+        }
+        else
+        {
+            madvise(this->mapping, status.st_size, MADV_SEQUENTIAL);
+
+            this->data = static_cast<const unsigned char *>(this->mapping);
+            this->size = status.st_size;
+        }
+    }
+
+    // Fall back to buffered reads for pipes and anything else which can't be mapped
+    if (!this->mapping)
+    {
+        ssize_t bytes;
+
+        do
+        {
+            std::size_t used = this->buffer.size();
+            this->buffer.resize(used + READ_SIZE);
+
+            bytes = read(descriptor, this->buffer.data() + used, READ_SIZE);
+
+            if (bytes < 0 && errno != EINTR)
+            {
+                close(descriptor);
+                throw EncodeException("Error: Failed to read payload");
+            }
+
+            this->buffer.resize(used + std::max(bytes, (ssize_t)0));
+        }
+        while (bytes != 0);
+
+        this->data = this->buffer.data();
+        this->size = this->buffer.size();
+    }
+
+    close(descriptor);
+}
+
+PayloadReader::~PayloadReader()
+{
+    if (this->mapping)
+    {
+        munmap(this->mapping, this->size);
+    }
+}
+
+const unsigned char *PayloadReader::Data() const
+{
+    return this->data;
+}
+
+std::size_t PayloadReader::Size() const
+{
+    return this->size;
+}
+
+PayloadWriter::PayloadWriter(const boost::filesystem::path &payload_path, const std::size_t &size)
+    : payload_path(payload_path), mapping(nullptr), data(nullptr), size(size)
+{
+    this->descriptor = CreatePayload(payload_path, &this->temporary_path);
+
+    if (this->descriptor == -1)
+    {
+        throw DecodeException("Error: Failed to create payload");
+    }
+
+    // Size the file up front and decode straight into its pages
+    if (!this->temporary_path.empty() && size > 0 && ftruncate(this->descriptor, size) == 0)
+    {
+        this->mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, this->descriptor, 0);
+
+        if (this->mapping == MAP_FAILED)
+        {
+            this->mapping = nullptr;
+        }
+    }
+
+    if (this->mapping)
+    {
+        this->data = static_cast<unsigned char *>(this->mapping);
+    }
+    else
+    {
+        this->buffer.resize(size);
+        this->data = this->buffer.data();
+    }
+}
+
+PayloadWriter::~PayloadWriter()
+{
+    if (this->mapping)
+    {
+        munmap(this->mapping, this->size);
+    }
+
+    // The payload was never committed, don't leave a partial file behind
+    if (this->descriptor != -1)
+    {
+        close(this->descriptor);
+
+        if (!this->temporary_path.empty())
+        {
+            unlink(this->temporary_path.c_str());
+        }
+    }
+}
+
+unsigned char *PayloadWriter::Data()
+{
+    return this->data;
+}
+
+std::size_t PayloadWriter::Size() const
+{
+    return this->size;
+}
+
+void PayloadWriter::Commit()
+{
+    if (this->mapping)
+    {
+        munmap(this->mapping, this->size);
+        this->mapping = nullptr;
+    }
+
+    for (std::size_t written = 0; written < this->buffer.size();)
+    {
+        ssize_t bytes = write(this->descriptor, this->buffer.data() + written, this->buffer.size() - written);
+
+        if (bytes < 0 && errno != EINTR)
+        {
+            throw DecodeException("Error: Failed to write payload");
+        }
+
+        written += std::max(bytes, (ssize_t)0);
+    }
+
+    close(this->descriptor);
+    this->descriptor = -1;
+
+    ReplacePayload(this->temporary_path, this->payload_path);
+}
+
+PayloadStreamReader::PayloadStreamReader(const boost::filesystem::path &payload_path, const std::size_t &window) : current(0)
+{
+    this->descriptor = open(payload_path.c_str(), O_RDONLY);
+
+    if (this->descriptor == -1)
+    {
+        throw EncodeException("Error: Failed to open payload");
+    }
+
+    posix_fadvise(this->descriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    this->buffers[0].resize(window);
+    this->buffers[1].resize(window);
+
+    this->pending = std::async(std::launch::async, &PayloadStreamReader::Fill, this, &this->buffers[this->current]);
+}
+
+PayloadStreamReader::~PayloadStreamReader()
+{
+    if (this->pending.valid())
+    {
+        this->pending.wait();
+    }
+
+    close(this->descriptor);
+}
+
+std::size_t PayloadStreamReader::Next(const unsigned char **data)
+{
+    if (!this->pending.valid())
+    {
+        return 0;
+    }
+
+    std::size_t size = this->pending.get();
+    *data = this->buffers[this->current].data();
+
+    // Read the following window whilst this one is being processed
+    if (size == this->buffers[this->current].size())
+    {
+        this->current ^= 1;
+        this->pending = std::async(std::launch::async, &PayloadStreamReader::Fill, this, &this->buffers[this->current]);
+    }
+
+    return size;
+}
+
+std::size_t PayloadStreamReader::Fill(std::vector<unsigned char> *buffer)
+{
+    std::size_t used = 0;
+
+    while (used < buffer->size())
+    {
+        ssize_t bytes = read(this->descriptor, buffer->data() + used, buffer->size() - used);
+
+        if (bytes < 0 && errno != EINTR)
+        {
+            throw EncodeException("Error: Failed to read payload");
+        }
+
+        if (bytes == 0)
+        {
+            break;
+        }
+
+        used += std::max(bytes, (ssize_t)0);
+    }
+
+    return used;
+}
+
+PayloadStreamWriter::PayloadStreamWriter(const boost::filesystem::path &payload_path, const std::size_t &window)
+    : payload_path(payload_path), current(0)
+{
+    this->descriptor = CreatePayload(payload_path, &this->temporary_path);
+
+    if (this->descriptor == -1)
+    {
+        throw DecodeException("Error: Failed to create payload");
+    }
+
+    this->buffers[0].resize(window);
+    this->buffers[1].resize(window);
+}
+
+PayloadStreamWriter::~PayloadStreamWriter()
+{
+    if (this->pending.valid())
+    {
+        this->pending.wait();
+    }
+
+    // The payload was never committed, don't leave a partial file behind
+    if (this->descriptor != -1)
+    {
+        close(this->descriptor);
+
+        if (!this->temporary_path.empty())
+        {
+            unlink(this->temporary_path.c_str());
+        }
+    }
+}
+
+unsigned char *PayloadStreamWriter::Buffer()
+{
+    return this->buffers[this->current].data();
+}
+
+void PayloadStreamWriter::Write(const std::size_t &size)
+{
+    // The other buffer is free once its write has completed
+    if (this->pending.valid())
+    {
+        this->pending.get();
+    }
+
+    this->pending = std::async(std::launch::async, &PayloadStreamWriter::Drain, this, &this->buffers[this->current], size);
+    this->current ^= 1;
+}
+
+void PayloadStreamWriter::Commit()
+{
+    if (this->pending.valid())
+    {
+        this->pending.get();
+    }
+
+    close(this->descriptor);
+    this->descriptor = -1;
+
+    ReplacePayload(this->temporary_path, this->payload_path);
+}
+
+void PayloadStreamWriter::Drain(const std::vector<unsigned char> *buffer, const std::size_t &size)
+{
+    for (std::size_t written = 0; written < size;)
+    {
+        ssize_t bytes = write(this->descriptor, buffer->data() + written, size - written);
+
+        if (bytes < 0 && errno != EINTR)
+        {
+            throw DecodeException("Error: Failed to write payload");
+        }
+
+        written += std::max(bytes, (ssize_t)0);
+    }
+}
@@ -0,0 +1,283 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <boost/filesystem/fstream.hpp>
+#include "probe.hpp"
+#include "carrier_info.hpp"
+#include "discrete_cosine_transform.hpp"
+#include "jpeg_coefficients.hpp"
+#include "least_significant_bit.hpp"
+#include "striped_steganography.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * The number of images probed before their results are written, results are
+ * written in order so this bounds how many are held in memory.
+ */
+static const std::size_t CHUNK_SIZE = 1024;
+
+/**
+ * Escape a string for use within a JSON string.
+ */
+static std::string Escape(const std::string &value)
+{
+    std::string escaped;
+    escaped.reserve(value.size());
+
+    for (const char character : value)
+    {
+        if (character == '"' || character == '\\')
+        {
+            escaped += '\\';
+            escaped += character;
+        }
+        else if ((unsigned char)character < 0x20 || character == 0x7f)
+        {
+            char code[7];
+            snprintf(code, sizeof(code), "\\u%04x", (unsigned char)character);
+            escaped += code;
+        }
+        else
+        {
+            escaped += character;
+        }
+    }
+
+    return escaped;
+}
+
+/**
+ * @return Whether the header of an image is that of a JPEG image.
+ */
+static bool IsJpeg(const boost::filesystem::path &image_path)
+{
+    try {
+        return ReadCarrierInfo(image_path).format == "jpeg";
+    }
+    catch (ImageException &e)
+    {
+        return false;
+    }
+}
+
+std::vector<boost::filesystem::path> CorpusProbe::ReadImages(const boost::filesystem::path &path)
+{
+    std::vector<boost::filesystem::path> images;
+
+    try {
+        if (boost::filesystem::is_directory(path))
+        {
+            for (boost::filesystem::recursive_directory_iterator entry(path), end; entry != end; ++entry)
+            {
+                if (boost::filesystem::is_regular_file(entry->status()))
+                {
+                    images.push_back(entry->path());
+                }
+            }
+
+            // The iteration order of a directory is arbitrary
+            std::sort(images.begin(), images.end());
+
+            return images;
+        }
+    }
+    catch (boost::filesystem::filesystem_error &e)
+    {
+        throw DecodeException("Error: Failed to read directory");
+    }
+
+    boost::filesystem::ifstream manifest(path);
+
+    if (!manifest.good())
+    {
+        throw DecodeException("Error: Failed to open manifest");
+    }
+
+    for (std::string line; std::getline(manifest, line);)
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        images.push_back(line.substr(0, line.find('\t')));
+    }
+
+    return images;
+}
+
+/**
+ * Decode the container header and filename of a single technique from an image.
+ *
+ * @return Whether the image contains a payload of the technique.
+ */
+template <typename Technique>
+static bool ProbeTechnique(Technique &probe, const std::string &technique, ProbeResult *result)
+{
+    try {
+        const ContainerHeader header = probe.Probe(&result->filename);
+
+        result->technique = technique;
+        result->payload_size = header.payload_length;
+
+        return true;
+    }
+    catch (DecodeException &e)
+    {
+        // The image doesn't contain a payload of this technique
+        return false;
+    }
+}
+
+ProbeResult CorpusProbe::Probe(const boost::filesystem::path &image_path)
+{
+    ProbeResult result = {image_path, "", "", 0, ""};
+    bool striped = true;
+
+    for (const std::string technique : {"lsb", "dct"})
+    {
+        try {
+            // The smallest budget reads a single stripe at a time, so only the rows holding the header are read
+            StripedSteganography probe(image_path, technique, 1);
+
+            if (ProbeTechnique(probe, technique, &result))
+            {
+                return result;
+            }
+        }
+        catch (ImageException &e)
+        {
+            // Interlaced PNG, BMP and TIFF images can't be read a stripe at a time
+            striped = false;
+            break;
+        }
+    }
+
+    try {
+        if (!striped)
+        {
+            // The image is decoded once and shared by both techniques
+            LeastSignificantBit lsb(image_path);
+            DiscreteCosineTransform dct(lsb.Image(), 10);
+
+            if (ProbeTechnique(lsb, "lsb", &result) || ProbeTechnique(dct, "dct", &result))
+            {
+                return result;
+            }
+        }
+
+        if (IsJpeg(image_path))
+        {
+            // The coefficients of the whole image are read, so JPEG is only tried once the others are ruled out
+            JpegCoefficients jpeg(image_path, 10);
+            ProbeTechnique(jpeg, "jpeg", &result);
+        }
+    }
+    catch (ImageException &e)
+    {
+        result.error = e.what();
+    }
+
+    return result;
+}
+
+std::string CorpusProbe::Json(const ProbeResult &result)
+{
+    std::ostringstream json;
+    json << "{\"image\": \"" << Escape(result.image_path.string()) << "\", ";
+
+    if (!result.error.empty())
+    {
+        json << "\"error\": \"" << Escape(result.error) << "\"}";
+    }
+    else if (result.technique.empty())
+    {
+        json << "\"technique\": null}";
+    }
+    else
+    {
+        json << "\"technique\": \"" << result.technique << "\", "
+             << "\"filename\": \"" << Escape(result.filename) << "\", "
+             << "\"payload_size\": " << result.payload_size << "}";
+    }
+
+    return json.str();
+}
+
+std::string CorpusProbe::Capacity(const boost::filesystem::path &image_path)
+{
+    std::ostringstream json;
+    json << "{\"image\": \"" << Escape(image_path.string()) << "\", ";
+
+    try {
+        const CarrierInfo info = ReadCarrierInfo(image_path);
+
+        json << "\"format\": \"" << info.format << "\", "
+             << "\"rows\": " << info.rows << ", "
+             << "\"cols\": " << info.cols << ", "
+             << "\"channels\": " << info.channels << ", "
+             << "\"capacity\": {";
+
+        const std::vector<CarrierLayout> layouts = CarrierLayouts(info);
+
+        for (std::size_t i = 0; i < layouts.size(); i++)
+        {
+            json << (i ? ", " : "") << "\"" << LayoutName(layouts[i]) << "\": " << PayloadCapacity(info, layouts[i], 0);
+        }
+
+        json << "}}";
+    }
+    catch (ImageException &e)
+    {
+        json << "\"error\": \"" << Escape(e.what()) << "\"}";
+    }
+
+    return json.str();
+}
+
+std::size_t CorpusProbe::Run(const std::vector<boost::filesystem::path> &images, std::ostream &output)
+{
+    std::size_t found = 0;
+    std::vector<ProbeResult> results(std::min(images.size(), CHUNK_SIZE));
+
+    for (std::size_t first = 0; first < images.size(); first += CHUNK_SIZE)
+    {
+        const std::size_t count = std::min(images.size() - first, CHUNK_SIZE);
+
+        // An image per task, the time to probe each is dominated by reading its first rows
+        ThreadPool::Instance().ParallelFor(0, count, 1, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; i++)
+            {
+                results[i] = CorpusProbe::Probe(images[first + i]);
+            }
+        });
+
+        for (std::size_t i = 0; i < count; i++)
+        {
+            found += results[i].technique.empty() ? 0 : 1;
+            output << CorpusProbe::Json(results[i]) << "\n";
+        }
+
+        output.flush();
+    }
+
+    return found;
+}
@@ -0,0 +1,207 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+#include "stats.hpp"
+
+std::atomic<bool> Stats::enabled(false);
+
+/**
+ * The accumulated measurements of every stage with the same name.
+ */
+struct StageRecord
+{
+    std::string name;
+    std::size_t calls;
+    std::uint64_t nanoseconds;
+    std::size_t bytes;
+    std::size_t bits;
+    std::uint64_t counters[3];
+};
+
+static std::mutex records_mutex;
+static std::vector<StageRecord> records;
+
+// The names of the hardware counters, and their perf_event_open file descriptors
+static const char *COUNTER_NAMES[3] = {"cycles", "instructions", "cache_misses"};
+static int counter_descriptors[3] = {-1, -1, -1};
+
+/**
+ * Open a hardware counter which counts user space events of this process,
+ * including the threads it creates from now on.
+ *
+ * @return The file descriptor of the counter, -1 when it can't be opened.
+ */
+static int OpenCounter(const std::uint64_t &config)
+{
+#ifdef __linux__
+    struct perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.size = sizeof(attributes);
+    attributes.config = config;
+    attributes.inherit = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+
+    return syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+/**
+ * Read the current value of each open hardware counter.
+ */
+static void ReadCounters(std::uint64_t *values)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        values[i] = 0;
+
+        if (counter_descriptors[i] != -1 && read(counter_descriptors[i], &values[i], sizeof(values[i])) != sizeof(values[i]))
+        {
+            values[i] = 0;
+        }
+    }
+}
+
+void Stats::Enable(const bool &counters)
+{
+    Stats::Disable();
+
+#ifdef __linux__
+    if (counters)
+    {
+        const std::uint64_t configs[3] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+
+        for (int i = 0; i < 3; i++)
+        {
+            counter_descriptors[i] = OpenCounter(configs[i]);
+        }
+    }
+#endif
+
+    Stats::enabled = true;
+}
+
+void Stats::Disable()
+{
+    Stats::enabled = false;
+
+    std::lock_guard<std::mutex> lock(records_mutex);
+    records.clear();
+
+    for (int &descriptor : counter_descriptors)
+    {
+        if (descriptor != -1)
+        {
+            close(descriptor);
+            descriptor = -1;
+        }
+    }
+}
+
+std::string Stats::Json()
+{
+    std::lock_guard<std::mutex> lock(records_mutex);
+    std::ostringstream json;
+
+    json << std::fixed << std::setprecision(6) << "{\"stages\": [";
+
+    for (std::size_t i = 0; i < records.size(); i++)
+    {
+        const StageRecord &record = records[i];
+
+        json << (i ? ", " : "") << "{\"stage\": \"" << record.name << "\", "
+             << "\"calls\": " << record.calls << ", "
+             << "\"seconds\": " << (record.nanoseconds / 1e9) << ", "
+             << "\"bytes\": " << record.bytes << ", "
+             << "\"bits\": " << record.bits;
+
+        for (int counter = 0; counter < 3; counter++)
+        {
+            if (counter_descriptors[counter] != -1)
+            {
+                json << ", \"" << COUNTER_NAMES[counter] << "\": " << record.counters[counter];
+            }
+        }
+
+        json << "}";
+    }
+
+    json << "]}";
+
+    return json.str();
+}
+
+void Stats::Stage::Begin(const char *name)
+{
+    this->name = name;
+    ReadCounters(this->counters);
+    this->start = std::chrono::steady_clock::now();
+}
+
+void Stats::Stage::End()
+{
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    std::uint64_t counters[3];
+    ReadCounters(counters);
+
+    std::lock_guard<std::mutex> lock(records_mutex);
+
+    // Recording was stopped whilst the stage was running
+    if (!Stats::enabled)
+    {
+        return;
+    }
+
+    std::vector<StageRecord>::iterator record = records.begin();
+
+    while (record != records.end() && record->name != this->name)
+    {
+        ++record;
+    }
+
+    if (record == records.end())
+    {
+        records.push_back(StageRecord{this->name, 0, 0, 0, 0, {0, 0, 0}});
+        record = records.end() - 1;
+    }
+
+    record->calls++;
+    record->nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(end - this->start).count();
+    record->bytes += this->bytes;
+    record->bits += this->bits;
+
+    for (int i = 0; i < 3; i++)
+    {
+        record->counters[i] += counters[i] - this->counters[i];
+    }
+}
@@ -16,25 +16,65 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include "steganography.hpp"
+#include "stats.hpp"
 
-std::vector<unsigned char> Steganography::ReadPayload(const boost::filesystem::path &payload_path)
+Steganography::Steganography(const boost::filesystem::path &image_path) : stream_window(0)
 {
-    boost::filesystem::ifstream file(payload_path, std::ios::binary);
-    file.unsetf(std::ios::skipws); // do not skip whitespace
+    this->image_path = image_path;
 
-    std::vector<unsigned char> payload;
-    payload.reserve(boost::filesystem::file_size(payload_path));
-    payload.insert(payload.begin(), std::istream_iterator<unsigned char>(file), std::istream_iterator<unsigned char>());
+    Stats::Stage stage("read");
+    this->image = cv::imread(image_path.string(), cv::IMREAD_UNCHANGED);
+    stage.Count(this->image.total() * this->image.elemSize());
 
-    file.close();
-    return payload;
+    if (!this->image.data)
+    {
+        throw ImageException("Error: Failed to open input image");
+    }
 }
 
-void Steganography::WritePayload(const boost::filesystem::path &payload_path, const std::vector<unsigned char> &payload)
+Steganography::Steganography(const cv::Mat &image) : stream_window(0)
 {
-    boost::filesystem::ofstream file(payload_path, std::ios::binary);
+    this->image = image;
 
-    std::copy(payload.cbegin(), payload.cend(), std::ostream_iterator<unsigned char>(file));
+    if (!this->image.data)
+    {
+        throw ImageException("Error: Failed to open input image");
+    }
+}
+
+Steganography::Steganography(const std::vector<unsigned char> &image_bytes) : stream_window(0)
+{
+    Stats::Stage stage("read");
+
+    if (!image_bytes.empty())
+    {
+        this->image = cv::imdecode(image_bytes, cv::IMREAD_UNCHANGED);
+        stage.Count(this->image.total() * this->image.elemSize());
+    }
+
+    if (!this->image.data)
+    {
+        throw ImageException("Error: Failed to decode input image");
+    }
+}
+
+Steganography::Steganography() : stream_window(0)
+{
+}
+
+std::vector<unsigned char> Steganography::EncodeBuffer(const std::string &payload_filename, const unsigned char *payload,
+        const std::size_t &payload_size)
+{
+    this->Embed(payload_filename, payload, payload_size);
+    return this->EncodeImage();
+}
 
-    file.close();
+void Steganography::SetStreamWindow(const std::size_t &window)
+{
+    this->stream_window = window;
+}
+
+const cv::Mat &Steganography::Image() const
+{
+    return this->image;
 }
@@ -0,0 +1,392 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "striped_steganography.hpp"
+#include "discrete_cosine_transform.hpp"
+#include "least_significant_bit.hpp"
+#include "crc32c.hpp"
+#include "payload.hpp"
+#include "stats.hpp"
+
+/**
+ * A run of bytes which is stored in the bitstream, starting at a bit index. The
+ * container header is stored one bit per slot, the rest of the bitstream in the
+ * configured layout.
+ */
+struct Segment
+{
+    std::size_t start;
+    unsigned char *bytes;
+    std::size_t size;
+    bool header;
+};
+
+/**
+ * Encode/decode the part of a segment which falls within a stripe.
+ *
+ * @param segment The segment.
+ * @param stripe The technique over the stripe, in the layout of the segment.
+ * @param first_bit The index of the stripe's first bit in the layout of the segment.
+ * @param encode Whether to encode rather than decode.
+ * @return Whether the rest of the segment is in the following stripes.
+ */
+static bool ProcessSegment(const Segment &segment, Steganography *stripe, const std::size_t &first_bit, const bool &encode)
+{
+    const std::size_t last_bit = first_bit + stripe->Capacity();
+    const std::size_t begin = std::max(segment.start, first_bit);
+    const std::size_t end = std::min(segment.start + (segment.size * 8), last_bit);
+
+    if (begin < end && encode)
+    {
+        stripe->EncodePayload(begin - first_bit, segment.bytes + ((begin - segment.start) / 8),
+                segment.bytes + ((end - segment.start) / 8));
+    }
+    else if (begin < end)
+    {
+        stripe->DecodePayload(begin - first_bit, segment.bytes + ((begin - segment.start) / 8),
+                segment.bytes + ((end - segment.start) / 8));
+    }
+
+    return segment.start + (segment.size * 8) > last_bit;
+}
+
+StripedSteganography::StripedSteganography(const boost::filesystem::path &image_path, const std::string &technique,
+        const std::size_t &memory_budget) :
+    image_path(image_path), technique(technique), memory_budget(memory_budget), persistence(10), bits_per_sample(1),
+    channels(1), pairs(1), fixed_point(false)
+{
+    if (technique != "lsb" && technique != "dct")
+    {
+        throw ImageException("Error: Only the lsb and dct techniques can be used in stripes");
+    }
+}
+
+void StripedSteganography::SetPersistence(const int &persistence)
+{
+    this->persistence = persistence;
+}
+
+void StripedSteganography::SetBitsPerSample(const int &bits)
+{
+    this->bits_per_sample = bits;
+}
+
+void StripedSteganography::SetLayout(const int &channels, const int &pairs)
+{
+    this->channels = channels;
+    this->pairs = pairs;
+}
+
+void StripedSteganography::SetFixedPoint(const bool &fixed_point)
+{
+    this->fixed_point = fixed_point;
+}
+
+void StripedSteganography::Encode(const boost::filesystem::path &payload_path)
+{
+    StripeReader reader(this->image_path);
+    PayloadReader payload(payload_path);
+
+    std::string payload_filename = payload_path.filename().string();
+    const std::size_t bits_per_slot = this->BitsPerSlot(reader);
+    const bool dct = (this->technique == "dct");
+
+    // The same header as the technique would encode, the resolved number of channels is recorded
+    const ContainerHeader header = {
+        dct ? TECHNIQUE_DCT : TECHNIQUE_LSB, dct ? this->persistence : 0, dct ? 0 : this->bits_per_sample,
+        dct ? (int)bits_per_slot / this->pairs : 0, dct ? this->pairs : 0, 0,
+        payload_filename.size(), payload.Size(), Crc32c(0, payload.Data(), payload.Size())
+    };
+
+    unsigned char header_bytes[HEADER_SIZE];
+    StoreHeader(header, header_bytes);
+
+    // The JPEG output of the DCT technique is 8-bit regardless of the carrier
+    const std::string extension = dct ? ".jpg" : ".png";
+    const int type = dct ? CV_MAKETYPE(CV_8U, CV_MAT_CN(reader.Type())) : reader.Type();
+
+    StripeWriter writer("steg-" + this->image_path.filename().replace_extension(extension).string(), reader.Rows(),
+            reader.Cols(), type);
+    std::vector<Segment> segments;
+
+    this->Process(&reader, &writer, [&](Steganography *header_stripe, const std::size_t &first_slot)
+    {
+        std::unique_ptr<Steganography> stripe = this->Open(header_stripe->Image(), false);
+
+        // The payload start depends on the technique, so the bitstream is laid out once the first stripe is open
+        if (segments.empty())
+        {
+            const std::size_t payload_start = stripe->PayloadStart(payload_filename.size());
+
+            if (payload_start + (payload.Size() * 8) > this->Capacity(reader))
+            {
+                throw EncodeException("Error: Failed to encode payload, carrier too small");
+            }
+
+            segments = {
+                {0, header_bytes, HEADER_SIZE, true},
+                {stripe->PayloadStart(0), reinterpret_cast<unsigned char *>(&payload_filename[0]), payload_filename.size(), false},
+                {payload_start, const_cast<unsigned char *>(payload.Data()), payload.Size(), false},
+            };
+        }
+
+        // Embed the part of each segment which falls within this stripe
+        for (const Segment &segment : segments)
+        {
+            if (segment.header)
+            {
+                ProcessSegment(segment, header_stripe, first_slot, true);
+            }
+            else
+            {
+                ProcessSegment(segment, stripe.get(), first_slot * bits_per_slot, true);
+            }
+        }
+
+        return true;
+    });
+}
+
+void StripedSteganography::Decode()
+{
+    this->DecodeStream(true);
+}
+
+ContainerHeader StripedSteganography::Probe(std::string *payload_filename)
+{
+    return this->DecodeStream(false, payload_filename);
+}
+
+ContainerHeader StripedSteganography::DecodeStream(const bool &decode_payload, std::string *payload_filename)
+{
+    StripeReader reader(this->image_path);
+
+    unsigned char header_bytes[HEADER_SIZE];
+    ContainerHeader header;
+    std::vector<unsigned char> filename_bytes;
+    std::unique_ptr<PayloadWriter> payload;
+    std::size_t bits_per_slot = 0;
+
+    // Each segment is only known once the segments before it have been decoded, the magic is decoded on its
+    // own so that other images are rejected early
+    std::vector<Segment> segments = {{0, header_bytes, MAGIC_SIZE, true}};
+    std::size_t next = 0;
+
+    this->Process(&reader, nullptr, [&](Steganography *header_stripe, const std::size_t &first_slot)
+    {
+        // The stripe in the configured layout is opened once the header has been decoded
+        std::unique_ptr<Steganography> stripe;
+
+        while (next < segments.size())
+        {
+            const Segment segment = segments[next];
+
+            if (!segment.header && !stripe)
+            {
+                stripe = this->Open(header_stripe->Image(), false);
+            }
+
+            const bool more = segment.header ? ProcessSegment(segment, header_stripe, first_slot, false) :
+                ProcessSegment(segment, stripe.get(), first_slot * bits_per_slot, false);
+
+            // The rest of the segment is in the next stripe
+            if (more)
+            {
+                return true;
+            }
+
+            switch (++next)
+            {
+                case 1:
+                    if (!HasMagic(header_bytes))
+                    {
+                        throw DecodeException("Error: Carrier image doesn't contain a payload");
+                    }
+
+                    segments.push_back({MAGIC_SIZE * 8, header_bytes + MAGIC_SIZE, HEADER_SIZE - MAGIC_SIZE, true});
+                    break;
+                case 2:
+                    header = LoadHeader(header_bytes, (this->technique == "dct") ? TECHNIQUE_DCT : TECHNIQUE_LSB);
+
+                    if (header.matrix_bits > 0)
+                    {
+                        throw DecodeException("Error: Matrix embedding can't be decoded a stripe at a time");
+                    }
+
+                    // The rest of the bitstream is decoded with the layout it was encoded with
+                    this->bits_per_sample = header.bits_per_sample;
+                    this->channels = header.channels;
+                    this->pairs = header.pairs;
+                    bits_per_slot = this->BitsPerSlot(reader);
+
+                    stripe = this->Open(header_stripe->Image(), false);
+                    CheckCapacity(header, stripe->PayloadStart(header.filename_length), this->Capacity(reader));
+
+                    filename_bytes.resize(header.filename_length);
+                    segments.push_back({stripe->PayloadStart(0), filename_bytes.data(), filename_bytes.size(), false});
+                    break;
+                case 3:
+                    if (!decode_payload)
+                    {
+                        return false;
+                    }
+
+                    payload.reset(new PayloadWriter("steg-" + std::string(filename_bytes.begin(), filename_bytes.end()),
+                                header.payload_length));
+                    segments.push_back({stripe->PayloadStart(filename_bytes.size()), payload->Data(), payload->Size(), false});
+                    break;
+            }
+        }
+
+        // The whole payload has been decoded, the remaining stripes aren't needed
+        return false;
+    });
+
+    if (next != (decode_payload ? 4u : 3u))
+    {
+        throw DecodeException("Error: Failed to decode payload");
+    }
+
+    if (payload_filename)
+    {
+        payload_filename->assign(filename_bytes.begin(), filename_bytes.end());
+    }
+
+    if (decode_payload)
+    {
+        VerifyPayload(header, Crc32c(0, payload->Data(), payload->Size()));
+        payload->Commit();
+    }
+
+    return header;
+}
+
+std::unique_ptr<Steganography> StripedSteganography::Open(const cv::Mat &stripe, const bool &header) const
+{
+    if (this->technique == "lsb")
+    {
+        LeastSignificantBit *lsb = new LeastSignificantBit(stripe);
+        std::unique_ptr<Steganography> technique(lsb);
+
+        lsb->SetBitsPerSample(header ? 1 : this->bits_per_sample);
+
+        return technique;
+    }
+
+    DiscreteCosineTransform *dct = new DiscreteCosineTransform(stripe, this->persistence);
+    std::unique_ptr<Steganography> technique(dct);
+
+    dct->SetLayout(header ? 1 : this->channels, header ? 1 : this->pairs);
+    dct->SetFixedPoint(this->fixed_point);
+
+    return technique;
+}
+
+std::size_t StripedSteganography::BitsPerSlot(const StripeReader &reader) const
+{
+    if (this->technique == "lsb")
+    {
+        return this->bits_per_sample;
+    }
+
+    return DiscreteCosineTransform::LayoutChannels(CV_MAT_CN(reader.Type()), this->channels) * this->pairs;
+}
+
+std::size_t StripedSteganography::Capacity(const StripeReader &reader) const
+{
+    if (this->technique == "lsb")
+    {
+        return LeastSignificantBit::LayoutCapacity(reader.Rows(), reader.Cols(), CV_MAT_CN(reader.Type()), this->bits_per_sample);
+    }
+
+    return DiscreteCosineTransform::LayoutCapacity(reader.Rows(), reader.Cols(), (int)this->BitsPerSlot(reader) / this->pairs,
+            this->pairs);
+}
+
+void StripedSteganography::Process(StripeReader *reader, StripeWriter *writer,
+        const std::function<bool(Steganography *, const std::size_t &)> &function)
+{
+    // A stripe of the DCT technique also holds the first row of blocks of the next stripe
+    const bool dct = (this->technique == "dct");
+    const int alignment = dct ? 64 : 8;
+    const int overlap = dct ? 8 : 0;
+
+    // The DCT technique needs 8-bit samples, so deeper samples are converted as they're read
+    const int depth = CV_MAT_DEPTH(reader->Type());
+    const bool convert = dct && depth != CV_8U;
+    const std::size_t row_bytes = (std::size_t)reader->Cols() * (CV_ELEM_SIZE(reader->Type()) + (convert ? CV_MAT_CN(reader->Type()) : 0));
+
+    const std::size_t budget_rows = this->memory_budget / std::max(row_bytes, (std::size_t)1);
+    const std::size_t aligned_rows = (budget_rows > (std::size_t)overlap) ? ((budget_rows - overlap) / alignment) * alignment : 0;
+    const std::size_t image_rows = ((reader->Rows() + alignment - 1) / alignment) * alignment;
+    const int stripe_rows = (int)std::min(image_rows, std::max(aligned_rows, (std::size_t)alignment));
+
+    cv::Mat input(stripe_rows + overlap, reader->Cols(), reader->Type());
+    cv::Mat buffer = convert ? cv::Mat(input.rows, input.cols, CV_MAKETYPE(CV_8U, input.channels())) : input;
+
+    std::size_t first_slot = 0;
+
+    // The rows held at the top of the buffer, carried over from the previous stripe
+    for (int row = 0, buffered = 0; row < reader->Rows(); )
+    {
+        {
+            Stats::Stage stage("read");
+            cv::Mat rows = input.rowRange(buffered, input.rows);
+            const int count = reader->Read(&rows);
+
+            if (convert)
+            {
+                cv::Mat converted = buffer.rowRange(buffered, buffered + count);
+                input.rowRange(buffered, buffered + count).convertTo(converted, CV_8U);
+            }
+
+            buffered += count;
+            stage.Count(count * row_bytes);
+        }
+
+        // The final stripe is every remaining row, otherwise the overlap is left for the next stripe
+        const bool last = (row + buffered == reader->Rows());
+        const int rows = last ? buffered : stripe_rows;
+
+        // Opened in the layout of the header, so its capacity is its number of slots
+        std::unique_ptr<Steganography> stripe = this->Open(buffer.rowRange(0, dct ? buffered : rows), true);
+        const bool more = function(stripe.get(), first_slot);
+        first_slot += stripe->Capacity();
+
+        if (writer)
+        {
+            Stats::Stage stage("write", rows * buffer.cols * buffer.elemSize());
+            writer->Write(buffer.rowRange(0, rows));
+        }
+        else if (!more)
+        {
+            return;
+        }
+
+        if (buffered > rows)
+        {
+            cv::Mat carried = buffer.rowRange(0, buffered - rows);
+            buffer.rowRange(rows, buffered).copyTo(carried);
+        }
+
+        row += rows;
+        buffered -= rows;
+    }
+}
@@ -0,0 +1,769 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <jpeglib.h>
+#include <png.h>
+#include <tiffio.h>
+#include <zlib.h>
+#include "stripes.hpp"
+
+/**
+ * A libjpeg error manager which jumps back to the caller rather than exiting.
+ */
+struct JpegError
+{
+    jpeg_error_mgr manager;
+    jmp_buf jump;
+};
+
+static void JpegErrorExit(j_common_ptr info)
+{
+    longjmp(reinterpret_cast<JpegError *>(info->err)->jump, 1);
+}
+
+static void PngErrorExit(png_structp png, png_const_charp)
+{
+    png_longjmp(png, 1);
+}
+
+static void PngWarning(png_structp, png_const_charp)
+{
+}
+
+/**
+ * @return Whether 16-bit samples are stored least significant byte first.
+ */
+static bool LittleEndian()
+{
+    const uint16_t sample = 1;
+    return *reinterpret_cast<const unsigned char *>(&sample) == 1;
+}
+
+/**
+ * Read the header of a PNG, and set up the transformations which give the same
+ * layout as cv::imread. This holds no C++ objects on its stack, so libpng may
+ * jump out of it.
+ *
+ * @return Whether the header was read.
+ */
+static bool ReadPngHeader(png_structp png, png_infop info, FILE *file, png_uint_32 *width, png_uint_32 *height,
+        int *channels, int *depth, int *interlace)
+{
+    if (setjmp(png_jmpbuf(png)))
+    {
+        return false;
+    }
+
+    png_init_io(png, file);
+    png_read_info(png, info);
+
+    int color_type;
+    png_get_IHDR(png, info, width, height, depth, &color_type, interlace, nullptr, nullptr);
+
+    // Palettes, low bit depths and transparency are expanded, grayscale with alpha becomes BGRA
+    if (color_type == PNG_COLOR_TYPE_PALETTE)
+    {
+        png_set_palette_to_rgb(png);
+    }
+
+    if (color_type == PNG_COLOR_TYPE_GRAY && *depth < 8)
+    {
+        png_set_expand_gray_1_2_4_to_8(png);
+    }
+
+    if (png_get_valid(png, info, PNG_INFO_tRNS))
+    {
+        png_set_tRNS_to_alpha(png);
+    }
+
+    if (color_type == PNG_COLOR_TYPE_GRAY_ALPHA || (color_type == PNG_COLOR_TYPE_GRAY && png_get_valid(png, info, PNG_INFO_tRNS)))
+    {
+        png_set_gray_to_rgb(png);
+    }
+
+    if (*depth == 16 && LittleEndian())
+    {
+        png_set_swap(png);
+    }
+
+    png_set_bgr(png);
+    png_read_update_info(png, info);
+
+    *channels = png_get_channels(png, info);
+    *depth = png_get_bit_depth(png, info);
+
+    return true;
+}
+
+/**
+ * Read rows of a PNG. This holds no C++ objects on its stack, so libpng may jump
+ * out of it.
+ *
+ * @return Whether the rows were read.
+ */
+static bool ReadPngRows(png_structp png, unsigned char **rows, int count)
+{
+    if (setjmp(png_jmpbuf(png)))
+    {
+        return false;
+    }
+
+    for (int row = 0; row < count; row++)
+    {
+        png_read_row(png, rows[row], nullptr);
+    }
+
+    return true;
+}
+
+/**
+ * Read the header of a JPEG, and start decompressing it to RGB or grayscale
+ * scanlines. This holds no C++ objects on its stack, so libjpeg may jump out of
+ * it.
+ *
+ * @return Whether the header was read.
+ */
+static bool ReadJpegHeader(jpeg_decompress_struct *decompress, JpegError *error, FILE *file)
+{
+    if (setjmp(error->jump))
+    {
+        return false;
+    }
+
+    jpeg_stdio_src(decompress, file);
+    jpeg_read_header(decompress, TRUE);
+
+    // CMYK images can't be converted to RGB by libjpeg
+    if (decompress->num_components != 1 && decompress->num_components != 3)
+    {
+        return false;
+    }
+
+    decompress->out_color_space = (decompress->num_components == 1) ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_start_decompress(decompress);
+
+    return true;
+}
+
+/**
+ * Read scanlines of a JPEG. This holds no C++ objects on its stack, so libjpeg
+ * may jump out of it.
+ *
+ * @return Whether the scanlines were read.
+ */
+static bool ReadJpegRows(jpeg_decompress_struct *decompress, JpegError *error, unsigned char **rows, int count)
+{
+    if (setjmp(error->jump))
+    {
+        return false;
+    }
+
+    for (int row = 0; row < count; row++)
+    {
+        jpeg_read_scanlines(decompress, &rows[row], 1);
+    }
+
+    return true;
+}
+
+/**
+ * Read the header of a TIFF, only unsigned 8 and 16-bit grayscale, RGB and RGBA
+ * images with their channels interleaved are read in stripes.
+ *
+ * @return Whether the image can be read in stripes.
+ */
+static bool ReadTiffHeader(TIFF *tiff, uint32_t *width, uint32_t *height, int *channels, int *depth)
+{
+    uint16_t bits, samples, planar, format, photometric;
+
+    if (!TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, width) || !TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, height)
+            || !TIFFGetField(tiff, TIFFTAG_PHOTOMETRIC, &photometric))
+    {
+        return false;
+    }
+
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_BITSPERSAMPLE, &bits);
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLESPERPIXEL, &samples);
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_PLANARCONFIG, &planar);
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLEFORMAT, &format);
+
+    if ((bits != 8 && bits != 16) || format != SAMPLEFORMAT_UINT || planar != PLANARCONFIG_CONTIG)
+    {
+        return false;
+    }
+
+    if ((photometric != PHOTOMETRIC_MINISBLACK || samples != 1) && (photometric != PHOTOMETRIC_RGB || (samples != 3 && samples != 4)))
+    {
+        return false;
+    }
+
+    *channels = samples;
+    *depth = bits;
+
+    return *width > 0 && *height > 0 && *width <= INT32_MAX && *height <= INT32_MAX;
+}
+
+/**
+ * Swap the rows of a TIFF from RGB(A) to BGR(A) in place.
+ */
+template <typename Sample>
+static void SwapRedBlue(unsigned char *row, const int &cols, const int &channels)
+{
+    for (Sample *pixel = reinterpret_cast<Sample *>(row), *end = pixel + ((std::size_t)cols * channels); pixel != end; pixel += channels)
+    {
+        std::swap(pixel[0], pixel[2]);
+    }
+}
+
+/**
+ * Write the header of a PNG. This holds no C++ objects on its stack, so libpng
+ * may jump out of it.
+ *
+ * @return Whether the header was written.
+ */
+static bool WritePngHeader(png_structp png, png_infop info, FILE *file, png_uint_32 width, png_uint_32 height,
+        int depth, int color_type)
+{
+    if (setjmp(png_jmpbuf(png)))
+    {
+        return false;
+    }
+
+    png_init_io(png, file);
+    png_set_IHDR(png, info, width, height, depth, color_type, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+            PNG_FILTER_TYPE_DEFAULT);
+    png_set_compression_strategy(png, Z_HUFFMAN_ONLY);
+    png_write_info(png, info);
+
+    if (depth == 16 && LittleEndian())
+    {
+        png_set_swap(png);
+    }
+
+    png_set_bgr(png);
+
+    return true;
+}
+
+/**
+ * Write rows of a PNG, and finish the PNG after its final row. This holds no C++
+ * objects on its stack, so libpng may jump out of it.
+ *
+ * @return Whether the rows were written.
+ */
+static bool WritePngRows(png_structp png, png_infop info, unsigned char **rows, int count, bool finish)
+{
+    if (setjmp(png_jmpbuf(png)))
+    {
+        return false;
+    }
+
+    for (int row = 0; row < count; row++)
+    {
+        png_write_row(png, rows[row]);
+    }
+
+    if (finish)
+    {
+        png_write_end(png, info);
+    }
+
+    return true;
+}
+
+/**
+ * Write the header of a JPEG at quality 100. This holds no C++ objects on its
+ * stack, so libjpeg may jump out of it.
+ *
+ * @return Whether the header was written.
+ */
+static bool WriteJpegHeader(jpeg_compress_struct *compress, JpegError *error, FILE *file, JDIMENSION width,
+        JDIMENSION height, int components)
+{
+    if (setjmp(error->jump))
+    {
+        return false;
+    }
+
+    jpeg_stdio_dest(compress, file);
+
+    compress->image_width = width;
+    compress->image_height = height;
+    compress->input_components = components;
+    compress->in_color_space = (components == 1) ? JCS_GRAYSCALE : JCS_RGB;
+
+    jpeg_set_defaults(compress);
+    jpeg_set_quality(compress, 100, TRUE);
+    jpeg_start_compress(compress, TRUE);
+
+    return true;
+}
+
+/**
+ * Write scanlines of a JPEG, and finish the JPEG after its final scanline. This
+ * holds no C++ objects on its stack, so libjpeg may jump out of it.
+ *
+ * @return Whether the scanlines were written.
+ */
+static bool WriteJpegRows(jpeg_compress_struct *compress, JpegError *error, unsigned char **rows, int count, bool finish)
+{
+    if (setjmp(error->jump))
+    {
+        return false;
+    }
+
+    jpeg_write_scanlines(compress, rows, count);
+
+    if (finish)
+    {
+        jpeg_finish_compress(compress);
+    }
+
+    return true;
+}
+
+struct StripeReader::Decoder
+{
+    FILE *file;
+    bool jpeg;
+    png_structp png;
+    png_infop info;
+    jpeg_decompress_struct decompress;
+    JpegError error;
+    TIFF *tiff;
+    uint32_t tile_width;
+    uint32_t tile_length;
+    std::vector<unsigned char> tile;
+    std::vector<unsigned char> band;
+    int band_row;
+    int rows;
+    int cols;
+    int type;
+    int row;
+
+    Decoder() : file(nullptr), jpeg(false), png(nullptr), info(nullptr), tiff(nullptr), tile_width(0), tile_length(0),
+        band_row(-1), rows(0), cols(0), type(0), row(0)
+    {
+        this->decompress.err = jpeg_std_error(&this->error.manager);
+        this->error.manager.error_exit = JpegErrorExit;
+        jpeg_create_decompress(&this->decompress);
+    }
+
+    ~Decoder()
+    {
+        if (this->png)
+        {
+            png_destroy_read_struct(&this->png, &this->info, nullptr);
+        }
+
+        jpeg_destroy_decompress(&this->decompress);
+
+        if (this->tiff)
+        {
+            TIFFClose(this->tiff);
+        }
+
+        if (this->file)
+        {
+            std::fclose(this->file);
+        }
+    }
+
+    /**
+     * Read the row of tiles holding an image row into the band, unless it's
+     * already held.
+     *
+     * @return Whether the tiles were read.
+     */
+    bool ReadTiles(const int &image_row)
+    {
+        const int band_row = image_row - (image_row % this->tile_length);
+
+        if (band_row == this->band_row)
+        {
+            return true;
+        }
+
+        const std::size_t pixel_size = CV_ELEM_SIZE(this->type);
+        const std::size_t band_step = (std::size_t)this->cols * pixel_size;
+        const int band_rows = std::min((int)this->tile_length, this->rows - band_row);
+
+        for (uint32_t col = 0; col < (uint32_t)this->cols; col += this->tile_width)
+        {
+            if (TIFFReadTile(this->tiff, this->tile.data(), col, band_row, 0, 0) < 0)
+            {
+                return false;
+            }
+
+            // Tiles on the right and bottom edges are padded past the image
+            const std::size_t width = std::min(this->tile_width, (uint32_t)this->cols - col) * pixel_size;
+
+            for (int row = 0; row < band_rows; row++)
+            {
+                std::copy(this->tile.begin() + (row * this->tile_width * pixel_size),
+                        this->tile.begin() + (row * this->tile_width * pixel_size) + width,
+                        this->band.begin() + (row * band_step) + (col * pixel_size));
+            }
+        }
+
+        this->band_row = band_row;
+
+        return true;
+    }
+};
+
+StripeReader::StripeReader(const boost::filesystem::path &image_path) : decoder(new Decoder())
+{
+    this->decoder->file = std::fopen(image_path.string().c_str(), "rb");
+    unsigned char signature[8];
+
+    if (!this->decoder->file || std::fread(signature, 1, 8, this->decoder->file) != 8)
+    {
+        throw ImageException("Error: Failed to open input image");
+    }
+
+    std::rewind(this->decoder->file);
+
+    if (png_sig_cmp(signature, 0, 8) == 0)
+    {
+        png_uint_32 width, height;
+        int channels, depth, interlace;
+
+        this->decoder->png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, PngErrorExit, PngWarning);
+        this->decoder->info = png_create_info_struct(this->decoder->png);
+
+        if (!ReadPngHeader(this->decoder->png, this->decoder->info, this->decoder->file, &width, &height, &channels, &depth,
+                    &interlace))
+        {
+            throw ImageException("Error: Failed to open input image");
+        }
+
+        // Each pass of an interlaced PNG covers the whole image, so it can't be read a few rows at a time
+        if (interlace != PNG_INTERLACE_NONE)
+        {
+            throw ImageException("Error: Interlaced images can't be read in stripes");
+        }
+
+        this->decoder->rows = height;
+        this->decoder->cols = width;
+        this->decoder->type = CV_MAKETYPE(depth == 16 ? CV_16U : CV_8U, channels);
+    }
+    else if (signature[0] == 0xFF && signature[1] == 0xD8)
+    {
+        if (!ReadJpegHeader(&this->decoder->decompress, &this->decoder->error, this->decoder->file))
+        {
+            throw ImageException("Error: Failed to open input image");
+        }
+
+        this->decoder->jpeg = true;
+        this->decoder->rows = this->decoder->decompress.output_height;
+        this->decoder->cols = this->decoder->decompress.output_width;
+        this->decoder->type = CV_MAKETYPE(CV_8U, this->decoder->decompress.output_components);
+    }
+    else if ((signature[0] == 'I' && signature[1] == 'I') || (signature[0] == 'M' && signature[1] == 'M'))
+    {
+        // libtiff reads the image through its own descriptor
+        std::fclose(this->decoder->file);
+        this->decoder->file = nullptr;
+        this->decoder->tiff = TIFFOpen(image_path.string().c_str(), "r");
+
+        uint32_t width, height;
+        int channels, depth;
+
+        if (!this->decoder->tiff || !ReadTiffHeader(this->decoder->tiff, &width, &height, &channels, &depth))
+        {
+            throw ImageException("Error: Only 8 and 16-bit grayscale, RGB and RGBA TIFF images can be read in stripes");
+        }
+
+        this->decoder->rows = height;
+        this->decoder->cols = width;
+        this->decoder->type = CV_MAKETYPE(depth == 16 ? CV_16U : CV_8U, channels);
+
+        // A tiled image is read a row of tiles at a time, which are held until each of their rows has been read
+        if (TIFFIsTiled(this->decoder->tiff))
+        {
+            if (!TIFFGetField(this->decoder->tiff, TIFFTAG_TILEWIDTH, &this->decoder->tile_width)
+                    || !TIFFGetField(this->decoder->tiff, TIFFTAG_TILELENGTH, &this->decoder->tile_length)
+                    || this->decoder->tile_width == 0 || this->decoder->tile_length == 0
+                    || TIFFTileSize(this->decoder->tiff) != (tmsize_t)this->decoder->tile_width * this->decoder->tile_length * CV_ELEM_SIZE(this->decoder->type))
+            {
+                throw ImageException("Error: Failed to open input image");
+            }
+
+            this->decoder->tile.resize(TIFFTileSize(this->decoder->tiff));
+            this->decoder->band.resize((std::size_t)this->decoder->tile_length * width * CV_ELEM_SIZE(this->decoder->type));
+        }
+        else if (TIFFScanlineSize(this->decoder->tiff) != (tmsize_t)width * CV_ELEM_SIZE(this->decoder->type))
+        {
+            throw ImageException("Error: Failed to open input image");
+        }
+    }
+    else
+    {
+        throw ImageException("Error: Only PNG, JPEG and TIFF images can be read in stripes");
+    }
+}
+
+StripeReader::~StripeReader() = default;
+
+int StripeReader::Rows() const
+{
+    return this->decoder->rows;
+}
+
+int StripeReader::Cols() const
+{
+    return this->decoder->cols;
+}
+
+int StripeReader::Type() const
+{
+    return this->decoder->type;
+}
+
+int StripeReader::Read(cv::Mat *rows)
+{
+    const int count = std::min(rows->rows, this->decoder->rows - this->decoder->row);
+    std::vector<unsigned char *> pointers(count);
+
+    for (int row = 0; row < count; row++)
+    {
+        pointers[row] = rows->ptr(row);
+    }
+
+    if (this->decoder->jpeg)
+    {
+        if (!ReadJpegRows(&this->decoder->decompress, &this->decoder->error, pointers.data(), count))
+        {
+            throw ImageException("Error: Failed to read input image");
+        }
+
+        // libjpeg gives RGB scanlines, swap them to BGR in place
+        if (rows->channels() == 3)
+        {
+            for (int row = 0; row < count; row++)
+            {
+                for (unsigned char *pixel = pointers[row], *end = pixel + (rows->cols * 3); pixel != end; pixel += 3)
+                {
+                    std::swap(pixel[0], pixel[2]);
+                }
+            }
+        }
+    }
+    else if (this->decoder->tiff)
+    {
+        const std::size_t row_size = (std::size_t)rows->cols * rows->elemSize();
+
+        for (int row = 0; row < count; row++)
+        {
+            const int image_row = this->decoder->row + row;
+
+            if (this->decoder->tile_length > 0)
+            {
+                if (!this->decoder->ReadTiles(image_row))
+                {
+                    throw ImageException("Error: Failed to read input image");
+                }
+
+                const std::size_t offset = (image_row - this->decoder->band_row) * row_size;
+                std::copy(this->decoder->band.begin() + offset, this->decoder->band.begin() + offset + row_size, pointers[row]);
+            }
+            else if (TIFFReadScanline(this->decoder->tiff, pointers[row], image_row, 0) < 0)
+            {
+                throw ImageException("Error: Failed to read input image");
+            }
+
+            // libtiff gives RGB(A) rows, swap them to BGR(A) in place
+            if (rows->channels() >= 3 && rows->depth() == CV_16U)
+            {
+                SwapRedBlue<uint16_t>(pointers[row], rows->cols, rows->channels());
+            }
+            else if (rows->channels() >= 3)
+            {
+                SwapRedBlue<unsigned char>(pointers[row], rows->cols, rows->channels());
+            }
+        }
+    }
+    else if (!ReadPngRows(this->decoder->png, pointers.data(), count))
+    {
+        throw ImageException("Error: Failed to read input image");
+    }
+
+    this->decoder->row += count;
+
+    return count;
+}
+
+struct StripeWriter::Encoder
+{
+    boost::filesystem::path image_path;
+    FILE *file;
+    bool jpeg;
+    png_structp png;
+    png_infop info;
+    jpeg_compress_struct compress;
+    JpegError error;
+    int rows;
+    int row;
+    int components;
+    std::vector<unsigned char> scanlines;
+
+    Encoder() : file(nullptr), jpeg(false), png(nullptr), info(nullptr), rows(0), row(0), components(0)
+    {
+        this->compress.err = jpeg_std_error(&this->error.manager);
+        this->error.manager.error_exit = JpegErrorExit;
+        jpeg_create_compress(&this->compress);
+    }
+
+    ~Encoder()
+    {
+        if (this->png)
+        {
+            png_destroy_write_struct(&this->png, &this->info);
+        }
+
+        jpeg_destroy_compress(&this->compress);
+
+        if (this->file)
+        {
+            std::fclose(this->file);
+
+            // A partially written image is never left behind
+            if (this->row != this->rows)
+            {
+                boost::system::error_code error;
+                boost::filesystem::remove(this->image_path, error);
+            }
+        }
+    }
+};
+
+StripeWriter::StripeWriter(const boost::filesystem::path &image_path, const int &rows, const int &cols, const int &type) :
+    encoder(new Encoder())
+{
+    this->encoder->image_path = image_path;
+    this->encoder->rows = rows;
+    this->encoder->jpeg = (image_path.extension() == ".jpg" || image_path.extension() == ".jpeg");
+
+    const int channels = CV_MAT_CN(type);
+    const int depth = CV_MAT_DEPTH(type);
+
+    if ((depth != CV_8U && depth != CV_16U) || (this->encoder->jpeg && depth != CV_8U))
+    {
+        throw ImageException("Error: Failed to write output image, unsupported sample depth");
+    }
+
+    this->encoder->file = std::fopen(image_path.string().c_str(), "wb");
+
+    if (!this->encoder->file)
+    {
+        throw ImageException("Error: Failed to write output image");
+    }
+
+    if (this->encoder->jpeg)
+    {
+        // Only the colour channels are kept, the alpha channel is dropped
+        this->encoder->components = (channels < 3) ? 1 : 3;
+        this->encoder->scanlines.resize((std::size_t)cols * this->encoder->components);
+
+        if (!WriteJpegHeader(&this->encoder->compress, &this->encoder->error, this->encoder->file, cols, rows,
+                    this->encoder->components))
+        {
+            throw ImageException("Error: Failed to write output image");
+        }
+    }
+    else
+    {
+        const int color_types[] = {PNG_COLOR_TYPE_GRAY, PNG_COLOR_TYPE_GRAY_ALPHA, PNG_COLOR_TYPE_RGB, PNG_COLOR_TYPE_RGB_ALPHA};
+
+        this->encoder->png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, PngErrorExit, PngWarning);
+        this->encoder->info = png_create_info_struct(this->encoder->png);
+
+        if (!WritePngHeader(this->encoder->png, this->encoder->info, this->encoder->file, cols, rows,
+                    depth == CV_16U ? 16 : 8, color_types[channels - 1]))
+        {
+            throw ImageException("Error: Failed to write output image");
+        }
+    }
+}
+
+StripeWriter::~StripeWriter() = default;
+
+void StripeWriter::Write(const cv::Mat &rows)
+{
+    const int count = std::min(rows.rows, this->encoder->rows - this->encoder->row);
+    const bool finish = (this->encoder->row + count == this->encoder->rows);
+    bool written = true;
+
+    if (this->encoder->jpeg)
+    {
+        unsigned char *scanline = this->encoder->scanlines.data();
+
+        // libjpeg takes RGB scanlines, each row is converted from BGR(A) as it's written
+        for (int row = 0; row < count && written; row++)
+        {
+            const unsigned char *pixel = rows.ptr(row);
+
+            if (this->encoder->components == 1)
+            {
+                for (int col = 0; col < rows.cols; col++, pixel += rows.channels())
+                {
+                    scanline[col] = pixel[0];
+                }
+            }
+            else
+            {
+                for (int col = 0; col < rows.cols; col++, pixel += rows.channels())
+                {
+                    scanline[(col * 3) + 0] = pixel[2];
+                    scanline[(col * 3) + 1] = pixel[1];
+                    scanline[(col * 3) + 2] = pixel[0];
+                }
+            }
+
+            written = WriteJpegRows(&this->encoder->compress, &this->encoder->error, &scanline, 1, finish && row == count - 1);
+        }
+    }
+    else
+    {
+        std::vector<unsigned char *> pointers(count);
+
+        for (int row = 0; row < count; row++)
+        {
+            pointers[row] = const_cast<unsigned char *>(rows.ptr(row));
+        }
+
+        written = WritePngRows(this->encoder->png, this->encoder->info, pointers.data(), count, finish);
+    }
+
+    if (!written)
+    {
+        throw ImageException("Error: Failed to write output image");
+    }
+
+    if (finish && std::fflush(this->encoder->file) != 0)
+    {
+        throw ImageException("Error: Failed to write output image");
+    }
+
+    this->encoder->row += count;
+}
@@ -0,0 +1,232 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <algorithm>
+#include <exception>
+#include "thread_pool.hpp"
+
+static std::mutex instance_mutex;
+static std::unique_ptr<ThreadPool> instance;
+
+/**
+ * The completion state of a single call to ParallelFor.
+ */
+struct Batch
+{
+    std::size_t remaining;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable done;
+};
+
+ThreadPool::ThreadPool(unsigned int threads) : pending(0), stopping(false)
+{
+    // The thread submitting the work also processes it
+    for (unsigned int i = 1; i < threads; i++)
+    {
+        this->queues.emplace_back(new Queue());
+    }
+
+    for (std::size_t i = 0; i < this->queues.size(); i++)
+    {
+        this->workers.push_back(std::thread(&ThreadPool::Work, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+
+    this->condition.notify_all();
+
+    for (std::thread &thr : this->workers)
+    {
+        thr.join();
+    }
+}
+
+ThreadPool &ThreadPool::Instance()
+{
+    std::lock_guard<std::mutex> lock(instance_mutex);
+
+    if (!instance)
+    {
+        instance.reset(new ThreadPool(std::max(std::thread::hardware_concurrency(), 1U)));
+    }
+
+    return *instance;
+}
+
+void ThreadPool::SetThreads(unsigned int threads)
+{
+    if (threads == 0)
+    {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+
+    std::lock_guard<std::mutex> lock(instance_mutex);
+    instance.reset(new ThreadPool(threads));
+}
+
+unsigned int ThreadPool::Threads() const
+{
+    return this->workers.size() + 1;
+}
+
+void ThreadPool::ParallelFor(std::size_t begin, std::size_t end, std::size_t grain,
+        const std::function<void(std::size_t, std::size_t)> &function)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+
+    grain = std::max(grain, (std::size_t)1);
+    const std::size_t tasks = (end - begin + grain - 1) / grain;
+
+    // There is nothing to gain from queueing the work, process it on this thread
+    if (tasks == 1 || this->queues.empty())
+    {
+        for (std::size_t first = begin; first < end; first += grain)
+        {
+            function(first, std::min(first + grain, end));
+        }
+
+        return;
+    }
+
+    Batch batch;
+    batch.remaining = tasks;
+
+    this->pending += tasks;
+
+    // Give each worker a contiguous run of tasks, idle workers steal from the back of these runs
+    for (std::size_t index = 0; index < this->queues.size(); index++)
+    {
+        Queue &queue = *this->queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        for (std::size_t task = (index * tasks) / this->queues.size(); task < ((index + 1) * tasks) / this->queues.size(); task++)
+        {
+            const std::size_t first = begin + (task * grain);
+            const std::size_t last = std::min(first + grain, end);
+
+            queue.tasks.push_back([&batch, &function, first, last]()
+            {
+                try
+                {
+                    function(first, last);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(batch.mutex);
+
+                    if (!batch.error)
+                    {
+                        batch.error = std::current_exception();
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(batch.mutex);
+
+                if (--batch.remaining == 0)
+                {
+                    batch.done.notify_all();
+                }
+            });
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+    }
+
+    this->condition.notify_all();
+
+    // Help to process the queued tasks, then wait for those still running on the workers
+    while (this->RunTask(0))
+    {
+    }
+
+    std::unique_lock<std::mutex> lock(batch.mutex);
+    batch.done.wait(lock, [&batch]() { return batch.remaining == 0; });
+
+    if (batch.error)
+    {
+        std::rethrow_exception(batch.error);
+    }
+}
+
+void ThreadPool::Work(std::size_t index)
+{
+    while (true)
+    {
+        if (this->RunTask(index))
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->condition.wait(lock, [this]() { return this->stopping || this->pending > 0; });
+
+        if (this->stopping)
+        {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::RunTask(std::size_t index)
+{
+    std::function<void()> task;
+
+    for (std::size_t i = 0; i < this->queues.size() && !task; i++)
+    {
+        Queue &queue = *this->queues[(index + i) % this->queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.tasks.empty())
+        {
+            continue;
+        }
+
+        // Take our own work from the front, steal other's work from the back
+        if (i == 0)
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        else
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+    }
+
+    if (!task)
+    {
+        return false;
+    }
+
+    this->pending--;
+    task();
+
+    return true;
+}
@@ -0,0 +1,152 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "tracer.hpp"
+
+std::atomic<bool> Tracer::enabled(false);
+
+/**
+ * A single recorded span.
+ */
+struct TraceEvent
+{
+    const char *name;
+    std::int64_t start;
+    std::int64_t duration;
+    std::size_t start_bit;
+    std::size_t bytes;
+    std::size_t blocks;
+};
+
+/**
+ * The ring buffer of spans recorded by a single thread. Only the owning thread
+ * writes to the ring, the spans are read once the work has completed.
+ */
+struct TraceRing
+{
+    int thread;
+    std::vector<TraceEvent> events;
+    std::atomic<std::size_t> head;
+};
+
+static std::mutex rings_mutex;
+static std::vector<std::unique_ptr<TraceRing>> rings;
+static std::size_t ring_capacity = 0;
+static std::chrono::steady_clock::time_point epoch;
+
+// The ring owned by the current thread, created the first time it records a span
+static thread_local TraceRing *thread_ring = nullptr;
+
+/**
+ * @return The ring owned by the current thread.
+ */
+static TraceRing *ThreadRing()
+{
+    if (!thread_ring)
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+
+        rings.emplace_back(new TraceRing());
+        thread_ring = rings.back().get();
+        thread_ring->thread = rings.size();
+        thread_ring->events.resize(ring_capacity);
+        thread_ring->head = 0;
+    }
+
+    return thread_ring;
+}
+
+void Tracer::Enable(const std::size_t &capacity)
+{
+    std::lock_guard<std::mutex> lock(rings_mutex);
+
+    ring_capacity = std::max(capacity, (std::size_t)1);
+    epoch = std::chrono::steady_clock::now();
+
+    // Rings are never freed as their threads may still hold them, empty them instead
+    for (std::unique_ptr<TraceRing> &ring : rings)
+    {
+        ring->events.assign(ring_capacity, TraceEvent());
+        ring->head = 0;
+    }
+
+    Tracer::enabled = true;
+}
+
+void Tracer::Disable()
+{
+    Tracer::enabled = false;
+}
+
+void Tracer::Write(std::ostream &output)
+{
+    std::lock_guard<std::mutex> lock(rings_mutex);
+
+    // The timestamps are in microseconds, keep their nanoseconds
+    output << std::fixed << std::setprecision(3);
+    output << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [" << std::endl;
+
+    bool first = true;
+
+    for (const std::unique_ptr<TraceRing> &ring : rings)
+    {
+        const std::size_t head = ring->head.load(std::memory_order_acquire);
+        const std::size_t size = ring->events.size();
+
+        // Name the thread's track
+        output << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << ring->thread
+               << ", \"args\": {\"name\": \"thread " << ring->thread << "\"}}";
+        first = false;
+
+        // Once the ring has wrapped only the newest spans remain
+        for (std::size_t i = (head > size) ? head - size : 0; i < head; i++)
+        {
+            const TraceEvent &event = ring->events[i % size];
+
+            output << ",\n{\"name\": \"" << event.name << "\", \"cat\": \"chunk\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << ring->thread
+                   << ", \"ts\": " << (event.start / 1000.0) << ", \"dur\": " << (event.duration / 1000.0)
+                   << ", \"args\": {\"start_bit\": " << event.start_bit << ", \"bytes\": " << event.bytes
+                   << ", \"blocks\": " << event.blocks << "}}";
+        }
+    }
+
+    output << std::endl << "]}" << std::endl;
+}
+
+void Tracer::Span::End()
+{
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    TraceRing *ring = ThreadRing();
+    const std::size_t head = ring->head.load(std::memory_order_relaxed);
+
+    TraceEvent &event = ring->events[head % ring->events.size()];
+    event.name = this->name;
+    event.start = std::chrono::duration_cast<std::chrono::nanoseconds>(this->start - epoch).count();
+    event.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - this->start).count();
+    event.start_bit = this->start_bit;
+    event.bytes = this->bytes;
+    event.blocks = this->blocks;
+
+    // Publish the span to the thread writing the trace
+    ring->head.store(head + 1, std::memory_order_release);
+}
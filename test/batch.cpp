@@ -0,0 +1,144 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+#include "batch.hpp"
+#include "bounded_queue.hpp"
+#include "least_significant_bit.hpp"
+#include "discrete_cosine_transform.hpp"
+#include "exceptions.hpp"
+
+TEST_CASE("Pass items between threads using a bounded queue", "[BoundedQueue]")
+{
+    BoundedQueue<std::unique_ptr<int>> queue(2);
+
+    // The producer blocks whilst the queue is full
+    std::thread producer([&queue]()
+    {
+        for (int i = 0; i < 100; i++)
+        {
+            queue.Push(std::unique_ptr<int>(new int(i)));
+        }
+
+        queue.Close();
+    });
+
+    std::vector<int> popped;
+    std::unique_ptr<int> item;
+
+    while (queue.Pop(&item))
+    {
+        popped.push_back(*item);
+    }
+
+    producer.join();
+
+    REQUIRE(popped.size() == 100);
+    REQUIRE(popped.front() == 0);
+    REQUIRE(popped.back() == 99);
+    REQUIRE(!queue.Push(std::unique_ptr<int>(new int(100))));
+}
+
+TEST_CASE("Read a manifest of jobs", "[BatchEncoder]")
+{
+    boost::filesystem::ofstream manifest("manifest.tsv");
+    manifest << "# carrier\tpayload\ttechnique\toutput" << std::endl
+             << "test/files/solid_white.png\ttest/files/hello_world.txt" << std::endl
+             << std::endl
+             << "test/files/lena.png\ttest/files/hello_world.txt\tlsb\tout.png" << std::endl;
+    manifest.close();
+
+    std::vector<BatchJob> jobs = BatchEncoder::ReadManifest("manifest.tsv", "dct");
+
+    REQUIRE(jobs.size() == 2);
+    REQUIRE(jobs[0].technique == "dct");
+    REQUIRE(jobs[0].output_path == "steg-solid_white.jpg");
+    REQUIRE(jobs[1].technique == "lsb");
+    REQUIRE(jobs[1].output_path == "out.png");
+
+    manifest.open("manifest.tsv");
+    manifest << "test/files/solid_white.png\ttest/files/hello_world.txt\trot13" << std::endl;
+    manifest.close();
+
+    REQUIRE_THROWS_AS(BatchEncoder::ReadManifest("manifest.tsv", "dct"), EncodeException);
+    REQUIRE_THROWS_AS(BatchEncoder::ReadManifest("nonexistent.tsv", "dct"), EncodeException);
+
+    remove("manifest.tsv");
+}
+
+TEST_CASE("Encode a batch of jobs", "[BatchEncoder]")
+{
+    std::vector<unsigned char> correct_payload = {'H', 'e', 'l', 'l', 'o', ',', ' ', 'W', 'o', 'r', 'l', 'd', '!', '\n'};
+
+    std::vector<BatchJob> jobs(3);
+    jobs[0] = {"test/files/solid_white.png", "test/files/hello_world.txt", "lsb", "batch-lsb.png"};
+    jobs[1] = {"test/files/solid_white.png", "test/files/hello_world.txt", "dct", "batch-dct.jpg"};
+    jobs[2] = {"test/files/nonexistent.png", "test/files/hello_world.txt", "lsb", "batch-fail.png"};
+
+    BatchEncoder encoder(2, 10);
+    BatchReport report = encoder.Run(jobs);
+
+    // The failed job is reported without stopping the others
+    REQUIRE(report.completed == 2);
+    REQUIRE(report.errors.size() == 1);
+    REQUIRE(!boost::filesystem::exists("batch-fail.png"));
+
+    LeastSignificantBit decode_lsb = LeastSignificantBit("batch-lsb.png");
+    REQUIRE(decode_lsb.DecodeBuffer().bytes == correct_payload);
+
+    DiscreteCosineTransform decode_dct = DiscreteCosineTransform("batch-dct.jpg", 10);
+    REQUIRE(decode_dct.DecodeBuffer().bytes == correct_payload);
+
+    remove("batch-lsb.png");
+    remove("batch-dct.jpg");
+}
+
+TEST_CASE("Encode a batch of jobs with a layout", "[BatchEncoder]")
+{
+    std::vector<unsigned char> correct_payload = {'H', 'e', 'l', 'l', 'o', ',', ' ', 'W', 'o', 'r', 'l', 'd', '!', '\n'};
+
+    std::vector<BatchJob> jobs(2);
+    jobs[0] = {"test/files/solid_white.png", "test/files/hello_world.txt", "lsb", "batch-lsb.png"};
+    jobs[1] = {"test/files/lena.png", "test/files/hello_world.txt", "dct", "batch-dct.jpg"};
+
+    BatchEncoder encoder(2, 10);
+    encoder.SetBitsPerSample(3);
+    encoder.SetLayout(0, 2);
+    encoder.SetMatrixEmbedding(2);
+    encoder.SetFixedPoint(true);
+    REQUIRE(encoder.Run(jobs).completed == 2);
+
+    // The layout is recorded in each payload header, which the decoders read it from
+    std::string filename;
+    LeastSignificantBit decode_lsb = LeastSignificantBit("batch-lsb.png");
+    REQUIRE(decode_lsb.Probe(&filename).bits_per_sample == 3);
+    REQUIRE(decode_lsb.DecodeBuffer().bytes == correct_payload);
+
+    DiscreteCosineTransform decode_dct = DiscreteCosineTransform("batch-dct.jpg", 10);
+    const ContainerHeader header = decode_dct.Probe(&filename);
+    REQUIRE(header.channels == 3);
+    REQUIRE(header.pairs == 2);
+    REQUIRE(header.matrix_bits == 2);
+    REQUIRE(decode_dct.DecodeBuffer().bytes == correct_payload);
+
+    remove("batch-lsb.png");
+    remove("batch-dct.jpg");
+}
@@ -0,0 +1,134 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+#include "bit_kernels.hpp"
+
+/**
+ * Check whether the CPU supports an instruction set, __builtin_cpu_supports
+ * only accepts string literals.
+ */
+static bool CpuSupports(const std::string &instruction_set)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+
+    if (instruction_set == "avx2")
+    {
+        return __builtin_cpu_supports("avx2");
+    }
+
+    if (instruction_set == "sse2")
+    {
+        return __builtin_cpu_supports("sse2");
+    }
+#endif
+
+    return instruction_set == "scalar";
+}
+
+TEST_CASE("Embed/Extract bits using the LSB kernels", "[BitKernels]")
+{
+    // Use an odd length so that the vector and scalar tails are both exercised
+    std::vector<unsigned char> payload(37);
+    std::vector<unsigned char> carrier(payload.size() * 8 + 1);
+
+    for (size_t i = 0; i < payload.size(); i++)
+    {
+        payload[i] = (unsigned char)(i * 97 + 13);
+    }
+
+    for (size_t i = 0; i < carrier.size(); i++)
+    {
+        carrier[i] = (unsigned char)(i * 31 + 7);
+    }
+
+    std::vector<unsigned char> original = carrier;
+
+    // Embed at an offset so that the carrier is not aligned
+    EmbedBits(carrier.data() + 1, payload.data(), payload.size());
+
+    REQUIRE(carrier[0] == original[0]);
+
+    for (size_t i = 0; i < payload.size() * 8; i++)
+    {
+        REQUIRE((carrier[i + 1] & 0xFE) == (original[i + 1] & 0xFE));
+        REQUIRE((carrier[i + 1] & 1) == ((payload[i / 8] >> (i % 8)) & 1));
+    }
+
+    std::vector<unsigned char> extracted(payload.size());
+    ExtractBits(carrier.data() + 1, extracted.data(), extracted.size());
+
+    REQUIRE(payload == extracted);
+}
+
+TEST_CASE("Match the scalar kernel using each supported LSB kernel", "[BitKernels]")
+{
+    EmbedKernel scalar_embed;
+    ExtractKernel scalar_extract;
+    REQUIRE(LookupBitKernels("scalar", &scalar_embed, &scalar_extract));
+
+    std::mt19937 generator(42);
+    std::vector<unsigned char> payload(100);
+    std::vector<unsigned char> carrier(32 + (payload.size() * 8));
+
+    for (unsigned char &byte : payload)
+    {
+        byte = generator();
+    }
+
+    for (unsigned char &byte : carrier)
+    {
+        byte = generator();
+    }
+
+    for (const std::string instruction_set : {"sse2", "avx2"})
+    {
+        EmbedKernel embed;
+        ExtractKernel extract;
+
+        if (!CpuSupports(instruction_set) || !LookupBitKernels(instruction_set, &embed, &extract))
+        {
+            continue;
+        }
+
+        // Every unaligned start, and lengths which leave every possible tail after the vector loop
+        for (std::size_t offset = 0; offset < 32; offset++)
+        {
+            for (std::size_t length = 0; length <= payload.size(); length++)
+            {
+                std::vector<unsigned char> expected = carrier;
+                std::vector<unsigned char> embedded = carrier;
+                scalar_embed(expected.data() + offset, payload.data(), length);
+                embed(embedded.data() + offset, payload.data(), length);
+
+                REQUIRE(embedded == expected);
+
+                std::vector<unsigned char> expected_payload(length + 1, 0xAA);
+                std::vector<unsigned char> extracted_payload(length + 1, 0xAA);
+                scalar_extract(carrier.data() + offset, expected_payload.data(), length);
+                extract(carrier.data() + offset, extracted_payload.data(), length);
+
+                REQUIRE(extracted_payload == expected_payload);
+            }
+        }
+    }
+}
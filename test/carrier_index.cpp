@@ -0,0 +1,127 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <ctime>
+#include <iterator>
+#include <vector>
+
+#include <boost/filesystem/fstream.hpp>
+#include <catch.hpp>
+#include "carrier_index.hpp"
+#include "crc32c.hpp"
+#include "payload.hpp"
+#include "exceptions.hpp"
+
+TEST_CASE("Index a pool of carriers", "[CarrierIndex]")
+{
+    boost::filesystem::create_directories("pool/nested");
+    boost::filesystem::copy_file("test/files/lena.png", "pool/lena.png");
+    boost::filesystem::copy_file("test/files/solid_white.png", "pool/nested/solid_white.png");
+    boost::filesystem::copy_file("test/files/hello_world.txt", "pool/hello_world.txt");
+
+    // Only the images are indexed
+    CarrierIndex index("pool");
+    REQUIRE(index.Update() == 2);
+    REQUIRE(index.Entries().size() == 2);
+    REQUIRE(index.Entries()[0].path == "lena.png");
+    REQUIRE(index.Entries()[0].info.rows == 512);
+
+    PayloadReader contents("test/files/lena.png");
+    REQUIRE(index.Entries()[0].hash == Crc32c(0, contents.Data(), contents.Size()));
+
+    // The carriers which haven't changed aren't read again
+    CarrierIndex reloaded("pool");
+    REQUIRE(reloaded.Entries().size() == 2);
+    REQUIRE(reloaded.Update() == 0);
+    REQUIRE(reloaded.Entries()[1].path == "nested/solid_white.png");
+    REQUIRE(reloaded.Entries()[1].hash == index.Entries()[1].hash);
+
+    boost::filesystem::remove("pool/nested/solid_white.png");
+    REQUIRE(reloaded.Update() == 0);
+    REQUIRE(reloaded.Entries().size() == 1);
+    REQUIRE(CarrierIndex("pool").Entries().size() == 1);
+
+    REQUIRE_THROWS_AS(CarrierIndex("test/files/lena.png"), EncodeException);
+
+    boost::filesystem::remove_all("pool");
+}
+
+TEST_CASE("Pick the smallest carrier which fits from a pool", "[CarrierIndex]")
+{
+    boost::filesystem::create_directories("pool");
+    boost::filesystem::copy_file("test/files/lena.png", "pool/lena.png");
+    boost::filesystem::copy_file("test/files/solid_white.png", "pool/solid_white.png");
+
+    CarrierIndex index("pool");
+    index.Update();
+
+    // The smaller carrier stores 14968 bytes with 1 bit per sample, less the padded filename
+    const CarrierLayout lsb = {"lsb", 1, 0, 0};
+    REQUIRE(index.Select(lsb, 14, 15) == "pool/solid_white.png");
+    REQUIRE(index.Select(lsb, 14953, 15) == "pool/solid_white.png");
+    REQUIRE(index.Select(lsb, 14954, 15) == "pool/lena.png");
+    REQUIRE(index.Select({"lsb", 2, 0, 0}, 15051, 15) == "pool/solid_white.png");
+    REQUIRE_THROWS_AS(index.Select(lsb, 1000000, 15), EncodeException);
+
+    // Neither carrier is a JPEG
+    REQUIRE_THROWS_AS(index.Select({"jpeg", 0, 0, 0}, 14, 15), EncodeException);
+
+    boost::filesystem::remove_all("pool");
+}
+
+TEST_CASE("Only list the directories of a pool which changed", "[CarrierIndex]")
+{
+    boost::filesystem::create_directories("pool/nested");
+    boost::filesystem::copy_file("test/files/lena.png", "pool/lena.png");
+    boost::filesystem::copy_file("test/files/solid_white.png", "pool/nested/solid_white.png");
+
+    // Directories changed within the last second are always listed, so age them
+    const std::time_t past = std::time(nullptr) - 60;
+    boost::filesystem::create_directories("pool/.steganography");
+    boost::filesystem::last_write_time("pool", past);
+    boost::filesystem::last_write_time("pool/nested", past);
+
+    CarrierIndex index("pool");
+    REQUIRE(index.Update() == 2);
+
+    // A carrier rewritten in place doesn't change its directory, so an update doesn't notice it
+    {
+        boost::filesystem::ifstream source("test/files/solid_white.png", std::ios::binary);
+        boost::filesystem::ofstream destination("pool/lena.png", std::ios::binary | std::ios::trunc);
+        destination << source.rdbuf();
+    }
+
+    CarrierIndex reloaded("pool");
+    REQUIRE(reloaded.Update() == 0);
+    REQUIRE(reloaded.Entries()[0].info.rows == 512);
+
+    // But it's indexed again once it's picked, and no longer fits
+    const CarrierLayout lsb = {"lsb", 1, 0, 0};
+    REQUIRE_THROWS_AS(reloaded.Select(lsb, 14954, 15), EncodeException);
+    REQUIRE(reloaded.Entries()[0].info.rows != 512);
+    REQUIRE(CarrierIndex("pool").Entries()[0].info.rows != 512);
+
+    // Adding a carrier changes its directory, which is listed again
+    boost::filesystem::copy_file("test/files/lena.png", "pool/nested/lena.png");
+    REQUIRE(reloaded.Update() == 1);
+    REQUIRE(reloaded.Select(lsb, 14954, 15) == "pool/nested/lena.png");
+
+    // Only the index itself is left in its directory
+    REQUIRE(std::distance(boost::filesystem::directory_iterator("pool/.steganography"), boost::filesystem::directory_iterator()) == 1);
+
+    boost::filesystem::remove_all("pool");
+}
@@ -0,0 +1,96 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+#include "carrier_info.hpp"
+#include "probe.hpp"
+#include "least_significant_bit.hpp"
+#include "discrete_cosine_transform.hpp"
+#include "jpeg_coefficients.hpp"
+#include "exceptions.hpp"
+
+TEST_CASE("Read the capacity of PNG and JPEG images from their headers", "[CarrierInfo]")
+{
+    const CarrierInfo png = ReadCarrierInfo("test/files/lena.png");
+    REQUIRE(png.format == "png");
+    REQUIRE(png.rows == 512);
+    REQUIRE(png.cols == 512);
+    REQUIRE(png.channels == 3);
+    REQUIRE(png.depth == 8);
+
+    // The capacities are the same as those of the techniques over the decoded image
+    LeastSignificantBit lsb = LeastSignificantBit("test/files/lena.png");
+    lsb.SetBitsPerSample(3);
+    REQUIRE(PayloadCapacity(png, {"lsb", 3, 0, 0}, 9) == (lsb.Capacity() - lsb.PayloadStart(9)) / 8);
+
+    DiscreteCosineTransform dct = DiscreteCosineTransform("test/files/lena.png", 10);
+    dct.SetLayout(0, 4);
+    REQUIRE(PayloadCapacity(png, {"dct", 0, 0, 4}, 9) == (dct.Capacity() - dct.PayloadStart(9)) / 8);
+
+    // Every bits per sample of the LSB technique, and channels and pairs of the DCT technique
+    REQUIRE(CarrierLayouts(png).size() == 16);
+    REQUIRE(LayoutName(CarrierLayouts(png)[5]) == "dct:1x2");
+
+    DiscreteCosineTransform encode_dct = DiscreteCosineTransform("test/files/solid_white.png", 10);
+    encode_dct.Encode("test/files/hello_world.txt");
+
+    const CarrierInfo jpeg = ReadCarrierInfo("steg-solid_white.jpg");
+    REQUIRE(jpeg.format == "jpeg");
+    REQUIRE(LayoutName(CarrierLayouts(jpeg).back()) == "jpeg");
+
+    JpegCoefficients coefficients = JpegCoefficients("steg-solid_white.jpg", 10);
+    REQUIRE(jpeg.blocks == coefficients.Capacity());
+
+    remove("steg-solid_white.jpg");
+
+    REQUIRE_THROWS_AS(ReadCarrierInfo("test/files/hello_world.txt"), ImageException);
+    REQUIRE_THROWS_AS(ReadCarrierInfo("test/files/nonexistent.png"), ImageException);
+}
+
+TEST_CASE("Read the capacity of a TIFF image from its header", "[CarrierInfo]")
+{
+    // A little endian TIFF of 300x200 pixels, three 16-bit samples per pixel
+    const std::vector<unsigned char> tiff = {
+        'I', 'I', 42, 0, 8, 0, 0, 0,
+        4, 0,
+        0x00, 0x01, 3, 0, 1, 0, 0, 0, 0x2C, 0x01, 0, 0,
+        0x01, 0x01, 4, 0, 1, 0, 0, 0, 200, 0, 0, 0,
+        0x02, 0x01, 3, 0, 3, 0, 0, 0, 62, 0, 0, 0,
+        0x15, 0x01, 3, 0, 1, 0, 0, 0, 3, 0, 0, 0,
+        0, 0, 0, 0,
+        16, 0, 16, 0, 16, 0
+    };
+
+    boost::filesystem::ofstream file("carrier.tiff", std::ios::binary);
+    file.write(reinterpret_cast<const char *>(tiff.data()), tiff.size());
+    file.close();
+
+    const CarrierInfo info = ReadCarrierInfo("carrier.tiff");
+    REQUIRE(info.format == "tiff");
+    REQUIRE(info.rows == 200);
+    REQUIRE(info.cols == 300);
+    REQUIRE(info.channels == 3);
+    REQUIRE(info.depth == 16);
+    REQUIRE(PayloadCapacity(info, {"lsb", 1, 0, 0}, 0) == ((300 * 200 * 3) - 256) / 8);
+
+    REQUIRE(CorpusProbe::Capacity("carrier.tiff").find("\"lsb:1\": 22468, ") != std::string::npos);
+
+    remove("carrier.tiff");
+}
@@ -0,0 +1,73 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <catch.hpp>
+#include "container_header.hpp"
+#include "exceptions.hpp"
+
+TEST_CASE("Store/Load a container header", "[ContainerHeader]")
+{
+    const ContainerHeader header = {TECHNIQUE_DCT, 300, 0, 3, 4, 2, 15, 5000000000, 0xE3069283};
+    unsigned char bytes[HEADER_SIZE];
+    StoreHeader(header, bytes);
+
+    REQUIRE(HasMagic(bytes));
+
+    const ContainerHeader loaded = LoadHeader(bytes, TECHNIQUE_DCT);
+
+    REQUIRE(loaded.technique == TECHNIQUE_DCT);
+    REQUIRE(loaded.persistence == 300);
+    REQUIRE(loaded.channels == 3);
+    REQUIRE(loaded.pairs == 4);
+    REQUIRE(loaded.matrix_bits == 2);
+    REQUIRE(loaded.filename_length == 15);
+    REQUIRE(loaded.payload_length == 5000000000);
+    REQUIRE(loaded.payload_crc == 0xE3069283);
+
+    // The payload must fit after the payload start, and match the checksum
+    REQUIRE_NOTHROW(CheckCapacity(loaded, 1000, 1000 + (5000000000 * 8)));
+    REQUIRE_THROWS_AS(CheckCapacity(loaded, 1000, 999 + (5000000000 * 8)), DecodeException);
+    REQUIRE_NOTHROW(CheckCapacity(loaded, 40000000776ULL, 80000000776ULL));
+    REQUIRE_THROWS_AS(CheckCapacity(loaded, 40000000776ULL, 80000000775ULL), DecodeException);
+    REQUIRE_NOTHROW(VerifyPayload(loaded, 0xE3069283));
+    REQUIRE_THROWS_AS(VerifyPayload(loaded, 0), DecodeException);
+}
+
+TEST_CASE("Reject invalid container headers", "[ContainerHeader]")
+{
+    const ContainerHeader header = {TECHNIQUE_LSB, 0, 2, 0, 0, 0, 15, 14, 0};
+    unsigned char bytes[HEADER_SIZE];
+
+    // Written by a different technique
+    StoreHeader(header, bytes);
+    REQUIRE_THROWS_AS(LoadHeader(bytes, TECHNIQUE_JPEG), DecodeException);
+
+    // Without the magic
+    StoreHeader(header, bytes);
+    bytes[0] ^= 1;
+    REQUIRE(!HasMagic(bytes));
+    REQUIRE_THROWS_AS(LoadHeader(bytes, TECHNIQUE_LSB), DecodeException);
+
+    // Corrupted after the magic
+    StoreHeader(header, bytes);
+    bytes[20] ^= 1;
+    REQUIRE_THROWS_AS(LoadHeader(bytes, TECHNIQUE_LSB), DecodeException);
+
+    // A zero length payload
+    const ContainerHeader empty = {TECHNIQUE_LSB, 0, 2, 0, 0, 0, 15, 0, 0};
+    StoreHeader(empty, bytes);
+    REQUIRE_THROWS_AS(LoadHeader(bytes, TECHNIQUE_LSB), DecodeException);
+}
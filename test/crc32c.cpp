@@ -0,0 +1,53 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+#include "crc32c.hpp"
+
+TEST_CASE("Checksum buffers using CRC-32C", "[Crc32c]")
+{
+    const std::string check = "123456789";
+    const std::vector<unsigned char> zeros(32, 0);
+
+    // The standard check values of CRC-32C
+    REQUIRE(Crc32c(0, reinterpret_cast<const unsigned char *>(check.data()), check.size()) == 0xE3069283);
+    REQUIRE(Crc32c(0, zeros.data(), zeros.size()) == 0x8A9136AA);
+    REQUIRE(Crc32c(0, zeros.data(), 0) == 0);
+}
+
+TEST_CASE("Checksum a buffer in several parts using CRC-32C", "[Crc32c]")
+{
+    // Use an odd length so that the wide and narrow tails are both exercised
+    std::vector<unsigned char> buffer(1037);
+
+    for (size_t i = 0; i < buffer.size(); i++)
+    {
+        buffer[i] = (unsigned char)(i * 97 + 13);
+    }
+
+    const uint32_t whole = Crc32c(0, buffer.data(), buffer.size());
+
+    for (size_t split : {1, 3, 8, 515, 1036})
+    {
+        uint32_t crc = Crc32c(0, buffer.data(), split);
+        crc = Crc32c(crc, buffer.data() + split, buffer.size() - split);
+
+        REQUIRE(crc == whole);
+    }
+}
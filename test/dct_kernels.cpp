@@ -0,0 +1,84 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <vector>
+
+#include <catch.hpp>
+#include "dct_kernels.hpp"
+
+// The (0, 2) coefficient minus the (2, 0) coefficient of an 8x8 block, scaled by 1 / a(0)
+static double CoefficientDifference(const unsigned char *pixels, std::ptrdiff_t row_step, std::size_t pixel_step)
+{
+    const double basis[8] = {0.461939766, 0.191341716, -0.191341716, -0.461939766, -0.461939766, -0.191341716, 0.191341716, 0.461939766};
+    double difference = 0;
+
+    for (int row = 0; row < 8; row++)
+    {
+        for (int col = 0; col < 8; col++)
+        {
+            difference += pixels[(row * row_step) + (col * pixel_step)] * (basis[col] - basis[row]);
+        }
+    }
+
+    return difference;
+}
+
+TEST_CASE("Embed bits using the fixed point DCT kernels", "[DctKernels]")
+{
+    // Eight blocks wide with three interleaved channels, plus a column either side
+    const std::size_t pixel_step = 3;
+    const std::ptrdiff_t row_step = (66 * pixel_step);
+
+    std::vector<unsigned char> carrier(8 * row_step);
+    unsigned int state = 12345;
+
+    for (size_t i = 0; i < carrier.size(); i++)
+    {
+        state = state * 1103515245 + 12345;
+        carrier[i] = (unsigned char)(64 + ((state >> 16) % 128));
+    }
+
+    const std::vector<unsigned char> original = carrier;
+    std::vector<unsigned char> expected = carrier;
+
+    // The vector kernel must match the scalar kernel exactly
+    EmbedBlocks(carrier.data() + pixel_step, row_step, pixel_step, 0xA5, 10);
+
+    for (int block = 0; block < 8; block++)
+    {
+        EmbedBlock(expected.data() + pixel_step + (block * 8 * pixel_step), row_step, pixel_step, (0xA5 >> block) & 1, 10);
+    }
+
+    REQUIRE(carrier == expected);
+
+    for (int block = 0; block < 8; block++)
+    {
+        const double difference = CoefficientDifference(carrier.data() + pixel_step + (block * 8 * pixel_step), row_step, pixel_step);
+        REQUIRE((difference < 0) == (bool)((0xA5 >> block) & 1));
+    }
+
+    // Only the first channel of the eight blocks is modified
+    for (size_t i = 0; i < carrier.size(); i++)
+    {
+        const std::size_t col = (i % row_step) / pixel_step;
+
+        if (i % pixel_step != 0 || col == 0 || col == 65)
+        {
+            REQUIRE(carrier[i] == original[i]);
+        }
+    }
+}
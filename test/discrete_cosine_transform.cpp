@@ -15,10 +15,25 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
+#include <random>
+
 #include <catch.hpp>
 #include "discrete_cosine_transform.hpp"
+#include "least_significant_bit.hpp"
 #include "exceptions.hpp"
 
+/**
+ * This class is created so that the coefficients of single blocks can be tested
+ * against the full dct.
+ */
+class TestDiscreteCosineTransform : public DiscreteCosineTransform
+{
+    public:
+        using DiscreteCosineTransform::DiscreteCosineTransform;
+        using DiscreteCosineTransform::Coefficient;
+        using DiscreteCosineTransform::AdjustCoefficient;
+};
+
 TEST_CASE("Encode/Decode using the DCT technique", "[DiscreteCosineTransform]")
 {
     std::vector<unsigned char> correct_payload = {'H', 'e', 'l', 'l', 'o', ',', ' ', 'W', 'o', 'r', 'l', 'd', '!', '\n'};
@@ -50,6 +65,155 @@ TEST_CASE("Encode/Decode using the DCT technique", "[DiscreteCosineTransform]")
     remove("steg-hello_world.txt");
 }
 
+TEST_CASE("Encode/Decode in memory using the DCT technique", "[DiscreteCosineTransform]")
+{
+    std::vector<unsigned char> correct_payload = {'H', 'e', 'l', 'l', 'o', ',', ' ', 'W', 'o', 'r', 'l', 'd', '!', '\n'};
+
+    // Encode into an image which is already in memory
+    DiscreteCosineTransform encode_dct = DiscreteCosineTransform(cv::imread("test/files/solid_white.png", cv::IMREAD_UNCHANGED), 10);
+    std::vector<unsigned char> image_bytes = encode_dct.EncodeBuffer("hello_world.txt", correct_payload.data(), correct_payload.size());
+    REQUIRE(!image_bytes.empty());
+
+    // Decode straight from the encoded image
+    DiscreteCosineTransform decode_dct = DiscreteCosineTransform(image_bytes, 10);
+    DecodedPayload decoded_payload = decode_dct.DecodeBuffer();
+
+    REQUIRE(decoded_payload.filename == "hello_world.txt");
+    REQUIRE(decoded_payload.bytes == correct_payload);
+}
+
+TEST_CASE("Encode/Decode using the fixed point DCT kernels", "[DiscreteCosineTransform]")
+{
+    std::vector<unsigned char> correct_payload(200);
+
+    for (size_t i = 0; i < correct_payload.size(); i++)
+    {
+        correct_payload[i] = (unsigned char)(i * 97 + 13);
+    }
+
+    // The fixed point output is decoded by the floating point decoder
+    DiscreteCosineTransform encode_dct = DiscreteCosineTransform(cv::imread("test/files/lena.png", cv::IMREAD_UNCHANGED), 10);
+    encode_dct.SetFixedPoint(true);
+    encode_dct.Embed("payload.bin", correct_payload.data(), correct_payload.size());
+
+    DiscreteCosineTransform decode_dct = DiscreteCosineTransform(encode_dct.Image(), 10);
+    DecodedPayload decoded_payload = decode_dct.DecodeBuffer();
+
+    REQUIRE(decoded_payload.filename == "payload.bin");
+    REQUIRE(decoded_payload.bytes == correct_payload);
+}
+
+TEST_CASE("Encode/Decode using every channel and several coefficient pairs", "[DiscreteCosineTransform]")
+{
+    // Larger than the capacity of the carrier using a single channel and pair
+    std::vector<unsigned char> correct_payload(2000);
+
+    for (size_t i = 0; i < correct_payload.size(); i++)
+    {
+        correct_payload[i] = (unsigned char)(i * 97 + 13);
+    }
+
+    // Reduce the contrast of the carrier so that none of the blocks saturate
+    cv::Mat carrier = cv::imread("test/files/lena.png", cv::IMREAD_UNCHANGED);
+    carrier.convertTo(carrier, -1, 0.5, 64);
+
+    DiscreteCosineTransform encode_dct = DiscreteCosineTransform(carrier, 10);
+    encode_dct.SetLayout(0, 4);
+    encode_dct.Embed("payload.bin", correct_payload.data(), correct_payload.size());
+
+    DiscreteCosineTransform decode_dct = DiscreteCosineTransform(encode_dct.Image(), 10);
+    decode_dct.SetLayout(0, 4);
+    DecodedPayload decoded_payload = decode_dct.DecodeBuffer();
+
+    REQUIRE(decoded_payload.filename == "payload.bin");
+    REQUIRE(decoded_payload.bytes == correct_payload);
+
+    DiscreteCosineTransform single_dct = DiscreteCosineTransform(cv::imread("test/files/lena.png", cv::IMREAD_UNCHANGED), 10);
+    REQUIRE_THROWS_AS(single_dct.Embed("payload.bin", correct_payload.data(), correct_payload.size()), EncodeException);
+    REQUIRE_THROWS_AS(single_dct.SetLayout(1, 3), ImageException);
+}
+
+TEST_CASE("Decode using the layout in the header", "[DiscreteCosineTransform]")
+{
+    std::vector<unsigned char> correct_payload = {'H', 'e', 'l', 'l', 'o', ',', ' ', 'W', 'o', 'r', 'l', 'd', '!', '\n'};
+
+    // Reduce the contrast of the carrier so that none of the blocks saturate
+    cv::Mat carrier = cv::imread("test/files/lena.png", cv::IMREAD_UNCHANGED);
+    carrier.convertTo(carrier, -1, 0.5, 64);
+
+    DiscreteCosineTransform encode_dct = DiscreteCosineTransform(carrier, 10);
+    encode_dct.SetLayout(0, 2);
+    encode_dct.SetMatrixEmbedding(2);
+    encode_dct.Embed("hello_world.txt", correct_payload.data(), correct_payload.size());
+
+    // The decoder isn't told the layout or matrix embedding, they're read from the header
+    DiscreteCosineTransform decode_dct = DiscreteCosineTransform(encode_dct.Image(), 10);
+    DecodedPayload decoded_payload = decode_dct.DecodeBuffer();
+
+    REQUIRE(decoded_payload.filename == "hello_world.txt");
+    REQUIRE(decoded_payload.bytes == correct_payload);
+
+    // The LSB technique rejects the image after reading the magic
+    LeastSignificantBit decode_lsb = LeastSignificantBit(encode_dct.Image());
+    REQUIRE_THROWS_AS(decode_lsb.DecodeBuffer(), DecodeException);
+}
+
+TEST_CASE("Encode/Decode using matrix embedding", "[DiscreteCosineTransform]")
+{
+    std::vector<unsigned char> correct_payload(150);
+
+    for (size_t i = 0; i < correct_payload.size(); i++)
+    {
+        correct_payload[i] = (unsigned char)(i * 97 + 13);
+    }
+
+    // Reduce the contrast of the carrier so that none of the blocks saturate
+    cv::Mat carrier = cv::imread("test/files/lena.png", cv::IMREAD_UNCHANGED);
+    carrier.convertTo(carrier, -1, 0.5, 64);
+
+    DiscreteCosineTransform encode_dct = DiscreteCosineTransform(carrier, 10);
+    encode_dct.SetMatrixEmbedding(3);
+    encode_dct.Embed("payload.bin", correct_payload.data(), correct_payload.size());
+
+    DiscreteCosineTransform decode_dct = DiscreteCosineTransform(encode_dct.Image(), 10);
+    decode_dct.SetMatrixEmbedding(3);
+    DecodedPayload decoded_payload = decode_dct.DecodeBuffer();
+
+    REQUIRE(decoded_payload.filename == "payload.bin");
+    REQUIRE(decoded_payload.bytes == correct_payload);
+
+    REQUIRE_THROWS_AS(decode_dct.SetMatrixEmbedding(9), ImageException);
+}
+
+TEST_CASE("Embed into the first channel of the carrier image in place", "[DiscreteCosineTransform]")
+{
+    std::vector<unsigned char> payload = {'H', 'e', 'l', 'l', 'o', ',', ' ', 'W', 'o', 'r', 'l', 'd', '!', '\n'};
+
+    cv::Mat carrier = cv::imread("test/files/lena.png", cv::IMREAD_UNCHANGED);
+    cv::Mat original = carrier.clone();
+
+    DiscreteCosineTransform encode_dct = DiscreteCosineTransform(carrier, 10);
+    encode_dct.Embed("hello_world.txt", payload.data(), payload.size());
+
+    // The pixels are modified in place without changing the type of the image
+    REQUIRE(encode_dct.Image().data == carrier.data);
+    REQUIRE(encode_dct.Image().type() == original.type());
+
+    int changed[3] = {0, 0, 0};
+
+    for (int row = 0; row < carrier.rows; row++)
+    {
+        for (int col = 0; col < carrier.cols * 3; col++)
+        {
+            changed[col % 3] += carrier.ptr<unsigned char>(row)[col] != original.ptr<unsigned char>(row)[col];
+        }
+    }
+
+    REQUIRE(changed[0] > 0);
+    REQUIRE(changed[1] == 0);
+    REQUIRE(changed[2] == 0);
+}
+
 TEST_CASE("Encode failure using the DCT technique", "[DiscreteCosineTransform]")
 {
     DiscreteCosineTransform encode_dct = DiscreteCosineTransform("test/files/solid_white.png", 1);
@@ -61,3 +225,62 @@ TEST_CASE("Decode failure using the DCT technique", "[DiscreteCosineTransform]")
     DiscreteCosineTransform decode_dct = DiscreteCosineTransform("test/files/solid_white.png", 1);
     REQUIRE_THROWS_AS(decode_dct.Decode(), DecodeException);
 }
+
+TEST_CASE("Calculate the layout of a carrier with more than 2^32 blocks using the DCT technique", "[DiscreteCosineTransform]")
+{
+    REQUIRE(DiscreteCosineTransform::LayoutCapacity(2000000, 2000000, 3, 4) == 749994000012ULL);
+    REQUIRE(DiscreteCosineTransform::LayoutPayloadStart(3, 4, 5000000000ULL) == (HEADER_BITS * 12) + 40000000000ULL);
+}
+
+TEST_CASE("Match the full dct when reading/adjusting single coefficients", "[DiscreteCosineTransform]")
+{
+    TestDiscreteCosineTransform dct(cv::Mat(16, 16, CV_8UC1, cv::Scalar(0)), 10);
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> pixel(0, 255);
+    std::uniform_real_distribution<float> delta(-50, 50);
+    std::uniform_int_distribution<int> index(0, 7);
+
+    for (int trial = 0; trial < 32; trial++)
+    {
+        cv::Mat block(8, 8, CV_32F);
+
+        for (int row = 0; row < 8; row++)
+        {
+            for (int col = 0; col < 8; col++)
+            {
+                block.at<float>(row, col) = pixel(generator);
+            }
+        }
+
+        cv::Mat coefficients;
+        cv::dct(block, coefficients);
+
+        for (int u = 0; u < 8; u++)
+        {
+            for (int v = 0; v < 8; v++)
+            {
+                REQUIRE(dct.Coefficient(block, u, v) == Approx(coefficients.at<float>(u, v)).margin(1e-2));
+            }
+        }
+
+        // Adjusting a coefficient in the spatial domain matches a round trip through the full dct
+        const int u = index(generator), v = index(generator);
+        const float change = delta(generator);
+
+        cv::Mat adjusted = block.clone();
+        dct.AdjustCoefficient(&adjusted, u, v, change);
+
+        coefficients.at<float>(u, v) += change;
+        cv::Mat expected;
+        cv::idct(coefficients, expected);
+
+        for (int row = 0; row < 8; row++)
+        {
+            for (int col = 0; col < 8; col++)
+            {
+                REQUIRE(adjusted.at<float>(row, col) == Approx(expected.at<float>(row, col)).margin(1e-2));
+            }
+        }
+    }
+}
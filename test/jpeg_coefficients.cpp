@@ -0,0 +1,62 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <vector>
+
+#include <catch.hpp>
+#include "jpeg_coefficients.hpp"
+#include "exceptions.hpp"
+
+TEST_CASE("Encode/Decode using the JPEG coefficients", "[JpegCoefficients]")
+{
+    std::vector<unsigned char> correct_payload(400);
+
+    for (size_t i = 0; i < correct_payload.size(); i++)
+    {
+        correct_payload[i] = (unsigned char)(i * 97 + 13);
+    }
+
+    std::vector<unsigned char> carrier_bytes;
+    cv::imencode(".jpg", cv::imread("test/files/lena.png", cv::IMREAD_UNCHANGED), carrier_bytes,
+            std::vector<int>{CV_IMWRITE_JPEG_QUALITY, 75});
+
+    JpegCoefficients encode_jpeg = JpegCoefficients(carrier_bytes, 10);
+    std::vector<unsigned char> image_bytes = encode_jpeg.EncodeBuffer("payload.bin", correct_payload.data(), correct_payload.size());
+
+    // The coefficients are written back without being requantised
+    cv::Mat carrier = cv::imdecode(carrier_bytes, cv::IMREAD_UNCHANGED);
+    cv::Mat steg_image = cv::imdecode(image_bytes, cv::IMREAD_UNCHANGED);
+
+    REQUIRE(steg_image.rows == carrier.rows);
+    REQUIRE(steg_image.cols == carrier.cols);
+    REQUIRE(steg_image.type() == carrier.type());
+    REQUIRE(image_bytes.size() < carrier_bytes.size() * 1.05);
+
+    JpegCoefficients decode_jpeg = JpegCoefficients(image_bytes, 10);
+    DecodedPayload decoded_payload = decode_jpeg.DecodeBuffer();
+
+    REQUIRE(decoded_payload.filename == "payload.bin");
+    REQUIRE(decoded_payload.bytes == correct_payload);
+}
+
+TEST_CASE("Failure to read the coefficients of an image which isn't a JPEG", "[JpegCoefficients]")
+{
+    std::vector<unsigned char> image_bytes = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    REQUIRE_THROWS_AS(JpegCoefficients(image_bytes, 10), ImageException);
+    REQUIRE_THROWS_AS(JpegCoefficients("test/files/lena.png", 10), ImageException);
+}
@@ -17,9 +17,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include <vector>
 #include <fstream>
+#include <sstream>
+#include <string>
 
 #include <catch.hpp>
 #include "least_significant_bit.hpp"
+#include "thread_pool.hpp"
+#include "tracer.hpp"
 #include "exceptions.hpp"
 
 TEST_CASE("Encode/Decode using the LSB technique", "[LeastSignificantBit]")
@@ -53,6 +57,182 @@ TEST_CASE("Encode/Decode using the LSB technique", "[LeastSignificantBit]")
     remove("steg-hello_world.txt");
 }
 
+TEST_CASE("Encode/Decode a streamed payload using the LSB technique", "[LeastSignificantBit]")
+{
+    std::vector<unsigned char> correct_payload = {'H', 'e', 'l', 'l', 'o', ',', ' ', 'W', 'o', 'r', 'l', 'd', '!', '\n'};
+
+    // Use a window smaller than the payload so that it's streamed in several windows
+    LeastSignificantBit encode_lsb = LeastSignificantBit("test/files/solid_white.png");
+    encode_lsb.SetStreamWindow(4);
+    encode_lsb.Encode("test/files/hello_world.txt");
+
+    LeastSignificantBit decode_lsb = LeastSignificantBit("steg-solid_white.png");
+    decode_lsb.SetStreamWindow(4);
+    decode_lsb.Decode();
+
+    boost::filesystem::ifstream check_file("steg-hello_world.txt", std::ios::binary);
+    std::vector<unsigned char> decoded_payload((std::istreambuf_iterator<char>(check_file)), std::istreambuf_iterator<char>());
+    check_file.close();
+
+    REQUIRE(correct_payload == decoded_payload);
+
+    remove("steg-solid_white.png");
+    remove("steg-hello_world.txt");
+}
+
+TEST_CASE("Encode/Decode a streamed payload of several windows with several bits per sample", "[LeastSignificantBit]")
+{
+    // Several tasks per window, and windows which aren't a whole number of 3 byte units, so that the later
+    // windows start part way through a sample
+    const std::size_t window = 200000;
+    std::vector<unsigned char> correct_payload((window * 3) + 1234);
+
+    for (size_t i = 0; i < correct_payload.size(); i++)
+    {
+        correct_payload[i] = (unsigned char)((i * 131) ^ (i >> 7));
+    }
+
+    boost::filesystem::ofstream payload_file("pattern.bin", std::ios::binary);
+    payload_file.write(reinterpret_cast<const char *>(correct_payload.data()), correct_payload.size());
+    payload_file.close();
+
+    cv::Mat carrier(1000, 700, CV_8UC3);
+    cv::randu(carrier, cv::Scalar(0), cv::Scalar(255));
+    cv::imwrite("stream_carrier.png", carrier);
+
+    ThreadPool::SetThreads(4);
+    Tracer::Enable();
+
+    LeastSignificantBit encode_lsb = LeastSignificantBit("stream_carrier.png");
+    encode_lsb.SetBitsPerSample(3);
+    encode_lsb.SetStreamWindow(window);
+    encode_lsb.Encode("pattern.bin");
+
+    Tracer::Disable();
+
+    std::ostringstream trace;
+    Tracer::Write(trace);
+
+    // Only the first chunk of a window may start part way through a unit, otherwise two chunks would share a sample
+    const std::size_t payload_start = encode_lsb.PayloadStart(11);
+    std::istringstream events(trace.str());
+    std::size_t chunks = 0;
+
+    for (std::string event; std::getline(events, event);)
+    {
+        const std::size_t position = event.find("\"start_bit\": ");
+
+        if (event.find("\"name\": \"embed\"") == std::string::npos || position == std::string::npos)
+        {
+            continue;
+        }
+
+        const std::size_t start_bit = std::stoull(event.substr(position + 13));
+        const bool window_start = (start_bit - payload_start) % (window * 8) == 0;
+
+        REQUIRE((window_start || start_bit % 24 == 0));
+        chunks++;
+    }
+
+    REQUIRE(chunks > 4);
+
+    LeastSignificantBit decode_lsb = LeastSignificantBit("steg-stream_carrier.png");
+    DecodedPayload decoded_payload = decode_lsb.DecodeBuffer();
+
+    ThreadPool::SetThreads(0);
+
+    REQUIRE(decoded_payload.filename == "pattern.bin");
+    REQUIRE(decoded_payload.bytes == correct_payload);
+
+    remove("pattern.bin");
+    remove("stream_carrier.png");
+    remove("steg-stream_carrier.png");
+}
+
+TEST_CASE("Encode/Decode in memory using the LSB technique", "[LeastSignificantBit]")
+{
+    std::vector<unsigned char> correct_payload = {'H', 'e', 'l', 'l', 'o', ',', ' ', 'W', 'o', 'r', 'l', 'd', '!', '\n'};
+
+    // Encode into an image which is already in memory
+    LeastSignificantBit encode_lsb = LeastSignificantBit(cv::imread("test/files/solid_white.png", cv::IMREAD_UNCHANGED));
+    std::vector<unsigned char> image_bytes = encode_lsb.EncodeBuffer("hello_world.txt", correct_payload.data(), correct_payload.size());
+    REQUIRE(!image_bytes.empty());
+
+    // Decode straight from the encoded image
+    LeastSignificantBit decode_lsb = LeastSignificantBit(image_bytes);
+    DecodedPayload decoded_payload = decode_lsb.DecodeBuffer();
+
+    REQUIRE(decoded_payload.filename == "hello_world.txt");
+    REQUIRE(decoded_payload.bytes == correct_payload);
+    REQUIRE(!boost::filesystem::exists("steg-hello_world.txt"));
+}
+
+TEST_CASE("Encode/Decode several bits per sample using the LSB technique", "[LeastSignificantBit]")
+{
+    std::vector<unsigned char> correct_payload(2000);
+
+    for (size_t i = 0; i < correct_payload.size(); i++)
+    {
+        correct_payload[i] = (unsigned char)(i * 97 + 13);
+    }
+
+    // Use 16-bit RGBA and 8-bit grayscale carriers which are too small for the payload at one bit per sample
+    std::vector<cv::Mat> carriers = {cv::Mat(37, 41, CV_16UC4), cv::Mat(71, 83, CV_8UC1)};
+
+    for (cv::Mat &carrier : carriers)
+    {
+        cv::randu(carrier, cv::Scalar(0), cv::Scalar(carrier.depth() == CV_16U ? 65535 : 255));
+
+        for (int bits = 1; bits <= 4; bits++)
+        {
+            LeastSignificantBit encode_lsb = LeastSignificantBit(carrier.clone());
+            encode_lsb.SetBitsPerSample(bits);
+
+            if (bits < 3)
+            {
+                REQUIRE_THROWS_AS(encode_lsb.Embed("pattern.bin", correct_payload.data(), correct_payload.size()), EncodeException);
+                continue;
+            }
+
+            std::vector<unsigned char> image_bytes = encode_lsb.EncodeBuffer("pattern.bin", correct_payload.data(), correct_payload.size());
+
+            LeastSignificantBit decode_lsb = LeastSignificantBit(image_bytes);
+            decode_lsb.SetBitsPerSample(bits);
+            DecodedPayload decoded_payload = decode_lsb.DecodeBuffer();
+
+            REQUIRE(decoded_payload.filename == "pattern.bin");
+            REQUIRE(decoded_payload.bytes == correct_payload);
+        }
+    }
+
+    LeastSignificantBit lsb = LeastSignificantBit(carriers[0]);
+    REQUIRE_THROWS_AS(lsb.SetBitsPerSample(0), ImageException);
+    REQUIRE_THROWS_AS(lsb.SetBitsPerSample(5), ImageException);
+}
+
+TEST_CASE("Decode using the bits per sample in the header using the LSB technique", "[LeastSignificantBit]")
+{
+    std::vector<unsigned char> correct_payload = {'H', 'e', 'l', 'l', 'o', ',', ' ', 'W', 'o', 'r', 'l', 'd', '!', '\n'};
+
+    LeastSignificantBit encode_lsb = LeastSignificantBit(cv::imread("test/files/solid_white.png", cv::IMREAD_UNCHANGED));
+    encode_lsb.SetBitsPerSample(3);
+    encode_lsb.Embed("hello_world.txt", correct_payload.data(), correct_payload.size());
+
+    // The decoder isn't told the bits per sample, they're read from the header
+    LeastSignificantBit decode_lsb = LeastSignificantBit(encode_lsb.Image());
+    DecodedPayload decoded_payload = decode_lsb.DecodeBuffer();
+
+    REQUIRE(decoded_payload.filename == "hello_world.txt");
+    REQUIRE(decoded_payload.bytes == correct_payload);
+
+    // Flip a bit of the payload, which is no longer decoded without an error
+    cv::Mat corrupt = encode_lsb.Image().clone();
+    corrupt.data[(decode_lsb.PayloadStart(15) / 3) + 5] ^= 1;
+
+    LeastSignificantBit corrupt_lsb = LeastSignificantBit(corrupt);
+    REQUIRE_THROWS_AS(corrupt_lsb.DecodeBuffer(), DecodeException);
+}
+
 TEST_CASE("Encode failure using the LSB technique", "[Encode]")
 {
     LeastSignificantBit encode_lsb = LeastSignificantBit("test/files/solid_white.png");
@@ -64,3 +244,12 @@ TEST_CASE("Decode failure using the LSB technique", "[Decode]")
     LeastSignificantBit decode_lsb = LeastSignificantBit("test/files/solid_white.png");
     REQUIRE_THROWS_AS(decode_lsb.Decode(), DecodeException);
 }
+
+TEST_CASE("Calculate the layout of a carrier with more than 2^32 samples using the LSB technique", "[LeastSignificantBit]")
+{
+    REQUIRE(LeastSignificantBit::LayoutCapacity(50000, 50000, 4, 4) == 40000000000ULL);
+    REQUIRE(LeastSignificantBit::LayoutCapacity(65535, 65535, 4, 8) == 137434759200ULL);
+
+    // A filename field longer than 4 GiB is rounded up to a whole unit
+    REQUIRE(LeastSignificantBit::LayoutPayloadStart(3, 5000000000ULL) == (HEADER_BITS * 3) + 40000000008ULL);
+}
@@ -0,0 +1,254 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <iterator>
+#include <vector>
+
+#include <catch.hpp>
+#include "mapped_carrier.hpp"
+#include "least_significant_bit.hpp"
+#include "exceptions.hpp"
+
+/**
+ * Read the contents of a file into memory.
+ */
+static std::vector<unsigned char> ReadFile(const boost::filesystem::path &path)
+{
+    boost::filesystem::ifstream file(path, std::ios::binary);
+    return std::vector<unsigned char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+/**
+ * Write a buffer to a file.
+ */
+static void WriteFile(const boost::filesystem::path &path, const std::vector<unsigned char> &bytes)
+{
+    boost::filesystem::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
+
+TEST_CASE("Encode/Decode a PGM image in place using the LSB technique", "[MappedCarrier]")
+{
+    const std::vector<unsigned char> correct_payload = ReadFile("test/files/lorem_ipsum.txt");
+
+    cv::Mat image(320, 400, CV_8UC1);
+    cv::randu(image, cv::Scalar(0), cv::Scalar(255));
+    cv::imwrite("carrier.pgm", image);
+
+    {
+        MappedCarrier carrier("carrier.pgm", "steg-carrier.pgm");
+        LeastSignificantBit lsb = LeastSignificantBit(carrier.Pixels());
+        lsb.Embed("lorem_ipsum.txt", correct_payload.data(), correct_payload.size());
+        carrier.Commit();
+    }
+
+    // Only the pixels of the copy changed, the header and size of the image are unchanged
+    const std::vector<unsigned char> carrier_bytes = ReadFile("carrier.pgm");
+    const std::vector<unsigned char> steg_bytes = ReadFile("steg-carrier.pgm");
+
+    REQUIRE(steg_bytes.size() == carrier_bytes.size());
+    REQUIRE(std::equal(carrier_bytes.begin(), carrier_bytes.end() - image.total(), steg_bytes.begin()));
+    REQUIRE(steg_bytes != carrier_bytes);
+
+    // A PGM image has the same layout as cv::imread, so either decoder can be used
+    LeastSignificantBit decode_lsb = LeastSignificantBit("steg-carrier.pgm");
+    DecodedPayload decoded_payload = decode_lsb.DecodeBuffer();
+
+    REQUIRE(decoded_payload.filename == "lorem_ipsum.txt");
+    REQUIRE(decoded_payload.bytes == correct_payload);
+
+    MappedCarrier steg_carrier("steg-carrier.pgm");
+    LeastSignificantBit decode_mapped = LeastSignificantBit(steg_carrier.Pixels());
+    REQUIRE(decode_mapped.DecodeBuffer().bytes == correct_payload);
+
+    remove("carrier.pgm");
+    remove("steg-carrier.pgm");
+}
+
+TEST_CASE("Encode/Decode a bottom-up BMP image in place using the LSB technique", "[MappedCarrier]")
+{
+    const std::vector<unsigned char> correct_payload = ReadFile("test/files/lorem_ipsum.txt");
+
+    // A 24-bit image 37 pixels wide, so each row of 111 bytes is padded to 112 bytes
+    const int width = 37, height = 600, step = 112;
+    std::vector<unsigned char> carrier_bytes(54 + (step * height));
+
+    carrier_bytes[0] = 'B';
+    carrier_bytes[1] = 'M';
+    carrier_bytes[10] = 54;
+    carrier_bytes[14] = 40;
+    carrier_bytes[18] = width;
+    carrier_bytes[22] = height & 0xff;
+    carrier_bytes[23] = height >> 8;
+    carrier_bytes[26] = 1;
+    carrier_bytes[28] = 24;
+
+    for (size_t i = 54; i < carrier_bytes.size(); i++)
+    {
+        carrier_bytes[i] = ((i - 54) % step < width * 3) ? (unsigned char)(i * 31) : 0;
+    }
+
+    WriteFile("carrier.bmp", carrier_bytes);
+
+    {
+        MappedCarrier carrier("carrier.bmp", "steg-carrier.bmp");
+        REQUIRE(carrier.Pixels().rows == height);
+        REQUIRE(carrier.Pixels().cols == width);
+        REQUIRE(carrier.Pixels().channels() == 3);
+
+        REQUIRE(carrier.BottomUp());
+        REQUIRE(!carrier.ReversedChannels());
+
+        LeastSignificantBit lsb = LeastSignificantBit(carrier.Pixels());
+        lsb.SetBitsPerSample(2);
+        lsb.SetFileOrder(carrier.BottomUp(), carrier.ReversedChannels());
+        lsb.Embed("lorem_ipsum.txt", correct_payload.data(), correct_payload.size());
+        carrier.Commit();
+    }
+
+    // The headers and the padding at the end of each row are untouched
+    const std::vector<unsigned char> steg_bytes = ReadFile("steg-carrier.bmp");
+    REQUIRE(steg_bytes.size() == carrier_bytes.size());
+
+    for (size_t i = 0; i < steg_bytes.size(); i++)
+    {
+        if (i < 54 || (i - 54) % step >= width * 3)
+        {
+            REQUIRE(steg_bytes[i] == carrier_bytes[i]);
+        }
+    }
+
+    // The rows are walked in the order of cv::imread, so either decoder can be used
+    LeastSignificantBit decode_lsb = LeastSignificantBit("steg-carrier.bmp");
+    DecodedPayload decoded_payload = decode_lsb.DecodeBuffer();
+
+    REQUIRE(decoded_payload.filename == "lorem_ipsum.txt");
+    REQUIRE(decoded_payload.bytes == correct_payload);
+
+    MappedCarrier steg_carrier("steg-carrier.bmp");
+    LeastSignificantBit decode_mapped = LeastSignificantBit(steg_carrier.Pixels());
+    decode_mapped.SetFileOrder(steg_carrier.BottomUp(), steg_carrier.ReversedChannels());
+    REQUIRE(decode_mapped.DecodeBuffer().bytes == correct_payload);
+
+    remove("carrier.bmp");
+    remove("steg-carrier.bmp");
+}
+
+TEST_CASE("Encode/Decode a PPM image in place using the LSB technique", "[MappedCarrier]")
+{
+    const std::vector<unsigned char> correct_payload = ReadFile("test/files/lorem_ipsum.txt");
+
+    cv::Mat image(300, 200, CV_8UC3);
+    cv::randu(image, cv::Scalar(0, 0, 0), cv::Scalar(255, 255, 255));
+    cv::imwrite("carrier.ppm", image);
+
+    {
+        MappedCarrier carrier("carrier.ppm", "steg-carrier.ppm");
+        REQUIRE(!carrier.BottomUp());
+        REQUIRE(carrier.ReversedChannels());
+
+        LeastSignificantBit lsb = LeastSignificantBit(carrier.Pixels());
+        lsb.SetBitsPerSample(3);
+        lsb.SetFileOrder(carrier.BottomUp(), carrier.ReversedChannels());
+        lsb.Embed("lorem_ipsum.txt", correct_payload.data(), correct_payload.size());
+        carrier.Commit();
+    }
+
+    // The channels are walked in the order of cv::imread, so a PPM encoded in place decodes normally
+    LeastSignificantBit decode_lsb = LeastSignificantBit("steg-carrier.ppm");
+    DecodedPayload decoded_payload = decode_lsb.DecodeBuffer();
+
+    REQUIRE(decoded_payload.filename == "lorem_ipsum.txt");
+    REQUIRE(decoded_payload.bytes == correct_payload);
+
+    // And a PPM encoded from its decoded pixels can be decoded in place
+    LeastSignificantBit encode_lsb = LeastSignificantBit(image);
+    encode_lsb.Embed("lorem_ipsum.txt", correct_payload.data(), correct_payload.size());
+    cv::imwrite("steg-carrier.ppm", image);
+
+    MappedCarrier steg_carrier("steg-carrier.ppm");
+    LeastSignificantBit decode_mapped = LeastSignificantBit(steg_carrier.Pixels());
+    decode_mapped.SetFileOrder(steg_carrier.BottomUp(), steg_carrier.ReversedChannels());
+    decoded_payload = decode_mapped.DecodeBuffer();
+
+    REQUIRE(decoded_payload.filename == "lorem_ipsum.txt");
+    REQUIRE(decoded_payload.bytes == correct_payload);
+
+    remove("carrier.ppm");
+    remove("steg-carrier.ppm");
+}
+
+TEST_CASE("In place failure using the LSB technique", "[MappedCarrier]")
+{
+    // Compressed and 16-bit carriers can't be mapped
+    REQUIRE_THROWS_AS(MappedCarrier("test/files/lena.png"), ImageException);
+    REQUIRE_THROWS_AS(MappedCarrier("test/files/does_not_exist.pgm"), ImageException);
+
+    const std::string header = "P5\n# sixteen bit\n2 2\n65535\n";
+    std::vector<unsigned char> wide_bytes(header.begin(), header.end());
+    wide_bytes.resize(wide_bytes.size() + 8);
+    WriteFile("carrier.pgm", wide_bytes);
+
+    REQUIRE_THROWS_AS(MappedCarrier("carrier.pgm"), ImageException);
+
+    // cv::imread decodes a 32-bit BMP without its fourth byte, so its pixels can't be walked in place
+    std::vector<unsigned char> bitmap_bytes(54 + (4 * 4 * 4));
+    bitmap_bytes[0] = 'B';
+    bitmap_bytes[1] = 'M';
+    bitmap_bytes[10] = 54;
+    bitmap_bytes[14] = 40;
+    bitmap_bytes[18] = 4;
+    bitmap_bytes[22] = 4;
+    bitmap_bytes[26] = 1;
+    bitmap_bytes[28] = 32;
+    WriteFile("carrier.bmp", bitmap_bytes);
+
+    REQUIRE_THROWS_AS(MappedCarrier("carrier.bmp", "steg-carrier.bmp"), ImageException);
+    REQUIRE(!boost::filesystem::exists("steg-carrier.bmp"));
+
+    remove("carrier.bmp");
+
+    // The pixels of a truncated image run past the end of the file
+    const std::string truncated = "P6 4 4 255\n";
+    WriteFile("carrier.pgm", std::vector<unsigned char>(truncated.begin(), truncated.end()));
+
+    REQUIRE_THROWS_AS(MappedCarrier("carrier.pgm", "steg-carrier.pgm"), ImageException);
+    REQUIRE(!boost::filesystem::exists("steg-carrier.pgm"));
+
+    // The output can't be the carrier, or a hard link to it, as it's truncated before the carrier is copied
+    cv::imwrite("carrier.pgm", cv::Mat(8, 8, CV_8UC1, cv::Scalar(7)));
+    boost::filesystem::create_hard_link("carrier.pgm", "linked.pgm");
+
+    REQUIRE_THROWS_AS(MappedCarrier("carrier.pgm", "carrier.pgm"), ImageException);
+    REQUIRE_THROWS_AS(MappedCarrier("carrier.pgm", "linked.pgm"), ImageException);
+    REQUIRE(boost::filesystem::file_size("carrier.pgm") == 8 * 8 + 11);
+
+    remove("linked.pgm");
+
+    // A payload too large for the carrier leaves no output behind
+    cv::imwrite("carrier.pgm", cv::Mat(8, 8, CV_8UC1, cv::Scalar(0)));
+    const std::vector<unsigned char> payload = ReadFile("test/files/lorem_ipsum.txt");
+
+    {
+        MappedCarrier carrier("carrier.pgm", "steg-carrier.pgm");
+        LeastSignificantBit lsb = LeastSignificantBit(carrier.Pixels());
+        REQUIRE_THROWS_AS(lsb.Embed("lorem_ipsum.txt", payload.data(), payload.size()), EncodeException);
+    }
+
+    REQUIRE(!boost::filesystem::exists("steg-carrier.pgm"));
+
+    remove("carrier.pgm");
+}
@@ -0,0 +1,159 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include <catch.hpp>
+#include "payload.hpp"
+#include "exceptions.hpp"
+
+TEST_CASE("Read a payload using a memory mapping", "[PayloadReader]")
+{
+    std::vector<unsigned char> correct_payload = {'H', 'e', 'l', 'l', 'o', ',', ' ', 'W', 'o', 'r', 'l', 'd', '!', '\n'};
+
+    PayloadReader payload("test/files/hello_world.txt");
+
+    REQUIRE(std::vector<unsigned char>(payload.Data(), payload.Data() + payload.Size()) == correct_payload);
+}
+
+TEST_CASE("Read a payload from a pipe", "[PayloadReader]")
+{
+    std::string correct_payload = "Hello, World!\n";
+
+    int descriptors[2];
+    REQUIRE(pipe(descriptors) == 0);
+    REQUIRE(write(descriptors[1], correct_payload.data(), correct_payload.size()) == (ssize_t)correct_payload.size());
+    close(descriptors[1]);
+
+    PayloadReader payload("/dev/fd/" + std::to_string(descriptors[0]));
+    close(descriptors[0]);
+
+    REQUIRE(std::string(payload.Data(), payload.Data() + payload.Size()) == correct_payload);
+}
+
+TEST_CASE("Failure to open a payload", "[PayloadReader]")
+{
+    REQUIRE_THROWS_AS(PayloadReader("test/files/nonexistent.txt"), EncodeException);
+}
+
+TEST_CASE("Write a payload using a memory mapping", "[PayloadWriter]")
+{
+    std::string correct_payload = "Hello, World!\n";
+
+    {
+        PayloadWriter payload("steg-payload.txt", correct_payload.size());
+        std::copy(correct_payload.begin(), correct_payload.end(), payload.Data());
+        payload.Commit();
+    }
+
+    PayloadReader payload("steg-payload.txt");
+    REQUIRE(std::string(payload.Data(), payload.Data() + payload.Size()) == correct_payload);
+
+    remove("steg-payload.txt");
+}
+
+TEST_CASE("Remove a payload which was not committed", "[PayloadWriter]")
+{
+    {
+        PayloadWriter payload("steg-payload.txt", 14);
+    }
+
+    REQUIRE(!boost::filesystem::exists("steg-payload.txt"));
+}
+
+TEST_CASE("Keep an existing file when a payload is not committed", "[PayloadWriter]")
+{
+    std::string existing_payload = "Hello, World!\n";
+    boost::filesystem::copy_file("test/files/hello_world.txt", "steg-payload.txt");
+
+    {
+        PayloadWriter payload("steg-payload.txt", 1000);
+        std::fill(payload.Data(), payload.Data() + payload.Size(), 0);
+    }
+
+    {
+        PayloadStreamWriter payload("steg-payload.txt", 4);
+        payload.Write(4);
+    }
+
+    {
+        PayloadReader payload("steg-payload.txt");
+        REQUIRE(std::string(payload.Data(), payload.Data() + payload.Size()) == existing_payload);
+    }
+
+    // Committing replaces the file, leaving no temporary files behind
+    {
+        PayloadWriter payload("steg-payload.txt", 3);
+        std::fill(payload.Data(), payload.Data() + payload.Size(), 'a');
+        payload.Commit();
+    }
+
+    {
+        PayloadReader payload("steg-payload.txt");
+        REQUIRE(std::string(payload.Data(), payload.Data() + payload.Size()) == "aaa");
+    }
+
+    for (boost::filesystem::directory_iterator it("."); it != boost::filesystem::directory_iterator(); ++it)
+    {
+        REQUIRE(it->path().filename().string().find("steg-payload.txt.") != 0);
+    }
+
+    remove("steg-payload.txt");
+}
+
+TEST_CASE("Read a payload in windows", "[PayloadStreamReader]")
+{
+    std::string correct_payload = "Hello, World!\n";
+    std::string read_payload;
+
+    PayloadStreamReader payload("test/files/hello_world.txt", 4);
+    const unsigned char *window;
+
+    for (std::size_t size; (size = payload.Next(&window)) > 0;)
+    {
+        REQUIRE(size <= 4);
+        read_payload.append(window, window + size);
+    }
+
+    REQUIRE(read_payload == correct_payload);
+}
+
+TEST_CASE("Write a payload in windows", "[PayloadStreamWriter]")
+{
+    std::string correct_payload = "Hello, World!\n";
+
+    {
+        PayloadStreamWriter payload("steg-payload.txt", 4);
+
+        for (std::size_t offset = 0; offset < correct_payload.size(); offset += 4)
+        {
+            std::size_t size = std::min((std::size_t)4, correct_payload.size() - offset);
+            std::copy(correct_payload.begin() + offset, correct_payload.begin() + offset + size, payload.Buffer());
+            payload.Write(size);
+        }
+
+        payload.Commit();
+    }
+
+    PayloadReader payload("steg-payload.txt");
+    REQUIRE(std::string(payload.Data(), payload.Data() + payload.Size()) == correct_payload);
+
+    remove("steg-payload.txt");
+}
@@ -0,0 +1,127 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+#include "probe.hpp"
+#include "least_significant_bit.hpp"
+#include "discrete_cosine_transform.hpp"
+#include "jpeg_coefficients.hpp"
+#include "exceptions.hpp"
+
+TEST_CASE("Probe images for payloads", "[CorpusProbe]")
+{
+    LeastSignificantBit encode_lsb = LeastSignificantBit("test/files/lena.png");
+    encode_lsb.SetBitsPerSample(2);
+    encode_lsb.Encode("test/files/lorem_ipsum.txt");
+
+    DiscreteCosineTransform encode_dct = DiscreteCosineTransform("test/files/solid_white.png", 10);
+    encode_dct.SetLayout(0, 2);
+    encode_dct.Encode("test/files/hello_world.txt");
+
+    // The technique of each image is detected from its header
+    ProbeResult lsb = CorpusProbe::Probe("steg-lena.png");
+    REQUIRE(lsb.technique == "lsb");
+    REQUIRE(lsb.filename == "lorem_ipsum.txt");
+    REQUIRE(lsb.payload_size == 15051);
+
+    ProbeResult dct = CorpusProbe::Probe("steg-solid_white.jpg");
+    REQUIRE(dct.technique == "dct");
+    REQUIRE(dct.filename == "hello_world.txt");
+    REQUIRE(dct.payload_size == 14);
+
+    ProbeResult clean = CorpusProbe::Probe("test/files/lena.png");
+    REQUIRE(clean.technique.empty());
+    REQUIRE(clean.error.empty());
+
+    REQUIRE(!CorpusProbe::Probe("test/files/hello_world.txt").error.empty());
+
+    boost::filesystem::ofstream manifest("manifest.tsv");
+    manifest << "# image" << std::endl
+             << "steg-lena.png\textra" << std::endl
+             << std::endl
+             << "test/files/lena.png" << std::endl
+             << "steg-solid_white.jpg" << std::endl;
+    manifest.close();
+
+    // The results are written in the order of the manifest
+    std::ostringstream output;
+    REQUIRE(CorpusProbe::Run(CorpusProbe::ReadImages("manifest.tsv"), output) == 2);
+    REQUIRE(output.str() ==
+            "{\"image\": \"steg-lena.png\", \"technique\": \"lsb\", \"filename\": \"lorem_ipsum.txt\", \"payload_size\": 15051}\n"
+            "{\"image\": \"test/files/lena.png\", \"technique\": null}\n"
+            "{\"image\": \"steg-solid_white.jpg\", \"technique\": \"dct\", \"filename\": \"hello_world.txt\", \"payload_size\": 14}\n");
+
+    REQUIRE(CorpusProbe::ReadImages("test/files").size() == 4);
+    REQUIRE_THROWS_AS(CorpusProbe::ReadImages("nonexistent.tsv"), DecodeException);
+
+    remove("manifest.tsv");
+    remove("steg-lena.png");
+    remove("steg-solid_white.jpg");
+}
+
+TEST_CASE("Probe images which can't be read in stripes and JPEG coefficients", "[CorpusProbe]")
+{
+    const std::vector<unsigned char> payload = {'h', 'i'};
+
+    // A PPM image is decoded whole rather than a stripe at a time
+    cv::Mat image(64, 64, CV_8UC3);
+    cv::randu(image, cv::Scalar(0, 0, 0), cv::Scalar(255, 255, 255));
+    LeastSignificantBit encode_lsb = LeastSignificantBit(image);
+    encode_lsb.Embed("hi.txt", payload.data(), payload.size());
+    cv::imwrite("steg-carrier.ppm", image);
+
+    ProbeResult lsb = CorpusProbe::Probe("steg-carrier.ppm");
+    REQUIRE(lsb.error.empty());
+    REQUIRE(lsb.technique == "lsb");
+    REQUIRE(lsb.filename == "hi.txt");
+    REQUIRE(lsb.payload_size == 2);
+
+    // The JPEG technique is tried on JPEG images without a payload of the others
+    std::vector<unsigned char> carrier_bytes;
+    cv::imencode(".jpg", cv::imread("test/files/lena.png", cv::IMREAD_UNCHANGED), carrier_bytes,
+            std::vector<int>{CV_IMWRITE_JPEG_QUALITY, 75});
+
+    JpegCoefficients encode_jpeg = JpegCoefficients(carrier_bytes, 10);
+    const std::vector<unsigned char> image_bytes = encode_jpeg.EncodeBuffer("hi.txt", payload.data(), payload.size());
+
+    boost::filesystem::ofstream steg_jpeg("steg-carrier.jpg", std::ios::binary);
+    steg_jpeg.write(reinterpret_cast<const char *>(image_bytes.data()), image_bytes.size());
+    steg_jpeg.close();
+
+    ProbeResult jpeg = CorpusProbe::Probe("steg-carrier.jpg");
+    REQUIRE(jpeg.error.empty());
+    REQUIRE(jpeg.technique == "jpeg");
+    REQUIRE(jpeg.filename == "hi.txt");
+    REQUIRE(jpeg.payload_size == 2);
+
+    remove("steg-carrier.ppm");
+    remove("steg-carrier.jpg");
+}
+
+TEST_CASE("Format probe results as JSON", "[CorpusProbe]")
+{
+    ProbeResult result = {"a \"b\".png", "lsb", "c\\d\n", 7, ""};
+    REQUIRE(CorpusProbe::Json(result) ==
+            "{\"image\": \"a \\\"b\\\".png\", \"technique\": \"lsb\", \"filename\": \"c\\\\d\\u000a\", \"payload_size\": 7}");
+
+    result.error = "Error: Failed to read image";
+    REQUIRE(CorpusProbe::Json(result) == "{\"image\": \"a \\\"b\\\".png\", \"error\": \"Error: Failed to read image\"}");
+}
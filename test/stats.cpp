@@ -0,0 +1,44 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+#include "stats.hpp"
+#include "least_significant_bit.hpp"
+
+TEST_CASE("Record the stages of encoding", "[Stats]")
+{
+    std::vector<unsigned char> payload = {'H', 'e', 'l', 'l', 'o', ',', ' ', 'W', 'o', 'r', 'l', 'd', '!', '\n'};
+
+    Stats::Enable(false);
+
+    LeastSignificantBit encode_lsb = LeastSignificantBit("test/files/solid_white.png");
+    encode_lsb.EncodeBuffer("hello_world.txt", payload.data(), payload.size());
+
+    std::string json = Stats::Json();
+    REQUIRE(json.find("{\"stage\": \"read\", \"calls\": 1,") != std::string::npos);
+    REQUIRE(json.find("\"stage\": \"embed\"") != std::string::npos);
+    REQUIRE(json.find("\"bytes\": 14, \"bits\": 112") != std::string::npos);
+    REQUIRE(json.find("\"stage\": \"write\"") != std::string::npos);
+
+    // Nothing is recorded once disabled
+    Stats::Disable();
+    encode_lsb.EncodeBuffer("hello_world.txt", payload.data(), payload.size());
+    REQUIRE(Stats::Json() == "{\"stages\": []}");
+}
@@ -27,12 +27,96 @@ class TestSteganography : public Steganography
 {
     public:
         using Steganography::Steganography;
+        using Steganography::SlotCursor;
+        using Steganography::SetBit;
+        using Steganography::GetBit;
 
         virtual void Encode(const boost::filesystem::path &image_path) {}
         virtual void Decode() {}
+        virtual void Embed(const std::string &payload_filename, const unsigned char *payload, const std::size_t &payload_size) {}
+        virtual std::vector<unsigned char> EncodeImage() { return std::vector<unsigned char>(); }
+        virtual DecodedPayload DecodeBuffer() { return DecodedPayload(); }
+        virtual void EncodePayload(const std::size_t &start, const unsigned char *it, const unsigned char *en) {}
+        virtual void DecodePayload(const std::size_t &start, unsigned char *it, unsigned char *en) {}
+        virtual std::size_t PayloadStart(const std::size_t &filename_length) const { return 0; }
+        virtual std::size_t Capacity() const { return 0; }
 };
 
 TEST_CASE("Failure to open given image", "[Steganography]")
 {
     REQUIRE_THROWS_AS(TestSteganography("test/files/nonexistent.png"), ImageException);
 }
+
+TEST_CASE("Failure to decode given image bytes", "[Steganography]")
+{
+    REQUIRE_THROWS_AS(TestSteganography(std::vector<unsigned char>{'n', 'o', 't', ' ', 'p', 'n', 'g'}), ImageException);
+    REQUIRE_THROWS_AS(TestSteganography(std::vector<unsigned char>()), ImageException);
+    REQUIRE_THROWS_AS(TestSteganography(cv::Mat()), ImageException);
+}
+
+TEST_CASE("Address slots using the slot cursor", "[Steganography]")
+{
+    // A 5x6 plane of samples where each row is padded to 8 bytes
+    unsigned char plane[5 * 8];
+
+    TestSteganography::SlotCursor cursor(plane, 8, 1, 1, 5, 6, 13);
+    REQUIRE(cursor.Pointer() == plane + (2 * 8) + 1);
+    REQUIRE(cursor.Contiguous() == 5);
+
+    // Advancing past the end of a row moves to the start of the next row
+    cursor += 4;
+    REQUIRE(cursor.Pointer() == plane + (2 * 8) + 5);
+    ++cursor;
+    REQUIRE(cursor.Pointer() == plane + (3 * 8));
+    REQUIRE(cursor.Slot() == 18);
+
+    cursor.Seek(29);
+    REQUIRE(!cursor.End());
+    ++cursor;
+    REQUIRE(cursor.End());
+    REQUIRE(cursor.Contiguous() == 0);
+
+    // 2x2 slots of 4 byte samples
+    TestSteganography::SlotCursor blocks(plane, 8, 4, 2, 2, 1, 1);
+    REQUIRE(blocks.Pointer() == plane + (2 * 8));
+}
+
+TEST_CASE("Set/Get bits above the 31st bit of a sample", "[Steganography]")
+{
+    TestSteganography steganography(cv::Mat(1, 1, CV_8UC1, cv::Scalar(0)));
+
+    uint64_t sample = 0;
+    steganography.SetBit(&sample, 40, 1);
+    steganography.SetBit(&sample, 63, 1);
+    REQUIRE(sample == ((1ULL << 40) | (1ULL << 63)));
+    REQUIRE(steganography.GetBit(sample, 40) == 1);
+    REQUIRE(steganography.GetBit(sample, 63) == 1);
+    REQUIRE(steganography.GetBit(sample, 8) == 0);
+
+    steganography.SetBit(&sample, 63, 0);
+    REQUIRE(sample == (1ULL << 40));
+
+    uint32_t narrow = 0;
+    steganography.SetBit(&narrow, 31, 1);
+    REQUIRE(narrow == 0x80000000U);
+    REQUIRE(steganography.GetBit(narrow, 31) == 1);
+}
+
+TEST_CASE("Address slots beyond 2^32 using the slot cursor", "[Steganography]")
+{
+    unsigned char plane[1];
+
+    // A 100000x100000 grid of slots which is never dereferenced
+    TestSteganography::SlotCursor cursor(plane, 0, 0, 1, 100000, 100000, 5000000007ULL);
+    REQUIRE(cursor.Slot() == 5000000007ULL);
+    REQUIRE(cursor.Contiguous() == 99993);
+
+    cursor += 99993;
+    REQUIRE(cursor.Slot() == 5000100000ULL);
+    REQUIRE(cursor.Contiguous() == 100000);
+
+    cursor.Seek(9999999999ULL);
+    REQUIRE(!cursor.End());
+    ++cursor;
+    REQUIRE(cursor.End());
+}
@@ -0,0 +1,244 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <iterator>
+#include <vector>
+#include <tiffio.h>
+
+#include <catch.hpp>
+#include "striped_steganography.hpp"
+#include "stripes.hpp"
+#include "discrete_cosine_transform.hpp"
+#include "least_significant_bit.hpp"
+#include "exceptions.hpp"
+
+/**
+ * Read the contents of a file into memory.
+ */
+static std::vector<unsigned char> ReadFile(const boost::filesystem::path &path)
+{
+    boost::filesystem::ifstream file(path, std::ios::binary);
+    return std::vector<unsigned char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+/**
+ * Write an RGB(A) or grayscale image as a LZW compressed TIFF, in strips of 8
+ * rows or in square tiles.
+ */
+static void WriteTiff(const boost::filesystem::path &path, const cv::Mat &image, const uint32_t &tile_size)
+{
+    TIFF *tiff = TIFFOpen(path.string().c_str(), "w");
+    const uint16_t alpha = EXTRASAMPLE_UNASSALPHA;
+
+    TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, (uint32_t)image.cols);
+    TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, (uint32_t)image.rows);
+    TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, (image.depth() == CV_16U) ? 16 : 8);
+    TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, image.channels());
+    TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, (image.channels() == 1) ? PHOTOMETRIC_MINISBLACK : PHOTOMETRIC_RGB);
+    TIFFSetField(tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+    TIFFSetField(tiff, TIFFTAG_COMPRESSION, COMPRESSION_LZW);
+
+    if (image.channels() == 4)
+    {
+        TIFFSetField(tiff, TIFFTAG_EXTRASAMPLES, 1, &alpha);
+    }
+
+    // The samples are stored RGB(A), the image is BGR(A)
+    cv::Mat rgb = image.clone();
+    const std::size_t sample_size = image.elemSize1();
+
+    for (int row = 0; image.channels() >= 3 && row < rgb.rows; row++)
+    {
+        for (int col = 0; col < rgb.cols; col++)
+        {
+            unsigned char *pixel = rgb.ptr(row) + (col * rgb.elemSize());
+            std::swap_ranges(pixel, pixel + sample_size, pixel + (2 * sample_size));
+        }
+    }
+
+    if (tile_size == 0)
+    {
+        TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, 8);
+
+        for (int row = 0; row < rgb.rows; row++)
+        {
+            TIFFWriteScanline(tiff, rgb.ptr(row), row, 0);
+        }
+    }
+    else
+    {
+        TIFFSetField(tiff, TIFFTAG_TILEWIDTH, tile_size);
+        TIFFSetField(tiff, TIFFTAG_TILELENGTH, tile_size);
+
+        std::vector<unsigned char> tile(tile_size * tile_size * rgb.elemSize());
+
+        for (int row = 0; row < rgb.rows; row += tile_size)
+        {
+            for (int col = 0; col < rgb.cols; col += tile_size)
+            {
+                std::fill(tile.begin(), tile.end(), 0);
+
+                for (int y = 0; y < (int)tile_size && row + y < rgb.rows; y++)
+                {
+                    const std::size_t width = std::min((int)tile_size, rgb.cols - col) * rgb.elemSize();
+                    std::copy(rgb.ptr(row + y) + (col * rgb.elemSize()), rgb.ptr(row + y) + (col * rgb.elemSize()) + width,
+                            tile.begin() + (y * tile_size * rgb.elemSize()));
+                }
+
+                TIFFWriteTile(tiff, tile.data(), col, row, 0, 0);
+            }
+        }
+    }
+
+    TIFFClose(tiff);
+}
+
+/**
+ * @return Whether every row read from the image in stripes matches the expected image.
+ */
+static bool ReadStripes(const boost::filesystem::path &path, const cv::Mat &expected, const int &stripe_rows)
+{
+    StripeReader reader(path);
+
+    if (reader.Rows() != expected.rows || reader.Cols() != expected.cols || reader.Type() != expected.type())
+    {
+        return false;
+    }
+
+    cv::Mat stripe(stripe_rows, reader.Cols(), reader.Type());
+
+    for (int row = 0, count; (count = reader.Read(&stripe)) > 0; row += count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            if (!std::equal(stripe.ptr(i), stripe.ptr(i) + (stripe.cols * stripe.elemSize()), expected.ptr(row + i)))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+TEST_CASE("Read a TIFF a stripe at a time", "[StripedSteganography]")
+{
+    cv::Mat image(150, 90, CV_8UC3);
+    cv::randu(image, cv::Scalar(0, 0, 0), cv::Scalar(255, 255, 255));
+
+    cv::Mat deep_image(70, 50, CV_16UC4);
+    cv::randu(deep_image, cv::Scalar(0, 0, 0, 0), cv::Scalar(65535, 65535, 65535, 65535));
+
+    cv::Mat gray_image(40, 33, CV_8UC1);
+    cv::randu(gray_image, cv::Scalar(0), cv::Scalar(255));
+
+    // Rows come out BGR(A) like cv::imread, whether the stripes and tiles line up or not
+    WriteTiff("carrier.tif", image, 0);
+    REQUIRE(ReadStripes("carrier.tif", image, 8));
+    REQUIRE(ReadStripes("carrier.tif", image, 13));
+
+    WriteTiff("carrier.tif", image, 32);
+    REQUIRE(ReadStripes("carrier.tif", image, 8));
+    REQUIRE(ReadStripes("carrier.tif", image, 40));
+
+    WriteTiff("carrier.tif", deep_image, 16);
+    REQUIRE(ReadStripes("carrier.tif", deep_image, 24));
+
+    WriteTiff("carrier.tif", gray_image, 0);
+    REQUIRE(ReadStripes("carrier.tif", gray_image, 8));
+
+    // A tiled carrier is encoded as a PNG, the same as one encoded from its decoded pixels
+    const std::vector<unsigned char> correct_payload = ReadFile("test/files/hello_world.txt");
+
+    WriteTiff("carrier.tif", image, 32);
+    StripedSteganography encode_striped("carrier.tif", "lsb", 1);
+    encode_striped.Encode("test/files/hello_world.txt");
+
+    LeastSignificantBit encode_lsb = LeastSignificantBit(image);
+    encode_lsb.Embed("hello_world.txt", correct_payload.data(), correct_payload.size());
+
+    REQUIRE(ReadStripes("steg-carrier.png", image, 8));
+
+    remove("carrier.tif");
+    remove("steg-carrier.png");
+}
+
+TEST_CASE("Encode/Decode a stripe at a time using the LSB technique", "[StripedSteganography]")
+{
+    const std::vector<unsigned char> correct_payload = ReadFile("test/files/lorem_ipsum.txt");
+
+    // The budget only fits a single stripe of 8 rows, so the payload is spread across many stripes
+    StripedSteganography encode_striped("test/files/lena.png", "lsb", 16384);
+    encode_striped.Encode("test/files/lorem_ipsum.txt");
+
+    // The steganographic image is the same as one encoded by the LSB technique
+    LeastSignificantBit decode_lsb = LeastSignificantBit("steg-lena.png");
+    DecodedPayload decoded_payload = decode_lsb.DecodeBuffer();
+
+    REQUIRE(decoded_payload.filename == "lorem_ipsum.txt");
+    REQUIRE(decoded_payload.bytes == correct_payload);
+
+    StripedSteganography decode_striped("steg-lena.png", "lsb", 16384);
+    decode_striped.Decode();
+
+    REQUIRE(ReadFile("steg-lorem_ipsum.txt") == correct_payload);
+
+    remove("steg-lena.png");
+    remove("steg-lorem_ipsum.txt");
+}
+
+TEST_CASE("Encode/Decode a stripe at a time using the DCT technique", "[StripedSteganography]")
+{
+    const std::vector<unsigned char> correct_payload = ReadFile("test/files/hello_world.txt");
+
+    // The smallest stripe of the DCT technique is 64 rows, the carrier is 200 rows
+    StripedSteganography encode_striped("test/files/solid_white.png", "dct", 1);
+    encode_striped.Encode("test/files/hello_world.txt");
+
+    DiscreteCosineTransform decode_dct = DiscreteCosineTransform("steg-solid_white.jpg", 10);
+    DecodedPayload decoded_payload = decode_dct.DecodeBuffer();
+
+    REQUIRE(decoded_payload.filename == "hello_world.txt");
+    REQUIRE(decoded_payload.bytes == correct_payload);
+
+    remove("steg-solid_white.jpg");
+
+    // An image encoded by the DCT technique is decoded a stripe at a time
+    DiscreteCosineTransform encode_dct = DiscreteCosineTransform("test/files/solid_white.png", 10);
+    encode_dct.Encode("test/files/hello_world.txt");
+
+    StripedSteganography decode_striped("steg-solid_white.jpg", "dct", 1);
+    decode_striped.Decode();
+
+    REQUIRE(ReadFile("steg-hello_world.txt") == correct_payload);
+
+    remove("steg-solid_white.jpg");
+    remove("steg-hello_world.txt");
+}
+
+TEST_CASE("Encode/Decode failure a stripe at a time", "[StripedSteganography]")
+{
+    REQUIRE_THROWS_AS(StripedSteganography("test/files/lena.png", "jpeg", 16384), ImageException);
+
+    // Nothing is left behind when the carrier is too small
+    StripedSteganography encode_striped("test/files/solid_white.png", "dct", 1);
+    REQUIRE_THROWS_AS(encode_striped.Encode("test/files/lorem_ipsum.txt"), EncodeException);
+    REQUIRE(!boost::filesystem::exists("steg-solid_white.jpg"));
+
+    StripedSteganography decode_striped("test/files/solid_white.png", "lsb", 16384);
+    REQUIRE_THROWS_AS(decode_striped.Decode(), DecodeException);
+}
@@ -0,0 +1,52 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <stdexcept>
+#include <vector>
+
+#include <catch.hpp>
+#include "thread_pool.hpp"
+
+TEST_CASE("Process every index exactly once using the thread pool", "[ThreadPool]")
+{
+    ThreadPool pool(4);
+    std::vector<int> visited(1001, 0);
+
+    pool.ParallelFor(0, visited.size(), 7, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            visited[i]++;
+        }
+    });
+
+    REQUIRE(pool.Threads() == 4);
+    REQUIRE(std::vector<int>(1001, 1) == visited);
+}
+
+TEST_CASE("Rethrow exceptions from the thread pool", "[ThreadPool]")
+{
+    ThreadPool pool(4);
+
+    REQUIRE_THROWS_AS(pool.ParallelFor(0, 100, 1, [](std::size_t begin, std::size_t)
+    {
+        if (begin == 42)
+        {
+            throw std::runtime_error("Error: Task failed");
+        }
+    }), std::runtime_error);
+}
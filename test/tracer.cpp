@@ -0,0 +1,83 @@
+/* This file is a part of "Steganography" a C++ steganography tool.
+
+Copyright (C) 2019 James Lee <jamesl33info@gmail.com>.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+#include "tracer.hpp"
+#include "least_significant_bit.hpp"
+
+/**
+ * Count the number of times a string occurs in another.
+ */
+static std::size_t Occurrences(const std::string &haystack, const std::string &needle)
+{
+    std::size_t count = 0;
+
+    for (std::size_t position = haystack.find(needle); position != std::string::npos; position = haystack.find(needle, position + 1))
+    {
+        count++;
+    }
+
+    return count;
+}
+
+TEST_CASE("Trace the chunks of a payload", "[Tracer]")
+{
+    std::vector<unsigned char> payload = {'H', 'e', 'l', 'l', 'o', ',', ' ', 'W', 'o', 'r', 'l', 'd', '!', '\n'};
+
+    Tracer::Enable();
+
+    LeastSignificantBit encode_lsb = LeastSignificantBit("test/files/solid_white.png");
+    encode_lsb.EncodeBuffer("hello_world.txt", payload.data(), payload.size());
+
+    Tracer::Disable();
+
+    std::ostringstream trace;
+    Tracer::Write(trace);
+
+    // The payload fits in a single chunk which starts after the header and the filename
+    REQUIRE(trace.str().find("{\"displayTimeUnit\": \"ns\", \"traceEvents\": [") == 0);
+    REQUIRE(Occurrences(trace.str(), "\"name\": \"embed\"") == 1);
+    REQUIRE(trace.str().find("\"args\": {\"start_bit\": 376, \"bytes\": 14, \"blocks\": 0}") != std::string::npos);
+}
+
+TEST_CASE("Keep the newest spans once the ring is full", "[Tracer]")
+{
+    Tracer::Enable(2);
+
+    for (int i = 0; i < 5; i++)
+    {
+        Tracer::Span span("test", i, 1);
+    }
+
+    Tracer::Disable();
+
+    // Nothing is recorded once disabled
+    {
+        Tracer::Span span("test", 5, 1);
+    }
+
+    std::ostringstream trace;
+    Tracer::Write(trace);
+
+    REQUIRE(Occurrences(trace.str(), "\"name\": \"test\"") == 2);
+    REQUIRE(trace.str().find("\"start_bit\": 3,") != std::string::npos);
+    REQUIRE(trace.str().find("\"start_bit\": 4,") != std::string::npos);
+}